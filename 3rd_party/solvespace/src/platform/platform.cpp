@@ -20,6 +20,7 @@
 #   include <sys/stat.h>
 #endif
 #include <list>
+#include <memory>
 #include <iostream>
 
 namespace SolveSpace {
@@ -77,54 +78,97 @@ void DebugPrint(const char *fmt, ...) {
 // Temporary arena.
 //-----------------------------------------------------------------------------
 
-struct Chunk {
-    Chunk()
+struct TemporaryArena::Chunk {
+    explicit Chunk(size_t size) : data(new uint8_t[size]()), size(size)
     {
-        data.resize(4096, 0);
-        ptr = data.data();
-        endptr = ptr + data.size();
     }
-    std::vector<uint8_t> data;
-    uint8_t *ptr = nullptr;
-    uint8_t *endptr = nullptr;
+    std::unique_ptr<uint8_t[]> data;
+    size_t size = 0;
+    size_t used = 0;
 };
 
-static std::list<Chunk> chunks;
-static Chunk *last_chunk = nullptr;
+static constexpr size_t ARENA_ALIGN = 0x10;
+static constexpr size_t ARENA_MIN_CHUNK_SIZE = 64 * 1024;
 
-void *AllocTemporary(size_t size)
+TemporaryArena::TemporaryArena() = default;
+TemporaryArena::~TemporaryArena() = default;
+
+void *TemporaryArena::Alloc(size_t size)
 {
-    if(!last_chunk) {
-        last_chunk = &chunks.emplace_back();
-    }
-    else {
-        if(last_chunk->ptr + size > last_chunk->endptr) {
-            last_chunk = &chunks.emplace_back();
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    while(current < chunks.size()) {
+        auto &chunk = chunks[current];
+        if(chunk.used + size <= chunk.size) {
+            auto p = chunk.data.get() + chunk.used;
+            chunk.used += size;
+            return p;
         }
+        current++;
     }
-    auto p = (void*)last_chunk->ptr;
-    size += 0x10-(size%0x10); // 16 byte alignment
-    last_chunk->ptr += size;
-    return p;
+    // Grow geometrically so that big systems end up in a handful of chunks.
+    size_t chunk_size = std::max(ARENA_MIN_CHUNK_SIZE, size);
+    if(!chunks.empty())
+        chunk_size = std::max(chunk_size, chunks.back().size * 2);
+    auto &chunk = chunks.emplace_back(chunk_size);
+    current = chunks.size() - 1;
+    chunk.used = size;
+    return chunk.data.get();
 }
 
-void FreeAllTemporary()
+void TemporaryArena::Reset()
 {
-    size_t total_size = 0;
-    for(auto &chunk:chunks) {
-        total_size += chunk.data.size();
+    if(chunks.empty())
+        return;
+    if(chunks.size() > 1) {
+        // Coalesce into a single chunk that fits everything we needed
+        // this time around.
+        const auto capacity = GetCapacity();
+        chunks.clear();
+        chunks.emplace_back(capacity);
     }
-    while(chunks.size() > 1) {
-        chunks.pop_back();
+    else {
+        // Only zero what was actually handed out.
+        auto &chunk = chunks.front();
+        memset(chunk.data.get(), 0, chunk.used);
+        chunk.used = 0;
     }
-    if(chunks.size() == 0)
-        return;
-    auto &chunk = chunks.front();
-    chunk.data.resize(total_size);
-    memset(chunk.data.data(), 0, total_size);
-    chunk.ptr = chunk.data.data();
-    chunk.endptr = chunk.ptr + chunk.data.size();
-    last_chunk = &chunk;
+    current = 0;
+}
+
+size_t TemporaryArena::GetUsedSize() const
+{
+    size_t r = 0;
+    for(const auto &chunk : chunks)
+        r += chunk.used;
+    return r;
+}
+
+size_t TemporaryArena::GetCapacity() const
+{
+    size_t r = 0;
+    for(const auto &chunk : chunks)
+        r += chunk.size;
+    return r;
+}
+
+static thread_local TemporaryArena default_arena;
+static thread_local TemporaryArena *current_arena = &default_arena;
+
+TemporaryArena *SetTemporaryArena(TemporaryArena *arena)
+{
+    auto prev = current_arena;
+    current_arena = arena ? arena : &default_arena;
+    return prev;
+}
+
+void *AllocTemporary(size_t size)
+{
+    return current_arena->Alloc(size);
+}
+
+void FreeAllTemporary()
+{
+    current_arena->Reset();
 }
 
 }
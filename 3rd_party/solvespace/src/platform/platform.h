@@ -81,6 +81,35 @@ void DebugPrint(const char *fmt, ...);
 void *AllocTemporary(size_t size);
 void FreeAllTemporary();
 
+// A bump allocator backing AllocTemporary(). Memory handed out is zeroed
+// and 16 byte aligned; it stays valid until Reset() or destruction.
+// Reset() keeps the storage around, so an arena that is reused for
+// consecutive solves doesn't hit the heap again once it has warmed up.
+class TemporaryArena {
+public:
+    TemporaryArena();
+    ~TemporaryArena();
+    TemporaryArena(const TemporaryArena &) = delete;
+    TemporaryArena &operator=(const TemporaryArena &) = delete;
+
+    void *Alloc(size_t size);
+    void Reset();
+
+    // Bytes currently handed out / held.
+    size_t GetUsedSize() const;
+    size_t GetCapacity() const;
+
+private:
+    struct Chunk;
+    std::vector<Chunk> chunks;
+    size_t current = 0;
+};
+
+// Redirects AllocTemporary() and FreeAllTemporary() on the calling thread
+// to the given arena, nullptr selects the thread's default one. Returns the
+// previously active arena.
+TemporaryArena *SetTemporaryArena(TemporaryArena *arena);
+
 } // namespace Platform
 } // namespace SolveSpace
 
@@ -8,7 +8,7 @@
 #include "config.h"
 
 SolveSpaceUI SolveSpace::SS = {};
-Sketch SolveSpace::SK = {};
+thread_local Sketch SolveSpace::SK = {};
 
 void SolveSpaceUI::Init() {
 #if !defined(HEADLESS)
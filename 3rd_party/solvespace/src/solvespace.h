@@ -823,7 +823,9 @@ bool LinkIDF(const Platform::Path &filename, EntityList *le, SMesh *m, SShell *s
 bool LinkStl(const Platform::Path &filename, EntityList *le, SMesh *m, SShell *sh);
 
 extern SolveSpaceUI SS;
-extern Sketch SK;
+// Each thread gets its own sketch, so that independent systems can be
+// solved concurrently.
+extern thread_local Sketch SK;
 
 }
 
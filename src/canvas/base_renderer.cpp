@@ -15,16 +15,113 @@ void BaseRenderer::realize_base()
     glGenBuffers(1, &m_ubo);
     glBindBuffer(GL_UNIFORM_BUFFER, m_ubo);
 
-    unsigned int block_index = glGetUniformBlockIndex(m_program, "color_setup");
     GLuint binding_point_index = static_cast<GLuint>(m_vertex_type);
     glBindBufferBase(GL_UNIFORM_BUFFER, binding_point_index, m_ubo);
-    glUniformBlockBinding(m_program, block_index, binding_point_index);
+    for (const auto program : {m_program, m_program_instanced}) {
+        if (!program)
+            continue;
+        unsigned int block_index = glGetUniformBlockIndex(program, "color_setup");
+        glUniformBlockBinding(program, block_index, binding_point_index);
+    }
+
+    get_base_locations();
+}
 
+void BaseRenderer::get_base_locations()
+{
     GET_LOC(this, view);
     GET_LOC(this, proj);
     GET_LOC(this, pick_base);
 }
 
+void BaseRenderer::update_program()
+{
+    if (!m_program_instanced)
+        return;
+    const auto program =
+            m_ca.m_primitive_mode == PrimitiveMode::INSTANCED ? m_program_instanced : m_program_geometry;
+    if (program == m_program)
+        return;
+    m_program = program;
+    get_base_locations();
+    get_locations();
+}
+
+bool BaseRenderer::is_instanced() const
+{
+    return m_program_instanced && m_program == m_program_instanced;
+}
+
+GLuint BaseRenderer::create_vao_instanced(GLuint vbo)
+{
+    GLuint vao, quad_buffer;
+
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    /* corners of the unit quad drawn for each instance as a triangle strip */
+    static const float corners[] = {0, 0, 1, 0, 0, 1, 1, 1};
+    glGenBuffers(1, &quad_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, quad_buffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    GLuint corner_index = glGetAttribLocation(m_program_instanced, "corner");
+    glEnableVertexAttribArray(corner_index);
+    glVertexAttribPointer(corner_index, 2, GL_FLOAT, GL_FALSE, 0, 0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    set_vertex_attrib_pointers(m_program_instanced, 0, true);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    return vao;
+}
+
+void BaseRenderer::create_flags_vbo()
+{
+    glGenBuffers(1, &m_flags_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_flags_vbo);
+    const uint32_t flags = 0;
+    glBufferData(GL_ARRAY_BUFFER, sizeof(flags), &flags, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void BaseRenderer::set_flags_attrib_pointer(GLuint program, size_t first, bool instanced)
+{
+    GLuint flags_index = glGetAttribLocation(program, "flags");
+    glBindBuffer(GL_ARRAY_BUFFER, m_flags_vbo);
+    glEnableVertexAttribArray(flags_index);
+    glVertexAttribIPointer(flags_index, 1, GL_UNSIGNED_INT, sizeof(uint32_t), (void *)(first * sizeof(uint32_t)));
+    if (instanced)
+        glVertexAttribDivisor(flags_index, 1);
+}
+
+std::vector<size_t> &BaseRenderer::get_changed_flags()
+{
+    return m_ca.m_changed_flags.at(static_cast<size_t>(m_vertex_type));
+}
+
+size_t BaseRenderer::get_push_first() const
+{
+    return m_ca.m_push_first.at(static_cast<size_t>(m_vertex_type));
+}
+
+void BaseRenderer::add_uploaded_bytes(size_t bytes)
+{
+    m_ca.m_uploaded_bytes.at(static_cast<size_t>(m_vertex_type)) += bytes;
+}
+
+void BaseRenderer::draw_quads(GLuint vbo, size_t first, size_t count)
+{
+    if (!count)
+        return;
+    // there's no base instance before GL 4.2, so move the attributes instead
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    set_vertex_attrib_pointers(m_program_instanced, first, true);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+}
+
 
 struct UBOBuffer {
     // keep in sync with ubo.glsl
@@ -36,6 +133,7 @@ struct UBOBuffer {
 
         switch (type) {
         case T::LINE:
+        case T::CURVE:
         case T::ICON:
         case T::GLYPH:
         case T::GLYPH_3D:
@@ -90,7 +188,8 @@ void BaseRenderer::load_uniforms()
     glUniformMatrix4fv(m_view_loc, 1, GL_FALSE, glm::value_ptr(m_ca.m_viewmat));
     glUniformMatrix4fv(m_proj_loc, 1, GL_FALSE, glm::value_ptr(m_ca.m_projmat));
     glUniform1ui(m_pick_base_loc, m_ca.m_pick_base);
-    m_ca.m_vertex_type_picks[m_vertex_type] = {.offset = m_ca.m_pick_base, .count = get_vertex_count()};
+    m_ca.m_vertex_type_picks.at(static_cast<size_t>(m_vertex_type)) = {.offset = m_ca.m_pick_base,
+                                                                       .count = get_vertex_count()};
     m_ca.m_pick_base += get_vertex_count();
 
     {
@@ -1,6 +1,9 @@
 #pragma once
 #include <epoxy/gl.h>
 #include "icanvas.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
 
 namespace dune3d {
 class BaseRenderer {
@@ -16,6 +19,124 @@ protected:
 
     void load_uniforms();
 
+    // Renderers that can draw their vertices as instanced quads instead of
+    // expanding them in a geometry shader set both programs, m_program then
+    // follows the canvas' primitive mode.
+    GLuint m_program_geometry = 0;
+    GLuint m_program_instanced = 0;
+    void update_program();
+    bool is_instanced() const;
+    virtual void get_locations()
+    {
+    }
+    // sets up the attributes for the VBO bound to GL_ARRAY_BUFFER, starting at vertex first
+    virtual void set_vertex_attrib_pointers(GLuint program, size_t first, bool instanced)
+    {
+    }
+    GLuint create_vao_instanced(GLuint vbo);
+    void draw_quads(GLuint vbo, size_t first, size_t count);
+
+    // Vertex flags live in a buffer of their own, so that hover and
+    // selection changes don't need to upload the geometry again.
+    GLuint m_flags_vbo;
+    void create_flags_vbo();
+    void set_flags_attrib_pointer(GLuint program, size_t first, bool instanced);
+    std::vector<size_t> &get_changed_flags();
+    size_t get_push_first() const;
+    // in vertices, for both the vertex and the flags buffer
+    size_t m_vbo_capacity = 0;
+
+    // for the statistics overlay
+    void add_uploaded_bytes(size_t bytes);
+
+    // Uploads vertices followed by vertices_selection_invisible. Vertices
+    // before the canvas' push start for this type are still the same as in
+    // the last push, so only the ones after it get uploaded as long as they
+    // fit into the buffer. That's what keeps updating the overlay cheap.
+    template <typename T>
+    void push_vertices(GLuint vbo, const std::vector<T> &vertices,
+                       const std::vector<T> &vertices_selection_invisible = {})
+    {
+        const size_t n = vertices.size() + vertices_selection_invisible.size();
+        size_t first = std::min(get_push_first(), vertices.size());
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        if (first == 0 || n > m_vbo_capacity) {
+            first = 0;
+            // leave some room for the overlay to grow into
+            m_vbo_capacity = n + n / 8 + 256;
+            glBufferData(GL_ARRAY_BUFFER, sizeof(T) * m_vbo_capacity, nullptr, GL_DYNAMIC_DRAW);
+        }
+        glBufferSubData(GL_ARRAY_BUFFER, sizeof(T) * first, sizeof(T) * (vertices.size() - first),
+                        vertices.data() + first);
+        glBufferSubData(GL_ARRAY_BUFFER, sizeof(T) * vertices.size(), sizeof(T) * vertices_selection_invisible.size(),
+                        vertices_selection_invisible.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        add_uploaded_bytes(sizeof(T) * (n - first));
+        upload_flags(vertices, vertices_selection_invisible, first);
+    }
+
+    // counterpart of push_vertices for the flags buffer, which has the same capacity
+    template <typename T>
+    void upload_flags(const std::vector<T> &vertices, const std::vector<T> &vertices_selection_invisible,
+                      size_t first)
+    {
+        m_flags_buffer.clear();
+        for (size_t i = first; i < vertices.size(); i++)
+            m_flags_buffer.push_back(static_cast<uint32_t>(vertices[i].flags));
+        for (const auto &v : vertices_selection_invisible)
+            m_flags_buffer.push_back(static_cast<uint32_t>(v.flags));
+        glBindBuffer(GL_ARRAY_BUFFER, m_flags_vbo);
+        if (first == 0)
+            glBufferData(GL_ARRAY_BUFFER, sizeof(uint32_t) * m_vbo_capacity, nullptr, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, sizeof(uint32_t) * first, sizeof(uint32_t) * m_flags_buffer.size(),
+                        m_flags_buffer.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        add_uploaded_bytes(sizeof(uint32_t) * m_flags_buffer.size());
+        // changes before first are left to upload_changed_flags
+        std::erase_if(get_changed_flags(), [first](size_t i) { return i >= first; });
+    }
+
+    // only uploads runs of vertices whose flags changed since the last upload
+    template <typename T> void upload_changed_flags(const std::vector<T> &vertices)
+    {
+        auto &changed = get_changed_flags();
+        if (changed.empty())
+            return;
+        if (vertices.empty()) {
+            changed.clear();
+            return;
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, m_flags_vbo);
+        // one large upload beats many small ones
+        if (changed.size() > vertices.size() / 4) {
+            m_flags_buffer.clear();
+            for (const auto &v : vertices)
+                m_flags_buffer.push_back(static_cast<uint32_t>(v.flags));
+            glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(uint32_t) * m_flags_buffer.size(), m_flags_buffer.data());
+            add_uploaded_bytes(sizeof(uint32_t) * m_flags_buffer.size());
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            changed.clear();
+            return;
+        }
+
+        std::ranges::sort(changed);
+        for (size_t i = 0; i < changed.size();) {
+            const size_t first = changed.at(i);
+            size_t last = first;
+            while (i < changed.size() && changed.at(i) <= last + 1) {
+                last = std::max(last, changed.at(i));
+                i++;
+            }
+            m_flags_buffer.clear();
+            for (size_t j = first; j <= last; j++)
+                m_flags_buffer.push_back(static_cast<uint32_t>(vertices.at(j).flags));
+            glBufferSubData(GL_ARRAY_BUFFER, sizeof(uint32_t) * first, sizeof(uint32_t) * m_flags_buffer.size(),
+                            m_flags_buffer.data());
+            add_uploaded_bytes(sizeof(uint32_t) * m_flags_buffer.size());
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        changed.clear();
+    }
 
     GLuint m_program;
     GLuint m_ubo;
@@ -23,5 +144,9 @@ protected:
     GLuint m_view_loc;
     GLuint m_proj_loc;
     GLuint m_pick_base_loc;
+
+private:
+    void get_base_locations();
+    std::vector<uint32_t> m_flags_buffer;
 };
 } // namespace dune3d
@@ -50,6 +50,11 @@ unsigned int GlyphInfo::get_h() const
     return atlas_h - font_information.smooth_pixels * 2;
 }
 
+uint32_t GlyphInfo::pack_bits() const
+{
+    return (get_h() & 0x3f) | ((get_w() & 0x3f) << 6) | ((get_y() & 0x3ff) << 12) | ((get_x() & 0x3ff) << 22);
+}
+
 unsigned int get_smooth_pixels()
 {
     return font_information.smooth_pixels;
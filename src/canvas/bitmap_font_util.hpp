@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 
 namespace dune3d::bitmap_font {
 void load_texture();
@@ -19,6 +20,9 @@ public:
     unsigned int get_y() const;
     unsigned int get_w() const;
     unsigned int get_h() const;
+
+    // atlas position and size as unpacked by unpack_glyph_info in the shaders
+    uint32_t pack_bits() const;
 };
 
 GlyphInfo get_glyph_info(unsigned int glyph);
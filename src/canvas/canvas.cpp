@@ -7,13 +7,16 @@
 #include "util/min_max_accumulator.hpp"
 #include "logger/logger.hpp"
 #include "iselection_filter.hpp"
+#include "util/stopwatch.hpp"
 #include <iostream>
+#include <cmath>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/matrix_transform_2d.hpp>
 #include <glm/gtx/rotate_vector.hpp>
 #include <glm/gtx/string_cast.hpp>
 #include <glm/gtx/io.hpp>
 #include <fstream>
+#include <algorithm>
 
 #ifdef HAVE_SPNAV
 #include <spnav.h>
@@ -33,9 +36,14 @@ static const MSD::Params msd_params_slow{
         .springyness = .15,
 };
 
+// adaptive quality during navigation
+static const float min_render_scale = .5;
+static const unsigned int settle_timeout_ms = 150;
+
 Canvas::Canvas()
     : m_background_renderer(*this), m_face_renderer(*this), m_point_renderer(*this), m_line_renderer(*this),
-      m_glyph_renderer(*this), m_glyph_3d_renderer(*this), m_icon_renderer(*this), m_box_selection(*this)
+      m_curve_renderer(*this), m_glyph_renderer(*this), m_glyph_3d_renderer(*this), m_icon_renderer(*this),
+      m_box_selection(*this), m_stats_overlay(*this)
 {
     set_can_focus(true);
     set_focusable(true);
@@ -238,6 +246,8 @@ void Canvas::setup_controllers()
             }
         }
         const auto delta = glm::mat2(1, 0, 0, -1) * (glm::vec2(x, y) - m_pointer_pos_orig);
+        if (m_pan_mode != PanMode::NONE)
+            navigation_step();
         if (m_pan_mode == PanMode::ROTATE) {
             glm::quat rz;
             if (m_rotation_scheme == RotationScheme::DEFAULT)
@@ -338,6 +348,86 @@ void Canvas::update_drag_selection(glm::vec2 pos)
 }
 
 
+void Canvas::navigation_step()
+{
+    if (!m_adaptive_quality)
+        return;
+    if (!m_navigating) {
+        m_navigating = true;
+        // don't wait for the first slow frame if the last full-quality one already was
+        if (m_full_quality_frame_time > m_frame_time_target) {
+            m_reduced_quality = true;
+            m_render_scale = std::clamp(std::sqrt(m_frame_time_target / m_full_quality_frame_time),
+                                        min_render_scale, 1.f);
+            m_needs_resize = true;
+        }
+    }
+    m_settle_connection.disconnect();
+    m_settle_connection =
+            Glib::signal_timeout().connect(sigc::mem_fun(*this, &Canvas::settle_navigation), settle_timeout_ms);
+}
+
+bool Canvas::settle_navigation()
+{
+    m_navigating = false;
+    if (m_reduced_quality) {
+        m_reduced_quality = false;
+        m_render_scale = 1;
+        m_needs_resize = true;
+    }
+    // render one full-quality frame, this also updates the pick buffer
+    queue_draw();
+    return false;
+}
+
+void Canvas::update_frame_time(float frame_time, bool reduced)
+{
+    frame_time = std::max(frame_time, .1f);
+    if (!reduced)
+        m_full_quality_frame_time = frame_time;
+    if (!m_navigating)
+        return;
+
+    if (!m_reduced_quality) {
+        if (frame_time > m_frame_time_target) {
+            m_reduced_quality = true;
+            m_render_scale = std::clamp(std::sqrt(m_frame_time_target / frame_time), min_render_scale, 1.f);
+            m_needs_resize = true;
+        }
+    }
+    else if (reduced) {
+        // rendering time is dominated by the number of pixels
+        if (frame_time > m_frame_time_target || frame_time < m_frame_time_target / 2)
+            m_render_scale = std::clamp(m_render_scale * std::sqrt(m_frame_time_target / frame_time),
+                                        min_render_scale, 1.f);
+    }
+}
+
+void Canvas::set_adaptive_quality(bool enable, float frame_time_target_ms)
+{
+    m_adaptive_quality = enable;
+    m_frame_time_target = frame_time_target_ms;
+    if (!m_adaptive_quality && m_navigating) {
+        m_settle_connection.disconnect();
+        settle_navigation();
+    }
+}
+
+void Canvas::set_show_stats_overlay(bool show)
+{
+    m_stats_overlay.set_active(show);
+}
+
+void Canvas::set_stats_timing(const std::string &label, float ms)
+{
+    m_stats_overlay.set_timing(label, ms);
+}
+
+void Canvas::set_stats_cache(const std::string &label, const StatsOverlay::CacheStats &stats)
+{
+    m_stats_overlay.set_cache_stats(label, stats);
+}
+
 void Canvas::end_pan()
 {
     m_pan_mode = PanMode::NONE;
@@ -349,16 +439,19 @@ void Canvas::scroll_zoom(double dx, double dy, Gtk::EventController &ctrl)
     if (m_enable_animations) {
         if (dy == 0)
             return;
+        navigation_step();
         start_anim();
         m_zoom_animator.target += dy;
     }
     else {
+        navigation_step();
         set_cam_distance(m_cam_distance * pow(zoom_base, dy));
     }
 }
 
 void Canvas::scroll_move(double dx, double dy, Gtk::EventController &ctrl)
 {
+    navigation_step();
     auto delta = glm::vec2(dx * -83, dy * 83);
     m_center += get_center_shift(delta);
     queue_draw();
@@ -366,6 +459,7 @@ void Canvas::scroll_move(double dx, double dy, Gtk::EventController &ctrl)
 
 void Canvas::scroll_rotate(double dx, double dy, Gtk::EventController &ctrl)
 {
+    navigation_step();
     auto delta = -glm::vec2(dx, dy);
 
     // auto rz = glm::angleAxis(glm::radians(delta.x * -9.f), glm::vec3(0, 0, 1));
@@ -400,6 +494,7 @@ void Canvas::drag_gesture_update_cb(Gdk::EventSequence *seq)
 {
     double x, y;
     if (m_gesture_drag->get_offset(x, y)) {
+        navigation_step();
         m_center = m_gesture_drag_center_orig + get_center_shift({x, -y});
         queue_draw();
     }
@@ -417,6 +512,7 @@ void Canvas::zoom_gesture_begin_cb(Gdk::EventSequence *seq)
 
 void Canvas::zoom_gesture_update_cb(Gdk::EventSequence *seq)
 {
+    navigation_step();
     auto delta = m_gesture_zoom->get_scale_delta();
     set_cam_distance(m_gesture_zoom_cam_dist_orig / delta);
     queue_draw();
@@ -437,6 +533,7 @@ void Canvas::rotate_gesture_begin_cb(Gdk::EventSequence *seq)
 
 void Canvas::rotate_gesture_update_cb(Gdk::EventSequence *seq)
 {
+    navigation_step();
     auto delta = m_gesture_rotate->get_angle_delta();
     double cx, cy;
     m_gesture_rotate->get_bounding_box_center(cx, cy);
@@ -509,19 +606,38 @@ void Canvas::animate_to_center_abs(const glm::vec3 &center)
 
 Canvas::VertexRef Canvas::get_vertex_ref_for_pick(unsigned int pick) const
 {
-    for (const auto &[ty, it] : m_vertex_type_picks) {
+    for (size_t ty = 0; ty < m_vertex_type_picks.size(); ty++) {
+        const auto &it = m_vertex_type_picks[ty];
         if ((pick >= it.offset) && ((pick - it.offset) < it.count))
-            return {ty, pick - it.offset};
+            return {static_cast<VertexType>(ty), pick - it.offset};
     }
     throw std::runtime_error("pick not found");
 }
 
+const SelectableRef *Canvas::find_selectable(const VertexRef &vref) const
+{
+    const auto &ids = m_vertex_selectables.at(static_cast<size_t>(vref.type));
+    if (vref.index >= ids.size())
+        return nullptr;
+    const auto id = ids[vref.index];
+    if (id == no_selectable)
+        return nullptr;
+    return &m_selectables[id];
+}
+
+const std::vector<VertexRef> *Canvas::find_vertices(const SelectableRef &sr) const
+{
+    auto it = m_selectable_ids.find(sr);
+    if (it == m_selectable_ids.end())
+        return nullptr;
+    return &m_selectable_vertices[it->second];
+}
+
 std::optional<SelectableRef> Canvas::get_selectable_ref_for_vertex_ref(const VertexRef &vref) const
 {
-    if (m_vertex_to_selectable_map.contains(vref)) {
-        auto sr = m_vertex_to_selectable_map.at(vref);
-        if (!m_selection_filter || m_selection_filter->can_select(sr))
-            return sr;
+    if (auto sr = find_selectable(vref)) {
+        if (!m_selection_filter || m_selection_filter->can_select(*sr))
+            return *sr;
         else
             return {};
     }
@@ -539,29 +655,31 @@ std::optional<SelectableRef> Canvas::get_selectable_ref_for_pick(unsigned int pi
 
 void Canvas::clear_flags(VertexFlags mask)
 {
-    for (auto &x : m_lines) {
-        x.flags &= ~mask;
-    }
-    for (auto &x : m_points) {
-        x.flags &= ~mask;
-    }
-    for (auto &x : m_glyphs) {
-        x.flags &= ~mask;
-    }
-    for (auto &x : m_glyphs_3d) {
-        x.flags &= ~mask;
-    }
+    auto clear = [this, mask](auto &vertices, VertexType type) {
+        auto &changed = m_changed_flags.at(static_cast<size_t>(type));
+        for (size_t i = 0; i < vertices.size(); i++) {
+            auto &flags = vertices[i].flags;
+            if ((flags & mask) != VertexFlags::DEFAULT) {
+                flags &= ~mask;
+                changed.push_back(i);
+            }
+        }
+    };
+    clear(m_lines, VertexType::LINE);
+    clear(m_curves, VertexType::CURVE);
+    clear(m_points, VertexType::POINT);
+    clear(m_glyphs, VertexType::GLYPH);
+    clear(m_glyphs_3d, VertexType::GLYPH_3D);
+    clear(m_icons, VertexType::ICON);
+    // face group flags go to the group buffer, which push_groups() rebuilds every frame
     for (auto &x : m_face_groups) {
         x.flags &= ~mask;
     }
-    for (auto &x : m_icons) {
-        x.flags &= ~mask;
-    }
 }
 
 void Canvas::update_hover_selection()
 {
-    if (m_vertex_type_picks.size() == 0)
+    if (!m_have_picks)
         return;
     if (m_selection_mode != SelectionMode::NONE) {
         auto last_hover_selection = m_hover_selection;
@@ -603,13 +721,10 @@ void Canvas::update_hover_selection()
             }
             clear_flags(mask);
             if (m_hover_selection.has_value()) {
-                for (const auto &vref : m_selectable_to_vertex_map.at(m_hover_selection.value())) {
-                    auto &flags = get_vertex_flags(vref);
-                    flags |= mask;
+                for (const auto &vref : *find_vertices(m_hover_selection.value())) {
+                    set_vertex_flags(vref, mask);
                 }
             }
-            m_push_flags =
-                    static_cast<PushFlags>(m_push_flags | PF_LINES | PF_POINTS | PF_GLYPHS | PF_GLYPHS_3D | PF_ICONS);
             queue_draw();
             m_signal_hover_selection_changed.emit();
         }
@@ -678,10 +793,12 @@ void Canvas::on_realize()
     m_face_renderer.realize();
     m_point_renderer.realize();
     m_line_renderer.realize();
+    m_curve_renderer.realize();
     m_glyph_renderer.realize();
     m_glyph_3d_renderer.realize();
     m_icon_renderer.realize();
     m_box_selection.realize();
+    m_stats_overlay.realize();
     GL_CHECK_ERROR
 
 
@@ -695,6 +812,7 @@ void Canvas::on_realize()
     glGenRenderbuffers(1, &m_depthrenderbuffer);
     glGenRenderbuffers(1, &m_pickrenderbuffer);
     glGenRenderbuffers(1, &m_pickrenderbuffer_downsampled);
+    m_gpu_timer.realize(n_render_stages);
 
     resize_buffers();
 
@@ -744,6 +862,9 @@ void Canvas::resize_buffers()
     // samples above 1 does not seem to work on macOS
     GLint samples = 1;
 #endif
+    // scaled blits need single-sampled buffers
+    if (m_reduced_quality)
+        samples = 0;
 
     glGetIntegerv(GL_RENDERBUFFER_BINDING, &rb); // save rb
     glBindRenderbuffer(GL_RENDERBUFFER, m_renderbuffer);
@@ -761,13 +882,26 @@ void Canvas::resize_buffers()
 
 ICanvas::VertexRef Canvas::add_face_group(const face::Faces &faces, glm::vec3 origin, glm::quat normal,
                                           FaceColor face_color)
+{
+    return add_face_group_instanced(faces, {glm::mat4(1)}, origin, normal, face_color);
+}
+
+ICanvas::VertexRef Canvas::add_face_group_instanced(const face::Faces &faces, const std::vector<glm::mat4> &instances,
+                                                    glm::vec3 origin, glm::quat normal, FaceColor face_color)
 {
     auto offset = m_face_index_buffer.size();
+    auto vertex_offset = m_face_vertex_buffer.size();
+    auto instance_offset = m_face_instance_buffer.size();
     add_faces(faces);
+    m_face_instance_buffer.insert(m_face_instance_buffer.end(), instances.begin(), instances.end());
     auto length = m_face_index_buffer.size() - offset;
     m_face_groups.push_back(FaceGroup{
             .offset = offset,
             .length = length,
+            .vertex_offset = vertex_offset,
+            .vertex_count = m_face_vertex_buffer.size() - vertex_offset,
+            .instance_offset = instance_offset,
+            .instance_count = instances.size(),
             .origin = origin,
             .normal = normal,
             .color = face_color,
@@ -776,23 +910,87 @@ ICanvas::VertexRef Canvas::add_face_group(const face::Faces &faces, glm::vec3 or
     return {VertexType::FACE_GROUP, m_face_groups.size() - 1};
 }
 
+ICanvas::VertexRef Canvas::add_face_group_lod(const face::Faces &faces, const face::Faces &coarse_faces,
+                                              glm::vec3 origin, glm::quat normal, FaceColor face_color)
+{
+    const auto ref = add_face_group(faces, origin, normal, face_color);
+    auto &group = m_face_groups.back();
+    group.coarse_offset = m_face_index_buffer.size();
+    add_faces(coarse_faces);
+    group.coarse_length = m_face_index_buffer.size() - group.coarse_offset;
+    group.vertex_count = m_face_vertex_buffer.size() - group.vertex_offset;
+    return ref;
+}
+
+ICanvas::VertexRef Canvas::add_face_group_persistent(std::shared_ptr<const void> owner, unsigned int part,
+                                                     const face::Faces &faces,
+                                                     const std::vector<glm::mat4> &instances, glm::vec3 origin,
+                                                     glm::quat normal, FaceColor face_color)
+{
+    const PersistentFaceMeshKey key{owner.get(), part};
+    auto &mesh = m_persistent_face_meshes[key];
+    // an expired owner means that a new one ended up at the same address
+    if (mesh.owner.expired()) {
+        mesh.owner = owner;
+        mesh.vertices.clear();
+        mesh.indices.clear();
+        add_faces(faces, mesh.vertices, mesh.indices);
+        mesh.n_vertices = mesh.vertices.size();
+        mesh.n_indices = mesh.indices.size();
+        mesh.vertices_uploaded = 0;
+        mesh.indices_uploaded = 0;
+        mesh.allocated = false;
+
+        MinMaxAccumulator<float> acc_x, acc_y, acc_z;
+        for (const auto &fv : mesh.vertices) {
+            acc_x.accumulate(fv.x);
+            acc_y.accumulate(fv.y);
+            acc_z.accumulate(fv.z);
+        }
+        mesh.bbox = {{acc_x.get_min(), acc_y.get_min(), acc_z.get_min()},
+                     {acc_x.get_max(), acc_y.get_max(), acc_z.get_max()}};
+    }
+
+    auto instance_offset = m_face_instance_buffer.size();
+    m_face_instance_buffer.insert(m_face_instance_buffer.end(), instances.begin(), instances.end());
+    m_face_groups.push_back(FaceGroup{
+            .offset = 0,
+            .length = mesh.n_indices,
+            .vertex_offset = 0,
+            .vertex_count = mesh.n_vertices,
+            .instance_offset = instance_offset,
+            .instance_count = instances.size(),
+            .origin = origin,
+            .normal = normal,
+            .color = face_color,
+            .persistent = &mesh,
+    });
+
+    return {VertexType::FACE_GROUP, m_face_groups.size() - 1};
+}
+
 void Canvas::add_faces(const face::Faces &faces)
 {
-    size_t vertex_offset = m_face_vertex_buffer.size();
+    add_faces(faces, m_face_vertex_buffer, m_face_index_buffer);
+}
+
+void Canvas::add_faces(const face::Faces &faces, std::vector<FaceVertex> &vertices, std::vector<unsigned int> &indices)
+{
+    size_t vertex_offset = vertices.size();
     for (const auto &face : faces) {
         for (size_t i = 0; i < face.vertices.size(); i++) {
             const auto &v = face.vertices.at(i);
             const auto &n = face.normals.at(i);
-            m_face_vertex_buffer.emplace_back(v.x, v.y, v.z, n.x, n.y, n.z, face.color.r * 255, face.color.g * 255,
-                                              face.color.b * 255);
+            vertices.emplace_back(v.x, v.y, v.z, n.x, n.y, n.z, face.color.r * 255, face.color.g * 255,
+                                  face.color.b * 255);
         }
 
         for (const auto &tri : face.triangle_indices) {
             size_t a, b, c;
             std::tie(a, b, c) = tri;
-            m_face_index_buffer.push_back(a + vertex_offset);
-            m_face_index_buffer.push_back(b + vertex_offset);
-            m_face_index_buffer.push_back(c + vertex_offset);
+            indices.push_back(a + vertex_offset);
+            indices.push_back(b + vertex_offset);
+            indices.push_back(c + vertex_offset);
         }
         vertex_offset += face.vertices.size();
     }
@@ -842,10 +1040,16 @@ void Canvas::update_mats()
 
 bool Canvas::on_render(const Glib::RefPtr<Gdk::GLContext> &context)
 {
-    const bool first_render = m_vertex_type_picks.size() == 0;
+    const Stopwatch frame_stopwatch;
+    const bool had_picks = m_have_picks;
 
     Gtk::GLArea::on_render(context);
 
+    while (auto result = m_gpu_timer.collect()) {
+        update_frame_time(result->total, result->tag);
+        m_stats_overlay.set_gpu_times(result->total, result->stages);
+    }
+
     if (m_needs_resize) {
         resize_buffers();
         m_needs_resize = false;
@@ -856,29 +1060,56 @@ bool Canvas::on_render(const Glib::RefPtr<Gdk::GLContext> &context)
 
     glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
 
+    // nothing can be picked while the view is moving
+    const bool skip_picks = m_navigating;
+    const int render_width = m_dev_width * m_render_scale;
+    const int render_height = m_dev_height * m_render_scale;
+    glViewport(0, 0, render_width, render_height);
+
+    m_uploaded_bytes.fill(0);
+    if (m_adaptive_quality || m_stats_overlay.get_active())
+        m_gpu_timer.begin_frame(m_reduced_quality);
+    auto end_stage = [this](RenderStage stage) { m_gpu_timer.end_stage(static_cast<size_t>(stage)); };
+
 #ifdef __APPLE__
     glDisable(GL_MULTISAMPLE);
 #endif
+    {
+        const std::array<GLenum, 2> bufs = {GL_COLOR_ATTACHMENT0, skip_picks ? GL_NONE : GL_COLOR_ATTACHMENT1};
+        glDrawBuffers(bufs.size(), bufs.data());
+    }
     glClearColor(0, 0, 0, 0);
     glClearDepth(10);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     GL_CHECK_ERROR
-    {
-        const std::array<GLenum, 2> bufs = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
-        glDrawBuffers(bufs.size(), bufs.data());
-    }
 
     glDisable(GL_DEPTH_TEST);
     m_background_renderer.render();
     glEnable(GL_DEPTH_TEST);
+    end_stage(RenderStage::BACKGROUND);
 
 
+    update_mats();
+    if (m_overlay)
+        push_overlay();
+    // sets icon flags and badges, so this needs to happen before pushing
+    if ((m_push_flags & PF_ICONS) || m_icon_declutter_mat != m_projmat * m_viewmat
+        || m_icon_declutter_size != glm::ivec2(m_dev_width, m_dev_height))
+        m_icon_declutter_pending = true;
+    // the frame rendered once navigation has settled takes care of it
+    if (m_icon_declutter_pending && !m_navigating) {
+        update_icon_declutter();
+        m_icon_declutter_pending = false;
+    }
+
     if (m_push_flags & PF_FACES)
         m_face_renderer.push();
     if (m_push_flags & PF_POINTS)
         m_point_renderer.push();
     if (m_push_flags & PF_LINES)
         m_line_renderer.push();
+    if (m_push_flags & PF_CURVES)
+        m_curve_renderer.push();
     if (m_push_flags & PF_GLYPHS)
         m_glyph_renderer.push();
     if (m_push_flags & PF_GLYPHS_3D)
@@ -887,69 +1118,95 @@ bool Canvas::on_render(const Glib::RefPtr<Gdk::GLContext> &context)
         m_icon_renderer.push();
 
     m_push_flags = PF_NONE;
+    m_push_first.fill(std::numeric_limits<size_t>::max());
 
-    update_mats();
+    m_point_renderer.push_flags();
+    m_line_renderer.push_flags();
+    m_curve_renderer.push_flags();
+    m_glyph_renderer.push_flags();
+    m_glyph_3d_renderer.push_flags();
+    m_icon_renderer.push_flags();
 
     m_pick_base = 1;
     m_face_renderer.render();
+    end_stage(RenderStage::FACES);
     GL_CHECK_ERROR
     // glColorMaski(1, GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
     m_point_renderer.render();
+    end_stage(RenderStage::POINTS);
     m_line_renderer.render();
+    end_stage(RenderStage::LINES);
+    m_curve_renderer.render();
+    end_stage(RenderStage::CURVES);
     glEnablei(GL_BLEND, 0);
     m_glyph_renderer.render();
+    end_stage(RenderStage::GLYPHS);
     m_glyph_3d_renderer.render();
+    end_stage(RenderStage::GLYPHS_3D);
     m_icon_renderer.render();
+    end_stage(RenderStage::ICONS);
+    m_have_picks = !skip_picks;
     glDisable(GL_DEPTH_TEST);
     m_box_selection.render();
     if (m_show_error_overlay)
         m_background_renderer.render_error();
+    m_stats_overlay.render();
     glEnable(GL_DEPTH_TEST);
     glDisablei(GL_BLEND, 0);
     // glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    end_stage(RenderStage::OVERLAYS);
+    m_gpu_timer.end_frame();
     GL_CHECK_ERROR
 
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo_downsampled);
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
-    glDrawBuffer(GL_COLOR_ATTACHMENT0);
-    glReadBuffer(GL_COLOR_ATTACHMENT1);
-    glBlitFramebuffer(0, 0, m_dev_width, m_dev_height, 0, 0, m_dev_width, m_dev_height, GL_COLOR_BUFFER_BIT,
-                      GL_NEAREST);
-
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo_downsampled);
-    glReadBuffer(GL_COLOR_ATTACHMENT0);
-    m_pick_buf.resize(m_dev_width * m_dev_height);
-    GL_CHECK_ERROR
-
-    glPixelStorei(GL_PACK_ALIGNMENT, 4);
-    glReadPixels(0, 0, m_dev_width, m_dev_height, GL_RED_INTEGER, GL_UNSIGNED_INT, m_pick_buf.data());
-
-    GL_CHECK_ERROR
-    if (m_pick_state == PickState::QUEUED) {
-        m_pick_state = PickState::CURRENT;
-        std::ofstream ofs(m_pick_path.string());
-        for (int y = 0; y < m_dev_height; y++) {
-            for (int x = 0; x < m_dev_width; x++) {
-                ofs << m_pick_buf.at(x + y * m_dev_width) << " ";
+    std::optional<float> pick_time;
+    if (!skip_picks) {
+        const Stopwatch pick_stopwatch;
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo_downsampled);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
+        glDrawBuffer(GL_COLOR_ATTACHMENT0);
+        glReadBuffer(GL_COLOR_ATTACHMENT1);
+        glBlitFramebuffer(0, 0, m_dev_width, m_dev_height, 0, 0, m_dev_width, m_dev_height, GL_COLOR_BUFFER_BIT,
+                          GL_NEAREST);
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo_downsampled);
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        m_pick_buf.resize(m_dev_width * m_dev_height);
+        GL_CHECK_ERROR
+
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, m_dev_width, m_dev_height, GL_RED_INTEGER, GL_UNSIGNED_INT, m_pick_buf.data());
+        pick_time = pick_stopwatch.get_ms();
+
+        GL_CHECK_ERROR
+        if (m_pick_state == PickState::QUEUED) {
+            m_pick_state = PickState::CURRENT;
+            std::ofstream ofs(m_pick_path.string());
+            for (int y = 0; y < m_dev_height; y++) {
+                for (int x = 0; x < m_dev_width; x++) {
+                    ofs << m_pick_buf.at(x + y * m_dev_width) << " ";
+                }
+                ofs << std::endl;
             }
-            ofs << std::endl;
         }
     }
     glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fb);
     glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
     glDrawBuffer(fb ? GL_COLOR_ATTACHMENT0 : GL_FRONT);
     glReadBuffer(GL_COLOR_ATTACHMENT0);
-    glBlitFramebuffer(0, 0, m_dev_width, m_dev_height, 0, 0, m_dev_width, m_dev_height, GL_COLOR_BUFFER_BIT,
-                      GL_NEAREST);
+    glBlitFramebuffer(0, 0, render_width, render_height, 0, 0, m_dev_width, m_dev_height, GL_COLOR_BUFFER_BIT,
+                      m_reduced_quality ? GL_LINEAR : GL_NEAREST);
 
     glBindFramebuffer(GL_FRAMEBUFFER, fb);
+    glViewport(0, 0, m_dev_width, m_dev_height);
     GL_CHECK_ERROR
     glFlush();
 
-    if (first_render) {
+    if (m_have_picks && !had_picks) {
         update_hover_selection();
     }
 
+    m_stats_overlay.add_frame(frame_stopwatch.get_ms(), pick_time);
+
     return true;
 }
 
@@ -977,6 +1234,7 @@ void Canvas::on_resize(int width, int height)
 void Canvas::request_push()
 {
     m_push_flags = PF_ALL;
+    m_push_first.fill(0);
     queue_draw();
 }
 
@@ -991,22 +1249,145 @@ void Canvas::clear()
 {
     m_face_index_buffer.clear();
     m_face_vertex_buffer.clear();
+    m_face_instance_buffer.clear();
     m_face_groups.clear();
     m_points.clear();
     m_points_selection_invisible.clear();
     m_lines.clear();
     m_lines_selection_invisible.clear();
+    m_curves.clear();
+    m_curves_selection_invisible.clear();
     m_glyphs.clear();
     m_glyphs_3d.clear();
     m_icons.clear();
     m_icons_selection_invisible.clear();
-    m_selectable_to_vertex_map.clear();
-    m_vertex_to_selectable_map.clear();
-    m_vertex_type_picks.clear();
+    for (size_t i = 0; i < m_selectables.size(); i++)
+        m_selectable_vertices[i].clear();
+    m_selectables.clear();
+    m_selectable_ids.clear();
+    for (auto &ids : m_vertex_selectables)
+        ids.clear();
+    m_vertex_type_picks.fill({});
+    m_have_picks = false;
+    for (auto &changed : m_changed_flags)
+        changed.clear();
+    m_overlay.reset();
+    m_overlay_shared_selectables.clear();
+    m_overlay_cleared = false;
     m_push_flags = PF_ALL;
+    m_push_first.fill(0);
     queue_draw();
 }
 
+std::array<size_t, Canvas::n_vertex_types> Canvas::get_vertex_counts() const
+{
+    std::array<size_t, n_vertex_types> r = {};
+    r.at(static_cast<size_t>(VertexType::POINT)) = m_points.size();
+    r.at(static_cast<size_t>(VertexType::LINE)) = m_lines.size();
+    r.at(static_cast<size_t>(VertexType::CURVE)) = m_curves.size();
+    r.at(static_cast<size_t>(VertexType::GLYPH)) = m_glyphs.size();
+    r.at(static_cast<size_t>(VertexType::GLYPH_3D)) = m_glyphs_3d.size();
+    r.at(static_cast<size_t>(VertexType::ICON)) = m_icons.size();
+    r.at(static_cast<size_t>(VertexType::FACE_GROUP)) = m_face_groups.size();
+    return r;
+}
+
+std::array<size_t, Canvas::n_vertex_types> Canvas::get_vertex_counts_selection_invisible() const
+{
+    std::array<size_t, n_vertex_types> r = {};
+    r.at(static_cast<size_t>(VertexType::POINT)) = m_points_selection_invisible.size();
+    r.at(static_cast<size_t>(VertexType::LINE)) = m_lines_selection_invisible.size();
+    r.at(static_cast<size_t>(VertexType::CURVE)) = m_curves_selection_invisible.size();
+    r.at(static_cast<size_t>(VertexType::ICON)) = m_icons_selection_invisible.size();
+    return r;
+}
+
+void Canvas::begin_overlay()
+{
+    m_overlay = OverlayMarks{
+            .vertices = get_vertex_counts(),
+            .vertices_selection_invisible = get_vertex_counts_selection_invisible(),
+            .selectables = m_selectables.size(),
+    };
+    m_overlay_shared_selectables.clear();
+}
+
+void Canvas::clear_overlay()
+{
+    if (!m_overlay)
+        return;
+    const auto &marks = m_overlay->vertices;
+    const auto &marks_si = m_overlay->vertices_selection_invisible;
+    // only vertex types that lost vertices need to be pushed for that
+    PushFlags push_flags = PF_NONE;
+    auto truncate = [&push_flags](auto &vertices, size_t n, PushFlags flag) {
+        if (vertices.size() > n) {
+            vertices.erase(vertices.begin() + n, vertices.end());
+            push_flags = static_cast<PushFlags>(push_flags | flag);
+        }
+    };
+    auto mark = [&marks](VertexType type) { return marks.at(static_cast<size_t>(type)); };
+    auto mark_si = [&marks_si](VertexType type) { return marks_si.at(static_cast<size_t>(type)); };
+    truncate(m_points, mark(VertexType::POINT), PF_POINTS);
+    truncate(m_points_selection_invisible, mark_si(VertexType::POINT), PF_POINTS);
+    truncate(m_lines, mark(VertexType::LINE), PF_LINES);
+    truncate(m_lines_selection_invisible, mark_si(VertexType::LINE), PF_LINES);
+    truncate(m_curves, mark(VertexType::CURVE), PF_CURVES);
+    truncate(m_curves_selection_invisible, mark_si(VertexType::CURVE), PF_CURVES);
+    truncate(m_glyphs, mark(VertexType::GLYPH), PF_GLYPHS);
+    truncate(m_glyphs_3d, mark(VertexType::GLYPH_3D), PF_GLYPHS_3D);
+    truncate(m_icons, mark(VertexType::ICON), PF_ICONS);
+    truncate(m_icons_selection_invisible, mark_si(VertexType::ICON), PF_ICONS);
+    if (m_face_groups.size() != mark(VertexType::FACE_GROUP))
+        throw std::runtime_error("face groups can't be part of the overlay");
+
+    for (const auto id : m_overlay_shared_selectables) {
+        std::erase_if(m_selectable_vertices.at(id),
+                      [&mark](const VertexRef &vref) { return vref.index >= mark(vref.type); });
+    }
+    m_overlay_shared_selectables.clear();
+    for (size_t id = m_overlay->selectables; id < m_selectables.size(); id++) {
+        m_selectable_ids.erase(m_selectables.at(id));
+        m_selectable_vertices.at(id).clear();
+    }
+    truncate(m_selectables, m_overlay->selectables);
+
+    for (size_t type = 0; type < n_vertex_types; type++) {
+        auto &ids = m_vertex_selectables.at(type);
+        ids.resize(std::min(ids.size(), marks.at(type)));
+        std::erase_if(m_changed_flags.at(type), [&marks, type](size_t i) { return i >= marks.at(type); });
+        m_push_first.at(type) = std::min(m_push_first.at(type), marks.at(type));
+    }
+
+    // picks of vertices that are gone don't find a selectable anymore and
+    // the next frame renders new ones, so the pick buffer can stay
+    m_push_flags = static_cast<PushFlags>(m_push_flags | push_flags);
+    m_overlay_cleared = true;
+    queue_draw();
+}
+
+void Canvas::push_overlay()
+{
+    if (!m_overlay_cleared)
+        return;
+    m_overlay_cleared = false;
+    const auto counts = get_vertex_counts();
+    const auto counts_si = get_vertex_counts_selection_invisible();
+    const std::array<std::pair<VertexType, PushFlags>, 6> types = {{
+            {VertexType::POINT, PF_POINTS},
+            {VertexType::LINE, PF_LINES},
+            {VertexType::CURVE, PF_CURVES},
+            {VertexType::GLYPH, PF_GLYPHS},
+            {VertexType::GLYPH_3D, PF_GLYPHS_3D},
+            {VertexType::ICON, PF_ICONS},
+    }};
+    for (const auto &[type, flag] : types) {
+        const auto i = static_cast<size_t>(type);
+        if (counts.at(i) > m_overlay->vertices.at(i) || counts_si.at(i) > m_overlay->vertices_selection_invisible.at(i))
+            m_push_flags = static_cast<PushFlags>(m_push_flags | flag);
+    }
+}
+
 ICanvas::VertexRef Canvas::draw_point(glm::vec3 p)
 {
     auto &pts = m_selection_invisible ? m_points_selection_invisible : m_points;
@@ -1040,6 +1421,17 @@ ICanvas::VertexRef Canvas::draw_screen_line(glm::vec3 a, glm::vec3 b)
     return {VertexType::LINE, m_lines.size() - 1};
 }
 
+ICanvas::VertexRef Canvas::draw_arc(glm::vec3 center, float radius, glm::vec3 u, glm::vec3 v, float a0, float a1)
+{
+    auto &curves = m_selection_invisible ? m_curves_selection_invisible : m_curves;
+    auto &cu = curves.emplace_back(center, radius, u, v, a0, a1);
+    apply_flags(cu.flags);
+
+    if (m_selection_invisible)
+        return {VertexType::SELECTION_INVISIBLE, 0};
+    return {VertexType::CURVE, m_curves.size() - 1};
+}
+
 void Canvas::apply_flags(VertexFlags &flags)
 {
     if (m_vertex_inactive)
@@ -1052,15 +1444,22 @@ void Canvas::apply_flags(VertexFlags &flags)
 
 static const float char_space = 1;
 
-static uint32_t pack_bits(const bitmap_font::GlyphInfo &info)
+std::vector<ICanvas::VertexRef> Canvas::draw_bitmap_text(const glm::vec3 p, float size, const std::string &rtext)
 {
-    return (info.get_h() & 0x3f) | ((info.get_w() & 0x3f) << 6) | ((info.get_y() & 0x3ff) << 12)
-           | ((info.get_x() & 0x3ff) << 22);
+    const auto first = m_glyphs.size();
+    append_bitmap_text(m_glyphs, p, size, rtext);
+
+    std::vector<ICanvas::VertexRef> vrefs;
+    for (size_t i = first; i < m_glyphs.size(); i++) {
+        apply_flags(m_glyphs.at(i).flags);
+        vrefs.push_back({VertexType::GLYPH, i});
+    }
+    return vrefs;
 }
 
-std::vector<ICanvas::VertexRef> Canvas::draw_bitmap_text(const glm::vec3 p, float size, const std::string &rtext)
+void Canvas::append_bitmap_text(std::vector<GlyphVertex> &glyphs, const glm::vec3 &p, float size,
+                                const std::string &rtext)
 {
-    std::vector<ICanvas::VertexRef> vrefs;
     Glib::ustring text(rtext);
     float sc = size * .75;
 
@@ -1074,17 +1473,13 @@ std::vector<ICanvas::VertexRef> Canvas::draw_bitmap_text(const glm::vec3 p, floa
                 info = bitmap_font::get_glyph_info('?');
             }
 
-            const uint32_t bits = pack_bits(info);
+            const uint32_t bits = info.pack_bits();
 
             glm::vec2 shift(info.minx, -info.miny);
 
             auto ps = point + shift * sc;
 
-            auto &gl = m_glyphs.emplace_back(p.x, p.y, p.z, ps.x, ps.y, sc, bits);
-            apply_flags(gl.flags);
-
-
-            vrefs.push_back({VertexType::GLYPH, m_glyphs.size() - 1});
+            glyphs.emplace_back(p.x, p.y, p.z, ps.x, ps.y, sc, bits);
 
             point += v * (info.advance * char_space * sc);
         }
@@ -1092,9 +1487,6 @@ std::vector<ICanvas::VertexRef> Canvas::draw_bitmap_text(const glm::vec3 p, floa
             point += v * (7 * char_space * sc);
         }
     }
-
-
-    return vrefs;
 }
 
 std::vector<ICanvas::VertexRef> Canvas::draw_bitmap_text_3d(const glm::vec3 p, const glm::quat &norm, float size,
@@ -1117,7 +1509,7 @@ std::vector<ICanvas::VertexRef> Canvas::draw_bitmap_text_3d(const glm::vec3 p, c
                 info = bitmap_font::get_glyph_info('?');
             }
 
-            const uint32_t bits = pack_bits(info);
+            const uint32_t bits = info.pack_bits();
 
             const glm::vec3 shift(info.minx, info.miny, 0);
 
@@ -1151,13 +1543,103 @@ ICanvas::VertexRef Canvas::draw_icon(IconTexture::IconTextureID id, glm::vec3 or
     return {VertexType::ICON, m_icons.size() - 1};
 }
 
+// icons get collapsed into a badge if there are more than icon_declutter_max
+// of them in a square on screen that's icon_declutter_cell icons wide
+static const float icon_declutter_cell = 4;
+static const size_t icon_declutter_max = 16;
+
+void Canvas::update_icon_declutter()
+{
+    m_icon_declutter_mat = m_projmat * m_viewmat;
+    m_icon_declutter_size = {m_dev_width, m_dev_height};
+    if (m_icons.empty() && m_icon_badges.empty())
+        return;
+
+    struct Cell {
+        size_t count = 0;
+        size_t first_icon = 0;
+    };
+    std::unordered_map<uint64_t, Cell> cells;
+    static constexpr uint64_t no_cell = std::numeric_limits<uint64_t>::max();
+    std::vector<uint64_t> icon_cells(m_icons.size(), no_cell);
+
+    const float cell_size = IconTexture::icon_size * m_scale_factor * icon_declutter_cell;
+    for (size_t i = 0; i < m_icons.size(); i++) {
+        const auto &icon = m_icons.at(i);
+        const auto p = m_icon_declutter_mat * glm::vec4(icon.x0, icon.y0, icon.z0, 1);
+        if (p.w <= 0)
+            continue;
+        const float x = (p.x / p.w + 1) / 2 * m_dev_width / cell_size;
+        const float y = (p.y / p.w + 1) / 2 * m_dev_height / cell_size;
+        // far off screen or not a number
+        if (!(std::abs(x) < 1e6 && std::abs(y) < 1e6))
+            continue;
+        // negative cells are left of or below the viewport, go through int32_t
+        // since converting a negative float to an unsigned type is undefined
+        const auto cx = static_cast<uint32_t>(static_cast<int32_t>(std::floor(x)));
+        const auto cy = static_cast<uint32_t>(static_cast<int32_t>(std::floor(y)));
+        const auto key = (static_cast<uint64_t>(cx) << 32) | cy;
+        auto &cell = cells[key];
+        if (cell.count == 0)
+            cell.first_icon = i;
+        cell.count++;
+        icon_cells.at(i) = key;
+    }
+
+    m_icon_badges.clear();
+    auto &changed = m_changed_flags.at(static_cast<size_t>(VertexType::ICON));
+    for (size_t i = 0; i < m_icons.size(); i++) {
+        bool hide = false;
+        if (icon_cells.at(i) != no_cell) {
+            const auto &cell = cells.at(icon_cells.at(i));
+            hide = cell.count > icon_declutter_max;
+            if (hide && cell.first_icon == i) {
+                const auto &icon = m_icons.at(i);
+                const auto first_badge = m_icon_badges.size();
+                append_bitmap_text(m_icon_badges, {icon.x0, icon.y0, icon.z0}, 1, std::to_string(cell.count));
+                for (size_t j = first_badge; j < m_icon_badges.size(); j++)
+                    m_icon_badges.at(j).flags = VertexFlags::CONSTRAINT;
+            }
+        }
+        auto &flags = m_icons.at(i).flags;
+        const bool hidden = (flags & VertexFlags::HIDDEN) != VertexFlags::DEFAULT;
+        if (hide == hidden)
+            continue;
+        if (hide)
+            flags |= VertexFlags::HIDDEN;
+        else
+            flags &= ~VertexFlags::HIDDEN;
+        changed.push_back(i);
+    }
+
+    // only the badges after the regular glyphs need to be uploaded
+    const auto glyph_type = static_cast<size_t>(VertexType::GLYPH);
+    m_push_first.at(glyph_type) = std::min(m_push_first.at(glyph_type), m_glyphs.size());
+    m_push_flags = static_cast<PushFlags>(m_push_flags | PF_GLYPHS);
+}
+
 
 void Canvas::add_selectable(const VertexRef &vref, const SelectableRef &sref)
 {
     if (vref.type == VertexType::SELECTION_INVISIBLE)
         return;
-    m_vertex_to_selectable_map.emplace(vref, sref);
-    m_selectable_to_vertex_map[sref].push_back(vref);
+    const auto [it, inserted] = m_selectable_ids.try_emplace(sref, m_selectables.size());
+    const auto id = it->second;
+    if (inserted) {
+        m_selectables.push_back(sref);
+        if (m_selectable_vertices.size() < m_selectables.size())
+            m_selectable_vertices.emplace_back();
+    }
+    m_selectable_vertices[id].push_back(vref);
+    if (m_overlay && id < m_overlay->selectables
+        && vref.index >= m_overlay->vertices.at(static_cast<size_t>(vref.type)))
+        m_overlay_shared_selectables.push_back(id);
+
+    auto &ids = m_vertex_selectables.at(static_cast<size_t>(vref.type));
+    if (ids.size() <= vref.index)
+        ids.resize(vref.index + 1, no_selectable);
+    if (ids[vref.index] == no_selectable)
+        ids[vref.index] = id;
 }
 
 Canvas::VertexFlags &Canvas::get_vertex_flags(const VertexRef &vref)
@@ -1166,6 +1648,9 @@ Canvas::VertexFlags &Canvas::get_vertex_flags(const VertexRef &vref)
     case VertexType::LINE:
         return m_lines.at(vref.index).flags;
 
+    case VertexType::CURVE:
+        return m_curves.at(vref.index).flags;
+
     case VertexType::POINT:
         return m_points.at(vref.index).flags;
 
@@ -1186,6 +1671,16 @@ Canvas::VertexFlags &Canvas::get_vertex_flags(const VertexRef &vref)
     }
 }
 
+void Canvas::set_vertex_flags(const VertexRef &vref, VertexFlags flags)
+{
+    auto &vertex_flags = get_vertex_flags(vref);
+    if ((vertex_flags & flags) == flags)
+        return;
+    vertex_flags |= flags;
+    if (vref.type != VertexType::FACE_GROUP)
+        m_changed_flags.at(static_cast<size_t>(vref.type)).push_back(vref.index);
+}
+
 void Canvas::set_selection(const std::set<SelectableRef> &sel, bool emit)
 {
     set_flag_for_selectables(sel, VertexFlags::SELECTED);
@@ -1202,16 +1697,13 @@ void Canvas::set_flag_for_selectables(const std::set<SelectableRef> &sel, Vertex
 {
     clear_flags(flag);
     for (auto &sr : sel) {
-        if (!m_selectable_to_vertex_map.contains(sr))
+        const auto vrefs = find_vertices(sr);
+        if (!vrefs)
             continue;
-        auto &vrefs = m_selectable_to_vertex_map.at(sr);
-        for (const auto &vref : vrefs) {
-            auto &flags = get_vertex_flags(vref);
-            flags |= flag;
+        for (const auto &vref : *vrefs) {
+            set_vertex_flags(vref, flag);
         }
-        // auto &flags = get_vertex_flags()
     }
-    m_push_flags = static_cast<PushFlags>(m_push_flags | PF_LINES | PF_POINTS | PF_GLYPHS | PF_GLYPHS_3D | PF_ICONS);
     queue_draw();
 }
 
@@ -1219,12 +1711,11 @@ void Canvas::set_hover_selection(const std::optional<SelectableRef> &sr)
 {
     if (!sr.has_value())
         return;
-    if (!m_selectable_to_vertex_map.contains(*sr))
+    const auto vrefs = find_vertices(*sr);
+    if (!vrefs)
         return;
-    auto &vrefs = m_selectable_to_vertex_map.at(*sr);
-    for (const auto &vref : vrefs) {
-        auto &flags = get_vertex_flags(vref);
-        flags |= VertexFlags::HOVER;
+    for (const auto &vref : *vrefs) {
+        set_vertex_flags(vref, VertexFlags::HOVER);
     }
 }
 
@@ -1234,43 +1725,50 @@ std::set<SelectableRef> Canvas::get_selection() const
     for (size_t i = 0; i < m_lines.size(); i++) {
         if ((m_lines.at(i).flags & VertexFlags::SELECTED) != VertexFlags::DEFAULT) {
             const VertexRef vref{.type = VertexType::LINE, .index = i};
-            if (m_vertex_to_selectable_map.count(vref))
-                r.insert(m_vertex_to_selectable_map.at(vref));
+            if (auto sr = find_selectable(vref))
+                r.insert(*sr);
+        }
+    }
+    for (size_t i = 0; i < m_curves.size(); i++) {
+        if ((m_curves.at(i).flags & VertexFlags::SELECTED) != VertexFlags::DEFAULT) {
+            const VertexRef vref{.type = VertexType::CURVE, .index = i};
+            if (auto sr = find_selectable(vref))
+                r.insert(*sr);
         }
     }
     for (size_t i = 0; i < m_points.size(); i++) {
         if ((m_points.at(i).flags & VertexFlags::SELECTED) != VertexFlags::DEFAULT) {
             const VertexRef vref{.type = VertexType::POINT, .index = i};
-            if (m_vertex_to_selectable_map.count(vref))
-                r.insert(m_vertex_to_selectable_map.at(vref));
+            if (auto sr = find_selectable(vref))
+                r.insert(*sr);
         }
     }
     for (size_t i = 0; i < m_glyphs.size(); i++) {
         if ((m_glyphs.at(i).flags & VertexFlags::SELECTED) != VertexFlags::DEFAULT) {
             const VertexRef vref{.type = VertexType::GLYPH, .index = i};
-            if (m_vertex_to_selectable_map.count(vref))
-                r.insert(m_vertex_to_selectable_map.at(vref));
+            if (auto sr = find_selectable(vref))
+                r.insert(*sr);
         }
     }
     for (size_t i = 0; i < m_glyphs_3d.size(); i++) {
         if ((m_glyphs_3d.at(i).flags & VertexFlags::SELECTED) != VertexFlags::DEFAULT) {
             const VertexRef vref{.type = VertexType::GLYPH_3D, .index = i};
-            if (m_vertex_to_selectable_map.count(vref))
-                r.insert(m_vertex_to_selectable_map.at(vref));
+            if (auto sr = find_selectable(vref))
+                r.insert(*sr);
         }
     }
     for (size_t i = 0; i < m_face_groups.size(); i++) {
         if ((m_face_groups.at(i).flags & VertexFlags::SELECTED) != VertexFlags::DEFAULT) {
             const VertexRef vref{.type = VertexType::FACE_GROUP, .index = i};
-            if (m_vertex_to_selectable_map.count(vref))
-                r.insert(m_vertex_to_selectable_map.at(vref));
+            if (auto sr = find_selectable(vref))
+                r.insert(*sr);
         }
     }
     for (size_t i = 0; i < m_icons.size(); i++) {
         if ((m_icons.at(i).flags & VertexFlags::SELECTED) != VertexFlags::DEFAULT) {
             const VertexRef vref{.type = VertexType::ICON, .index = i};
-            if (m_vertex_to_selectable_map.count(vref))
-                r.insert(m_vertex_to_selectable_map.at(vref));
+            if (auto sr = find_selectable(vref))
+                r.insert(*sr);
         }
     }
     return r;
@@ -1287,8 +1785,6 @@ void Canvas::set_selection_mode(SelectionMode mode)
     }
     else if (m_selection_mode == SelectionMode::NONE) {
         clear_flags(VertexFlags::SELECTED | VertexFlags::HOVER);
-        m_push_flags =
-                static_cast<PushFlags>(m_push_flags | PF_LINES | PF_POINTS | PF_GLYPHS | PF_GLYPHS_3D | PF_ICONS);
         queue_draw();
     }
     m_signal_selection_mode_changed.emit();
@@ -1301,6 +1797,14 @@ void Canvas::set_appearance(const Appearance &appearance)
     queue_draw();
 }
 
+void Canvas::set_primitive_mode(PrimitiveMode mode)
+{
+    if (m_primitive_mode == mode)
+        return;
+    m_primitive_mode = mode;
+    queue_draw();
+}
+
 void Canvas::set_clipping_planes(const ClippingPlanes &planes)
 {
     m_clipping_planes = planes;
@@ -1328,6 +1832,7 @@ static float cam_dist_from_anim(float d)
 
 int Canvas::animate_step(GdkFrameClock *frame_clock)
 {
+    navigation_step();
     bool stop = true;
     for (auto anim : m_animators) {
         if (anim->step(gdk_frame_clock_get_frame_time(frame_clock) / 1e6))
@@ -1395,10 +1900,53 @@ void Canvas::update_bbox()
         acc_z.accumulate(li.z1);
         acc_z.accumulate(li.z2);
     }
-    for (const auto &fv : m_face_vertex_buffer) {
-        acc_x.accumulate(fv.x);
-        acc_y.accumulate(fv.y);
-        acc_z.accumulate(fv.z);
+    for (const auto &cu : m_curves) {
+        // extent of the full circle along each axis
+        const auto ex = cu.radius * std::hypot(cu.ux, cu.vx);
+        const auto ey = cu.radius * std::hypot(cu.uy, cu.vy);
+        const auto ez = cu.radius * std::hypot(cu.uz, cu.vz);
+        acc_x.accumulate(cu.x - ex);
+        acc_x.accumulate(cu.x + ex);
+        acc_y.accumulate(cu.y - ey);
+        acc_y.accumulate(cu.y + ey);
+        acc_z.accumulate(cu.z - ez);
+        acc_z.accumulate(cu.z + ez);
+    }
+    for (const auto &group : m_face_groups) {
+        if (group.vertex_count == 0)
+            continue;
+
+        std::pair<glm::vec3, glm::vec3> bbox;
+        if (group.persistent) {
+            bbox = group.persistent->bbox;
+        }
+        else {
+            MinMaxAccumulator<float> lacc_x, lacc_y, lacc_z;
+            for (size_t i = group.vertex_offset; i < group.vertex_offset + group.vertex_count; i++) {
+                const auto &fv = m_face_vertex_buffer.at(i);
+                lacc_x.accumulate(fv.x);
+                lacc_y.accumulate(fv.y);
+                lacc_z.accumulate(fv.z);
+            }
+            bbox = {{lacc_x.get_min(), lacc_y.get_min(), lacc_z.get_min()},
+                    {lacc_x.get_max(), lacc_y.get_max(), lacc_z.get_max()}};
+        }
+
+        // transforming every vertex of every instance would be wasteful,
+        // the corners of the untransformed bounding box are good enough
+        for (size_t inst = group.instance_offset; inst < group.instance_offset + group.instance_count; inst++) {
+            const auto &mat = m_face_instance_buffer.at(inst);
+            for (const auto x : {bbox.first.x, bbox.second.x}) {
+                for (const auto y : {bbox.first.y, bbox.second.y}) {
+                    for (const auto z : {bbox.first.z, bbox.second.z}) {
+                        const auto p = mat * glm::vec4(x, y, z, 1);
+                        acc_x.accumulate(p.x);
+                        acc_y.accumulate(p.y);
+                        acc_z.accumulate(p.z);
+                    }
+                }
+            }
+        }
     }
     m_bbox.first = {acc_x.get_min(), acc_y.get_min(), acc_z.get_min()};
     m_bbox.second = {acc_x.get_max(), acc_y.get_max(), acc_z.get_max()};
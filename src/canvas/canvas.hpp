@@ -4,10 +4,13 @@
 #include "face_renderer.hpp"
 #include "point_renderer.hpp"
 #include "line_renderer.hpp"
+#include "curve_renderer.hpp"
 #include "glyph_renderer.hpp"
 #include "glyph_3d_renderer.hpp"
 #include "icon_renderer.hpp"
 #include "box_selection.hpp"
+#include "stats_overlay.hpp"
+#include "gpu_timer.hpp"
 #include "icanvas.hpp"
 #include "selection_mode.hpp"
 #include "color.hpp"
@@ -18,8 +21,12 @@
 #include "util/msd_animator.hpp"
 #include "clipping_planes.hpp"
 #include "rotation_scheme.hpp"
+#include "primitive_mode.hpp"
 #include <glm/glm.hpp>
 #include <filesystem>
+#include <array>
+#include <limits>
+#include <unordered_map>
 
 namespace dune3d {
 
@@ -31,21 +38,33 @@ public:
     friend FaceRenderer;
     friend PointRenderer;
     friend LineRenderer;
+    friend CurveRenderer;
     friend GlyphRenderer;
     friend Glyph3DRenderer;
     friend IconRenderer;
     friend BaseRenderer;
     friend struct UBOBuffer;
     friend BoxSelection;
+    friend StatsOverlay;
     Canvas();
 
     void request_push();
     void queue_pick(const std::filesystem::path &pick_path);
 
     void clear() override;
+    void begin_overlay() override;
+    // Removes what's been drawn since begin_overlay() so that the overlay can
+    // be drawn again without redrawing and uploading everything below it.
+    // Face groups can't be part of the overlay.
+    void clear_overlay();
+    bool has_overlay() const
+    {
+        return m_overlay.has_value();
+    }
     VertexRef draw_point(glm::vec3 p) override;
     VertexRef draw_line(glm::vec3 from, glm::vec3 to) override;
     VertexRef draw_screen_line(glm::vec3 origin, glm::vec3 direction) override;
+    VertexRef draw_arc(glm::vec3 center, float radius, glm::vec3 u, glm::vec3 v, float a0, float a1) override;
     std::vector<VertexRef> draw_bitmap_text(const glm::vec3 p, float size, const std::string &rtext) override;
     std::vector<VertexRef> draw_bitmap_text_3d(const glm::vec3 p, const glm::quat &norm, float size,
                                                const std::string &rtext) override;
@@ -65,6 +84,13 @@ public:
 
     VertexRef add_face_group(const face::Faces &faces, glm::vec3 origin, glm::quat normal,
                              FaceColor face_color) override;
+    VertexRef add_face_group_instanced(const face::Faces &faces, const std::vector<glm::mat4> &instances,
+                                       glm::vec3 origin, glm::quat normal, FaceColor face_color) override;
+    VertexRef add_face_group_lod(const face::Faces &faces, const face::Faces &coarse_faces, glm::vec3 origin,
+                                 glm::quat normal, FaceColor face_color) override;
+    VertexRef add_face_group_persistent(std::shared_ptr<const void> owner, unsigned int part,
+                                        const face::Faces &faces, const std::vector<glm::mat4> &instances,
+                                        glm::vec3 origin, glm::quat normal, FaceColor face_color) override;
 
     VertexRef draw_icon(IconTexture::IconTextureID id, glm::vec3 origin, glm::vec2 shift, glm::vec3 v) override;
 
@@ -190,6 +216,21 @@ public:
         m_rotation_scheme = scheme;
     }
 
+    void set_primitive_mode(PrimitiveMode mode);
+
+    // render with less samples and at lower resolution while navigating if
+    // frames take longer than the target
+    void set_adaptive_quality(bool enable, float frame_time_target_ms);
+    bool get_adaptive_quality() const override
+    {
+        return m_adaptive_quality;
+    }
+
+    void set_show_stats_overlay(bool show);
+    // shown in the statistics overlay
+    void set_stats_timing(const std::string &label, float ms);
+    void set_stats_cache(const std::string &label, const StatsOverlay::CacheStats &stats);
+
     void set_show_error_overlay(bool show);
 
     void setup_controllers();
@@ -201,10 +242,12 @@ private:
     FaceRenderer m_face_renderer;
     PointRenderer m_point_renderer;
     LineRenderer m_line_renderer;
+    CurveRenderer m_curve_renderer;
     GlyphRenderer m_glyph_renderer;
     Glyph3DRenderer m_glyph_3d_renderer;
     IconRenderer m_icon_renderer;
     BoxSelection m_box_selection;
+    StatsOverlay m_stats_overlay;
     unsigned int m_pick_base = 1;
 
     Appearance m_appearance;
@@ -235,6 +278,7 @@ private:
 
     std::vector<FaceVertex> m_face_vertex_buffer;  // vertices of all models, sequentially
     std::vector<unsigned int> m_face_index_buffer; // indexes face_vertex_buffer to form triangles
+    std::vector<glm::mat4> m_face_instance_buffer; // transforms of all face group instances
 
     glm::mat4 m_viewmat;
     glm::mat4 m_projmat;
@@ -244,6 +288,20 @@ private:
 
     void update_mats();
 
+    bool m_adaptive_quality = false;
+    float m_frame_time_target = 20; // ms
+    bool m_navigating = false;
+    // buffers are single-sampled and only m_render_scale of them is used
+    bool m_reduced_quality = false;
+    float m_render_scale = 1;
+    float m_full_quality_frame_time = 0;
+    sigc::connection m_settle_connection;
+    void navigation_step();
+    bool settle_navigation();
+    void update_frame_time(float frame_time, bool reduced);
+
+    GPUTimer m_gpu_timer;
+
     glm::dvec2 m_cursor_pos;
 
     enum class PickState { QUEUED, CURRENT, INVALID };
@@ -270,6 +328,7 @@ private:
         PF_GLYPHS = (1 << 3),
         PF_GLYPHS_3D = (1 << 4),
         PF_ICONS = (1 << 5),
+        PF_CURVES = (1 << 6),
         PF_ALL = 0xff,
     };
     PushFlags m_push_flags = PF_ALL;
@@ -348,6 +407,7 @@ private:
         CONSTRUCTION = (1 << 4),
         HIGHLIGHT = (1 << 5),
         SCREEN = (1 << 6),
+        HIDDEN = (1 << 7), // set on icons collapsed into a badge
         COLOR_MASK = SELECTED | HOVER | INACTIVE | CONSTRAINT | CONSTRUCTION | HIGHLIGHT,
     };
     bool m_vertex_inactive = false;
@@ -399,6 +459,38 @@ private:
     size_t m_n_lines = 0;
     size_t m_n_lines_selection_invisible = 0;
 
+    // one vertex per arc, the geometry shader turns it into line segments
+    class CurveVertex {
+    public:
+        CurveVertex(glm::vec3 c, float r, glm::vec3 au, glm::vec3 av, float aa0, float aa1)
+            : x(c.x), y(c.y), z(c.z), radius(r), ux(au.x), uy(au.y), uz(au.z), vx(av.x), vy(av.y), vz(av.z), a0(aa0),
+              a1(aa1)
+        {
+        }
+        float x;
+        float y;
+        float z;
+        float radius;
+
+        float ux;
+        float uy;
+        float uz;
+
+        float vx;
+        float vy;
+        float vz;
+
+        float a0;
+        float a1;
+
+        VertexFlags flags = VertexFlags::DEFAULT;
+    };
+
+    std::vector<CurveVertex> m_curves;
+    std::vector<CurveVertex> m_curves_selection_invisible;
+    size_t m_n_curves = 0;
+    size_t m_n_curves_selection_invisible = 0;
+
     bool m_selection_invisible = false;
 
     class GlyphVertex {
@@ -465,34 +557,124 @@ private:
     size_t m_n_icons = 0;
     size_t m_n_icons_selection_invisible = 0;
 
+    // Icons crowding the same spot on screen, such as when zoomed out of a
+    // heavily constrained sketch, get hidden and replaced by a badge showing
+    // their count. The badges get drawn by the glyph renderer after the
+    // regular glyphs and are redone whenever the view or the icons change.
+    std::vector<GlyphVertex> m_icon_badges;
+    size_t m_n_icon_badges = 0;
+    glm::mat4 m_icon_declutter_mat = glm::mat4(0);
+    glm::ivec2 m_icon_declutter_size = {0, 0};
+    bool m_icon_declutter_pending = false;
+    void update_icon_declutter();
+    static void append_bitmap_text(std::vector<GlyphVertex> &glyphs, const glm::vec3 &p, float size,
+                                   const std::string &rtext);
+
     void clear_flags(VertexFlags flags);
 
     void add_faces(const face::Faces &faces);
+    void add_faces(const face::Faces &faces, std::vector<FaceVertex> &vertices, std::vector<unsigned int> &indices);
+
+    // faces kept in their own GPU buffers across updates, these get
+    // uploaded in chunks over multiple frames by the face renderer
+    class PersistentFaceMesh {
+    public:
+        std::weak_ptr<const void> owner;
+        std::vector<FaceVertex> vertices; // released once uploaded
+        std::vector<unsigned int> indices;
+        size_t n_vertices = 0;
+        size_t n_indices = 0;
+        size_t vertices_uploaded = 0;
+        size_t indices_uploaded = 0;
+        std::pair<glm::vec3, glm::vec3> bbox;
+
+        GLuint vao = 0;
+        GLuint vbo = 0;
+        GLuint ebo = 0;
+        bool allocated = false;
+
+        bool is_complete() const
+        {
+            return vertices_uploaded == n_vertices && indices_uploaded == n_indices;
+        }
+    };
+    using PersistentFaceMeshKey = std::pair<const void *, unsigned int>;
+    std::map<PersistentFaceMeshKey, PersistentFaceMesh> m_persistent_face_meshes;
+
     class FaceGroup {
     public:
         size_t offset;
         size_t length;
+        size_t vertex_offset;
+        size_t vertex_count;
+        size_t instance_offset;
+        size_t instance_count;
         glm::vec3 origin;
         glm::quat normal;
         FaceColor color;
+        // drawn instead of offset and length while navigating if set
+        size_t coarse_offset = 0;
+        size_t coarse_length = 0;
+        // offset and length refer to this mesh's buffers if set
+        PersistentFaceMesh *persistent = nullptr;
 
         VertexFlags flags = VertexFlags::DEFAULT;
     };
 
     std::vector<FaceGroup> m_face_groups;
 
-    std::map<VertexRef, SelectableRef> m_vertex_to_selectable_map;
-    std::map<SelectableRef, std::vector<VertexRef>> m_selectable_to_vertex_map;
+    static constexpr size_t n_vertex_types = static_cast<size_t>(VertexType::SELECTION_INVISIBLE) + 1;
+
+    // selectables are referred to by their index into m_selectables, the
+    // tables are cleared but not deallocated when the canvas gets cleared
+    using SelectableID = uint32_t;
+    static constexpr SelectableID no_selectable = std::numeric_limits<SelectableID>::max();
+    std::vector<SelectableRef> m_selectables;
+    std::unordered_map<SelectableRef, SelectableID> m_selectable_ids;
+    // indexed by SelectableID, may be longer than m_selectables
+    std::vector<std::vector<VertexRef>> m_selectable_vertices;
+    // indexed by vertex type and vertex index
+    std::array<std::vector<SelectableID>, n_vertex_types> m_vertex_selectables;
 
+    const SelectableRef *find_selectable(const VertexRef &vref) const;
+    const std::vector<VertexRef> *find_vertices(const SelectableRef &sr) const;
 
     VertexFlags &get_vertex_flags(const VertexRef &vref);
+    void set_vertex_flags(const VertexRef &vref, VertexFlags flags);
+
+    // indices of vertices whose flags changed after the last push, by vertex type
+    std::array<std::vector<size_t>, n_vertex_types> m_changed_flags;
+
+    struct OverlayMarks {
+        // vertex counts by vertex type when the overlay began
+        std::array<size_t, n_vertex_types> vertices = {};
+        std::array<size_t, n_vertex_types> vertices_selection_invisible = {};
+        size_t selectables = 0;
+    };
+    std::optional<OverlayMarks> m_overlay;
+    // selectables from below the overlay that got vertices in the overlay
+    std::vector<SelectableID> m_overlay_shared_selectables;
+    // set by clear_overlay(), the next frame pushes the vertex types the
+    // redrawn overlay has vertices of
+    bool m_overlay_cleared = false;
+    void push_overlay();
+    std::array<size_t, n_vertex_types> get_vertex_counts() const;
+    std::array<size_t, n_vertex_types> get_vertex_counts_selection_invisible() const;
+
+    // vertices before these are the same as in the last push, by vertex type
+    std::array<size_t, n_vertex_types> m_push_first = {};
+
+    // bytes uploaded to the GPU during the current frame, by vertex type
+    std::array<size_t, n_vertex_types> m_uploaded_bytes = {};
 
     struct PickInfo {
-        size_t offset;
-        size_t count;
+        size_t offset = 0;
+        size_t count = 0;
     };
 
-    std::map<VertexType, PickInfo> m_vertex_type_picks;
+    // indexed by vertex type, valid once rendered after clear()
+    std::array<PickInfo, n_vertex_types> m_vertex_type_picks;
+    bool m_have_picks = false;
     VertexRef get_vertex_ref_for_pick(unsigned int pick) const;
     std::optional<SelectableRef> get_selectable_ref_for_vertex_ref(const VertexRef &vref) const;
     std::optional<SelectableRef> get_selectable_ref_for_pick(unsigned int pick) const;
@@ -532,6 +714,7 @@ private:
     bool m_show_error_overlay = false;
     bool m_zoom_to_cursor = true;
     RotationScheme m_rotation_scheme = RotationScheme::DEFAULT;
+    PrimitiveMode m_primitive_mode = PrimitiveMode::GEOMETRY_SHADER;
 };
 
 } // namespace dune3d
@@ -0,0 +1,105 @@
+#include "curve_renderer.hpp"
+#include "canvas.hpp"
+#include "gl_util.hpp"
+#include <cmath>
+#include <glm/glm.hpp>
+
+namespace dune3d {
+
+CurveRenderer::CurveRenderer(Canvas &ca) : BaseRenderer(ca, Canvas::VertexType::CURVE)
+{
+}
+
+GLuint CurveRenderer::create_vao(GLuint program, GLuint &vbo_out)
+{
+    GLuint center_index = glGetAttribLocation(program, "center");
+    GLuint radius_index = glGetAttribLocation(program, "radius");
+    GLuint u_index = glGetAttribLocation(program, "u");
+    GLuint v_index = glGetAttribLocation(program, "v");
+    GLuint angles_index = glGetAttribLocation(program, "angles");
+    GLuint vao, buffer;
+
+    /* we need to create a VAO to store the other buffers */
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    /* this is the VBO that holds the vertex data */
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+    Canvas::CurveVertex vertices[] = {
+            {{0, 0, 0}, 1, {1, 0, 0}, {0, 1, 0}, 0, 2 * M_PI},
+    };
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+    using V = Canvas::CurveVertex;
+    glEnableVertexAttribArray(center_index);
+    glVertexAttribPointer(center_index, 3, GL_FLOAT, GL_FALSE, sizeof(V), 0);
+    glEnableVertexAttribArray(radius_index);
+    glVertexAttribPointer(radius_index, 1, GL_FLOAT, GL_FALSE, sizeof(V), (void *)offsetof(V, radius));
+    glEnableVertexAttribArray(u_index);
+    glVertexAttribPointer(u_index, 3, GL_FLOAT, GL_FALSE, sizeof(V), (void *)offsetof(V, ux));
+    glEnableVertexAttribArray(v_index);
+    glVertexAttribPointer(v_index, 3, GL_FLOAT, GL_FALSE, sizeof(V), (void *)offsetof(V, vx));
+    glEnableVertexAttribArray(angles_index);
+    glVertexAttribPointer(angles_index, 2, GL_FLOAT, GL_FALSE, sizeof(V), (void *)offsetof(V, a0));
+    set_flags_attrib_pointer(program, 0, false);
+
+    /* reset the state; we will re-enable the VAO when needed */
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    vbo_out = buffer;
+
+    return vao;
+}
+
+void CurveRenderer::realize()
+{
+    m_program = gl_create_program_from_resource("/org/dune3d/dune3d/canvas/shaders/curve-vertex.glsl",
+                                                "/org/dune3d/dune3d/canvas/shaders/line-fragment.glsl",
+                                                "/org/dune3d/dune3d/canvas/shaders/curve-geometry.glsl");
+    create_flags_vbo();
+    m_vao = create_vao(m_program, m_vbo);
+
+    realize_base();
+    GET_LOC(this, viewport);
+}
+
+void CurveRenderer::push()
+{
+    m_ca.m_n_curves = m_ca.m_curves.size();
+    m_ca.m_n_curves_selection_invisible = m_ca.m_curves_selection_invisible.size();
+    push_vertices(m_vbo, m_ca.m_curves, m_ca.m_curves_selection_invisible);
+}
+
+void CurveRenderer::push_flags()
+{
+    upload_changed_flags(m_ca.m_curves);
+}
+
+void CurveRenderer::render()
+{
+    if (!m_ca.m_n_curves && !m_ca.m_n_curves_selection_invisible)
+        return;
+    glUseProgram(m_program);
+    glBindVertexArray(m_vao);
+
+    glUniform2f(m_viewport_loc, m_ca.m_dev_width, m_ca.m_dev_height);
+    load_uniforms();
+
+#ifndef __APPLE__
+    glLineWidth(m_ca.m_appearance.line_width * m_ca.m_scale_factor);
+#endif
+    glDrawArrays(GL_POINTS, 0, m_ca.m_n_curves);
+    glColorMaski(1, GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDrawArrays(GL_POINTS, m_ca.m_n_curves, m_ca.m_n_curves_selection_invisible);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+size_t CurveRenderer::get_vertex_count() const
+{
+    return m_ca.m_n_curves;
+}
+
+} // namespace dune3d
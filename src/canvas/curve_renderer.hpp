@@ -0,0 +1,23 @@
+#pragma once
+#include "base_renderer.hpp"
+
+namespace dune3d {
+class CurveRenderer : public BaseRenderer {
+public:
+    CurveRenderer(class Canvas &c);
+    void realize();
+    void render();
+    void push();
+    void push_flags();
+
+private:
+    size_t get_vertex_count() const override;
+
+    GLuint m_vao;
+    GLuint m_vbo;
+    GLuint m_viewport_loc;
+
+
+    GLuint create_vao(GLuint program, GLuint &vbo_out);
+};
+} // namespace dune3d
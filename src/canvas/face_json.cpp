@@ -0,0 +1,36 @@
+#include "face_json.hpp"
+
+namespace dune3d::face {
+
+void to_json(nlohmann::json &j, const Color &c)
+{
+    j = nlohmann::json::array();
+    j.push_back(c.r);
+    j.push_back(c.g);
+    j.push_back(c.b);
+}
+
+void from_json(const nlohmann::json &j, Color &c)
+{
+    j.at(0).get_to(c.r);
+    j.at(1).get_to(c.g);
+    j.at(2).get_to(c.b);
+}
+
+void to_json(nlohmann::json &j, const Face &f)
+{
+    j = {{"color", f.color},
+         {"vertices", f.vertices},
+         {"normals", f.normals},
+         {"triangle_indices", f.triangle_indices}};
+}
+
+void from_json(const nlohmann::json &j, Face &f)
+{
+    j.at("color").get_to(f.color);
+    j.at("vertices").get_to(f.vertices);
+    j.at("normals").get_to(f.normals);
+    j.at("triangle_indices").get_to(f.triangle_indices);
+}
+
+} // namespace dune3d::face
@@ -0,0 +1,28 @@
+#pragma once
+#include "face.hpp"
+#include "nlohmann/json.hpp"
+
+namespace dune3d::face {
+
+template <typename T> void to_json(nlohmann::json &j, const TVertex<T> &r)
+{
+    j = nlohmann::json::array();
+    j.push_back(r.x);
+    j.push_back(r.y);
+    j.push_back(r.z);
+}
+
+template <typename T> void from_json(const nlohmann::json &j, TVertex<T> &r)
+{
+    j.at(0).get_to(r.x);
+    j.at(1).get_to(r.y);
+    j.at(2).get_to(r.z);
+}
+
+void to_json(nlohmann::json &j, const Color &c);
+void from_json(const nlohmann::json &j, Color &c);
+
+void to_json(nlohmann::json &j, const Face &f);
+void from_json(const nlohmann::json &j, Face &f);
+
+} // namespace dune3d::face
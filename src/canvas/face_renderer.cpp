@@ -1,7 +1,9 @@
 #include "face_renderer.hpp"
 #include "gl_util.hpp"
 #include "canvas.hpp"
+#include <algorithm>
 #include <cmath>
+#include <set>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -14,10 +16,29 @@ FaceRenderer::FaceRenderer(Canvas &c) : BaseRenderer(c, Canvas::VertexType::FACE
 
 void FaceRenderer::create_vao()
 {
-    GLuint position_index = glGetAttribLocation(m_program, "position");
-    GLuint normal_index = glGetAttribLocation(m_program, "normal");
-    GLuint color_index = glGetAttribLocation(m_program, "color");
+    m_position_index = glGetAttribLocation(m_program, "position");
+    m_normal_index = glGetAttribLocation(m_program, "normal");
+    m_color_index = glGetAttribLocation(m_program, "color");
+    m_group_index = glGetAttribLocation(m_program, "group");
 
+    /* per-instance transforms and per-group parameters are fetched from
+       buffer textures, so that they're available to all VAOs */
+    glGenBuffers(1, &m_instance_vbo);
+    glBindBuffer(GL_TEXTURE_BUFFER, m_instance_vbo);
+    const glm::mat4 identity(1);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(identity), glm::value_ptr(identity), GL_STATIC_DRAW);
+    glGenTextures(1, &m_instance_texture);
+    glBindTexture(GL_TEXTURE_BUFFER, m_instance_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_instance_vbo);
+
+    glGenBuffers(1, &m_group_vbo);
+    glBindBuffer(GL_TEXTURE_BUFFER, m_group_vbo);
+    glBufferData(GL_TEXTURE_BUFFER, 0, nullptr, GL_DYNAMIC_DRAW);
+    glGenTextures(1, &m_group_texture);
+    glBindTexture(GL_TEXTURE_BUFFER, m_group_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_group_vbo);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
 
     /* we need to create a VAO to store the other buffers */
     glGenVertexArrays(1, &m_vao);
@@ -37,16 +58,16 @@ void FaceRenderer::create_vao()
     uint32_t elements[] = {0, 1, 2};
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(elements), elements, GL_STATIC_DRAW);
 
-    /* enable and set the position attribute */
-    glEnableVertexAttribArray(position_index);
-    glVertexAttribPointer(position_index, 3, GL_FLOAT, GL_FALSE, sizeof(Canvas::FaceVertex),
-                          (void *)offsetof(Canvas::FaceVertex, x));
-    glEnableVertexAttribArray(normal_index);
-    glVertexAttribPointer(normal_index, 3, GL_FLOAT, GL_FALSE, sizeof(Canvas::FaceVertex),
-                          (void *)offsetof(Canvas::FaceVertex, nx));
-    glEnableVertexAttribArray(color_index);
-    glVertexAttribPointer(color_index, 3, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Canvas::FaceVertex),
-                          (void *)offsetof(Canvas::FaceVertex, r));
+    setup_vertex_attribs(m_vbo);
+
+    /* the persistent meshes' VAOs get their group as a constant attribute
+       instead, since a mesh can be part of multiple groups */
+    glGenBuffers(1, &m_vertex_group_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertex_group_vbo);
+    const uint32_t vertex_groups[] = {0, 0, 0};
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertex_groups), vertex_groups, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(m_group_index);
+    glVertexAttribIPointer(m_group_index, 1, GL_UNSIGNED_INT, sizeof(uint32_t), 0);
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
@@ -54,6 +75,22 @@ void FaceRenderer::create_vao()
     // glDeleteBuffers (1, &buffer);
 }
 
+void FaceRenderer::setup_vertex_attribs(GLuint vbo)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+    /* enable and set the position attribute */
+    glEnableVertexAttribArray(m_position_index);
+    glVertexAttribPointer(m_position_index, 3, GL_FLOAT, GL_FALSE, sizeof(Canvas::FaceVertex),
+                          (void *)offsetof(Canvas::FaceVertex, x));
+    glEnableVertexAttribArray(m_normal_index);
+    glVertexAttribPointer(m_normal_index, 3, GL_FLOAT, GL_FALSE, sizeof(Canvas::FaceVertex),
+                          (void *)offsetof(Canvas::FaceVertex, nx));
+    glEnableVertexAttribArray(m_color_index);
+    glVertexAttribPointer(m_color_index, 3, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Canvas::FaceVertex),
+                          (void *)offsetof(Canvas::FaceVertex, r));
+}
+
 void FaceRenderer::realize()
 {
     m_program = gl_create_program_from_resource("/org/dune3d/dune3d/canvas/shaders/face-vertex.glsl",
@@ -63,10 +100,8 @@ void FaceRenderer::realize()
     realize_base();
 
     GET_LOC(this, cam_normal);
-    GET_LOC(this, flags);
-    GET_LOC(this, origin);
-    GET_LOC(this, normal_mat);
-    GET_LOC(this, override_color);
+    GET_LOC(this, groups);
+    GET_LOC(this, instances);
     GET_LOC(this, clipping_value);
     GET_LOC(this, clipping_op);
 }
@@ -86,6 +121,158 @@ void FaceRenderer::push()
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * n_idx, m_ca.m_face_index_buffer.data(),
                  GL_STATIC_DRAW);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    {
+        std::vector<uint32_t> vertex_groups(n_vertices);
+        for (size_t i = 0; i < m_ca.m_face_groups.size(); i++) {
+            const auto &group = m_ca.m_face_groups.at(i);
+            if (group.persistent)
+                continue;
+            std::fill_n(vertex_groups.begin() + group.vertex_offset, group.vertex_count, i);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, m_vertex_group_vbo);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(uint32_t) * n_vertices, vertex_groups.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, m_instance_vbo);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::mat4) * m_ca.m_face_instance_buffer.size(),
+                 m_ca.m_face_instance_buffer.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    add_uploaded_bytes((sizeof(Canvas::FaceVertex) + sizeof(uint32_t)) * n_vertices + sizeof(unsigned int) * n_idx
+                       + sizeof(glm::mat4) * m_ca.m_face_instance_buffer.size());
+
+    push_persistent();
+}
+
+// keep in sync with face-vertex.glsl
+static const size_t texels_per_group = 6;
+
+void FaceRenderer::push_groups()
+{
+    // Small enough to be rebuilt every frame, this way hover, selection and
+    // appearance changes don't need to be tracked. Integers are stored as
+    // floats, which is exact for anything below 2^24.
+    m_group_buffer.resize(m_ca.m_face_groups.size() * texels_per_group);
+    auto it = m_group_buffer.begin();
+    for (const auto &group : m_ca.m_face_groups) {
+        const auto flags = static_cast<uint32_t>(group.flags);
+        *it++ = {group.origin.x, group.origin.y, group.origin.z, static_cast<float>(flags)};
+        if (group.color == ICanvas::FaceColor::AS_IS) {
+            *it++ = {0, 0, 0, 0};
+        }
+        else {
+            const auto colorp = (group.color == ICanvas::FaceColor::SOLID_MODEL) ? ColorP::SOLID_MODEL
+                                                                                 : ColorP::OTHER_BODY_SOLID_MODEL;
+            const auto &color = m_ca.m_appearance.get_color(colorp);
+            *it++ = {color.r, color.g, color.b, 1};
+        }
+        const glm::mat3 normal_mat = glm::transpose(glm::toMat3(group.normal));
+        for (int i = 0; i < 3; i++)
+            *it++ = {normal_mat[i].x, normal_mat[i].y, normal_mat[i].z, 0};
+        *it++ = {static_cast<float>(group.instance_offset), 0, 0, 0};
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, m_group_vbo);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(m_group_buffer.front()) * m_group_buffer.size(), m_group_buffer.data(),
+                 GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    add_uploaded_bytes(sizeof(m_group_buffer.front()) * m_group_buffer.size());
+}
+
+void FaceRenderer::push_persistent()
+{
+    // release meshes no face group refers to anymore
+    std::set<const Canvas::PersistentFaceMesh *> in_use;
+    for (const auto &group : m_ca.m_face_groups) {
+        if (group.persistent)
+            in_use.insert(group.persistent);
+    }
+    for (auto it = m_ca.m_persistent_face_meshes.begin(); it != m_ca.m_persistent_face_meshes.end();) {
+        auto &mesh = it->second;
+        if (in_use.contains(&mesh)) {
+            it++;
+            continue;
+        }
+        if (mesh.vao) {
+            glDeleteVertexArrays(1, &mesh.vao);
+            glDeleteBuffers(1, &mesh.vbo);
+            glDeleteBuffers(1, &mesh.ebo);
+        }
+        it = m_ca.m_persistent_face_meshes.erase(it);
+    }
+
+    for (auto &[key, mesh] : m_ca.m_persistent_face_meshes) {
+        if (mesh.vao)
+            continue;
+        glGenVertexArrays(1, &mesh.vao);
+        glBindVertexArray(mesh.vao);
+        glGenBuffers(1, &mesh.vbo);
+        glGenBuffers(1, &mesh.ebo);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
+        setup_vertex_attribs(mesh.vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+    }
+}
+
+bool FaceRenderer::stream_persistent()
+{
+    // uploading a large model in one go would stall the frame,
+    // spread it out over multiple ones instead
+    static const size_t budget_per_frame = 16 * 1024 * 1024;
+    size_t budget = budget_per_frame;
+    bool incomplete = false;
+
+    for (auto &[key, mesh] : m_ca.m_persistent_face_meshes) {
+        if (mesh.is_complete() || !mesh.vao)
+            continue;
+        if (budget == 0) {
+            incomplete = true;
+            break;
+        }
+
+        glBindVertexArray(mesh.vao);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+        if (!mesh.allocated) {
+            glBufferData(GL_ARRAY_BUFFER, sizeof(Canvas::FaceVertex) * mesh.n_vertices, nullptr, GL_STATIC_DRAW);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * mesh.n_indices, nullptr, GL_STATIC_DRAW);
+            mesh.allocated = true;
+        }
+
+        if (mesh.vertices_uploaded < mesh.n_vertices) {
+            const auto n = std::min(mesh.n_vertices - mesh.vertices_uploaded,
+                                    std::max(budget / sizeof(Canvas::FaceVertex), size_t{1}));
+            glBufferSubData(GL_ARRAY_BUFFER, sizeof(Canvas::FaceVertex) * mesh.vertices_uploaded,
+                            sizeof(Canvas::FaceVertex) * n, mesh.vertices.data() + mesh.vertices_uploaded);
+            mesh.vertices_uploaded += n;
+            budget -= std::min(budget, sizeof(Canvas::FaceVertex) * n);
+        }
+        // triangles can only be drawn once all vertices are there, after
+        // that they're uploaded in whole triangles so that they show up
+        // progressively
+        if (mesh.vertices_uploaded == mesh.n_vertices && budget) {
+            const auto n = std::min(mesh.n_indices - mesh.indices_uploaded,
+                                    std::max(budget / (sizeof(unsigned int) * 3), size_t{1}) * 3);
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * mesh.indices_uploaded,
+                            sizeof(unsigned int) * n, mesh.indices.data() + mesh.indices_uploaded);
+            mesh.indices_uploaded += n;
+            budget -= std::min(budget, sizeof(unsigned int) * n);
+        }
+
+        if (mesh.is_complete()) {
+            mesh.vertices = {};
+            mesh.indices = {};
+        }
+        else {
+            incomplete = true;
+        }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    add_uploaded_bytes(budget_per_frame - budget);
+
+    return incomplete;
 }
 
 static int get_clipping_op(const ClippingPlanes::Plane &plane)
@@ -100,6 +287,8 @@ static int get_clipping_op(const ClippingPlanes::Plane &plane)
 
 void FaceRenderer::render()
 {
+    const bool streaming = stream_persistent();
+
     glUseProgram(m_program);
     glBindVertexArray(m_vao);
     // glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
@@ -121,28 +310,56 @@ void FaceRenderer::render()
 
     glUniform3fv(m_cam_normal_loc, 1, glm::value_ptr(m_ca.m_cam_normal));
 
-    size_t group_idx = 0;
+    push_groups();
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_BUFFER, m_group_texture);
+    glUniform1i(m_groups_loc, 2);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_BUFFER, m_instance_texture);
+    glUniform1i(m_instances_loc, 3);
+    glActiveTexture(GL_TEXTURE0);
+
+    // groups in the shared buffers know their group from the vertex
+    // attribute, so all single instance ones go out in one call
+    m_multi_draw_counts.clear();
+    m_multi_draw_offsets.clear();
     for (const auto &group : m_ca.m_face_groups) {
-        glUniform1ui(m_pick_base_loc, m_ca.m_pick_base + group_idx);
-        glUniform1ui(m_flags_loc, static_cast<uint32_t>(group.flags));
-        glUniform3fv(m_origin_loc, 1, glm::value_ptr(group.origin));
-        if (group.color == ICanvas::FaceColor::AS_IS) {
-            glUniform3f(m_override_color_loc, NAN, NAN, NAN);
+        if (group.persistent || !group.length)
+            continue;
+        const bool coarse = m_ca.m_navigating && group.coarse_length;
+        const auto length = coarse ? group.coarse_length : group.length;
+        const auto offset = (const void *)((coarse ? group.coarse_offset : group.offset) * sizeof(unsigned int));
+        if (group.instance_count == 1) {
+            m_multi_draw_counts.push_back(length);
+            m_multi_draw_offsets.push_back(offset);
         }
         else {
-            const auto colorp = (group.color == ICanvas::FaceColor::SOLID_MODEL) ? ColorP::SOLID_MODEL
-                                                                                 : ColorP::OTHER_BODY_SOLID_MODEL;
-            const auto color = m_ca.m_appearance.get_color(colorp);
-            gl_color_to_uniform_3f(m_override_color_loc, color);
+            glDrawElementsInstanced(GL_TRIANGLES, length, GL_UNSIGNED_INT, offset, group.instance_count);
         }
-        glm::mat3 normal_mat = glm::transpose(glm::toMat3(group.normal));
+    }
+    if (m_multi_draw_counts.size())
+        glMultiDrawElements(GL_TRIANGLES, m_multi_draw_counts.data(), GL_UNSIGNED_INT, m_multi_draw_offsets.data(),
+                            m_multi_draw_counts.size());
 
-        glUniformMatrix3fv(m_normal_mat_loc, 1, GL_FALSE, glm::value_ptr(normal_mat));
-        glDrawElements(GL_TRIANGLES, group.length, GL_UNSIGNED_INT, (void *)(group.offset * sizeof(unsigned int)));
-        group_idx++;
+    for (size_t group_idx = 0; group_idx < m_ca.m_face_groups.size(); group_idx++) {
+        const auto &group = m_ca.m_face_groups.at(group_idx);
+        if (!group.persistent)
+            continue;
+        if (group.persistent->vertices_uploaded != group.persistent->n_vertices)
+            continue;
+        const size_t length = std::min(group.length, group.persistent->indices_uploaded);
+        if (!length)
+            continue;
+        glBindVertexArray(group.persistent->vao);
+        glVertexAttribI1ui(m_group_index, group_idx);
+        glDrawElementsInstanced(GL_TRIANGLES, length, GL_UNSIGNED_INT, (void *)(group.offset * sizeof(unsigned int)),
+                                group.instance_count);
     }
-    m_ca.m_vertex_type_picks[Canvas::VertexType::FACE_GROUP] = {.offset = m_ca.m_pick_base,
-                                                                .count = m_ca.m_face_groups.size()};
+    glBindVertexArray(m_vao);
+    if (streaming)
+        m_ca.queue_draw();
+    m_ca.m_vertex_type_picks.at(static_cast<size_t>(Canvas::VertexType::FACE_GROUP)) = {
+            .offset = m_ca.m_pick_base, .count = m_ca.m_face_groups.size()};
     m_ca.m_pick_base += m_ca.m_face_groups.size();
 }
 
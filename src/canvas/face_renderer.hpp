@@ -1,5 +1,7 @@
 #pragma once
 #include "base_renderer.hpp"
+#include <array>
+#include <vector>
 
 namespace dune3d {
 class FaceRenderer : public BaseRenderer {
@@ -12,16 +14,35 @@ public:
 private:
     size_t get_vertex_count() const override;
     void create_vao();
+    void setup_vertex_attribs(GLuint vbo);
+    void push_persistent();
+    void push_groups();
+    // returns true if there's more left to upload
+    bool stream_persistent();
 
     GLuint m_vao;
     GLuint m_vbo;
     GLuint m_ebo;
+    GLuint m_instance_vbo;
+    GLuint m_instance_texture;
+    // group index of each vertex in m_vbo
+    GLuint m_vertex_group_vbo;
+    // per-group parameters, see push_groups()
+    GLuint m_group_vbo;
+    GLuint m_group_texture;
+    std::vector<std::array<float, 4>> m_group_buffer;
+
+    std::vector<GLsizei> m_multi_draw_counts;
+    std::vector<const void *> m_multi_draw_offsets;
+
+    GLuint m_position_index;
+    GLuint m_normal_index;
+    GLuint m_color_index;
+    GLuint m_group_index;
 
     GLuint m_cam_normal_loc;
-    GLuint m_flags_loc;
-    GLuint m_origin_loc;
-    GLuint m_normal_mat_loc;
-    GLuint m_override_color_loc;
+    GLuint m_groups_loc;
+    GLuint m_instances_loc;
 
     GLuint m_clipping_value_loc;
     GLuint m_clipping_op_loc;
@@ -15,11 +15,6 @@ Glyph3DRenderer::Glyph3DRenderer(Canvas &c) : BaseRenderer(c, Canvas::VertexType
 
 GLuint Glyph3DRenderer::create_vao(GLuint program, GLuint &vbo_out)
 {
-    GLuint origin_index = glGetAttribLocation(program, "origin");
-    GLuint right_index = glGetAttribLocation(program, "right");
-    GLuint up_index = glGetAttribLocation(program, "up");
-    GLuint bits_index = glGetAttribLocation(program, "bits");
-    GLuint flags_index = glGetAttribLocation(program, "flags");
     GLuint vao, buffer;
 
     /* we need to create a VAO to store the other buffers */
@@ -38,25 +33,7 @@ GLuint Glyph3DRenderer::create_vao(GLuint program, GLuint &vbo_out)
     };
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
-    /* enable and set the position attribute */
-    glEnableVertexAttribArray(origin_index);
-    glVertexAttribPointer(origin_index, 3, GL_FLOAT, GL_FALSE, sizeof(Canvas::Glyph3DVertex), 0);
-    GL_CHECK_ERROR
-    glEnableVertexAttribArray(right_index);
-    glVertexAttribPointer(right_index, 3, GL_FLOAT, GL_FALSE, sizeof(Canvas::Glyph3DVertex),
-                          (void *)offsetof(Canvas::Glyph3DVertex, xr));
-    GL_CHECK_ERROR
-    glEnableVertexAttribArray(up_index);
-    glVertexAttribPointer(up_index, 3, GL_FLOAT, GL_FALSE, sizeof(Canvas::Glyph3DVertex),
-                          (void *)offsetof(Canvas::Glyph3DVertex, xu));
-    GL_CHECK_ERROR
-    glEnableVertexAttribArray(bits_index);
-    glVertexAttribIPointer(bits_index, 1, GL_UNSIGNED_INT, sizeof(Canvas::Glyph3DVertex),
-                           (void *)offsetof(Canvas::Glyph3DVertex, bits));
-    GL_CHECK_ERROR
-    glEnableVertexAttribArray(flags_index);
-    glVertexAttribIPointer(flags_index, 1, GL_UNSIGNED_INT, sizeof(Canvas::Glyph3DVertex),
-                           (void *)offsetof(Canvas::Glyph3DVertex, flags));
+    set_vertex_attrib_pointers(program, 0, false);
     GL_CHECK_ERROR
     /* enable and set the color attribute */
     /* reset the state; we will re-enable the VAO when needed */
@@ -69,6 +46,34 @@ GLuint Glyph3DRenderer::create_vao(GLuint program, GLuint &vbo_out)
     return vao;
 }
 
+void Glyph3DRenderer::set_vertex_attrib_pointers(GLuint program, size_t first, bool instanced)
+{
+    GLuint origin_index = glGetAttribLocation(program, "origin");
+    GLuint right_index = glGetAttribLocation(program, "right");
+    GLuint up_index = glGetAttribLocation(program, "up");
+    GLuint bits_index = glGetAttribLocation(program, "bits");
+    const size_t base = first * sizeof(Canvas::Glyph3DVertex);
+
+    /* enable and set the position attribute */
+    glEnableVertexAttribArray(origin_index);
+    glVertexAttribPointer(origin_index, 3, GL_FLOAT, GL_FALSE, sizeof(Canvas::Glyph3DVertex), (void *)base);
+    glEnableVertexAttribArray(right_index);
+    glVertexAttribPointer(right_index, 3, GL_FLOAT, GL_FALSE, sizeof(Canvas::Glyph3DVertex),
+                          (void *)(base + offsetof(Canvas::Glyph3DVertex, xr)));
+    glEnableVertexAttribArray(up_index);
+    glVertexAttribPointer(up_index, 3, GL_FLOAT, GL_FALSE, sizeof(Canvas::Glyph3DVertex),
+                          (void *)(base + offsetof(Canvas::Glyph3DVertex, xu)));
+    glEnableVertexAttribArray(bits_index);
+    glVertexAttribIPointer(bits_index, 1, GL_UNSIGNED_INT, sizeof(Canvas::Glyph3DVertex),
+                           (void *)(base + offsetof(Canvas::Glyph3DVertex, bits)));
+
+    if (instanced) {
+        for (const auto index : {origin_index, right_index, up_index, bits_index})
+            glVertexAttribDivisor(index, 1);
+    }
+    set_flags_attrib_pointer(program, first, instanced);
+}
+
 void Glyph3DRenderer::realize()
 {
     glGenTextures(1, &m_texture_glyph);
@@ -81,13 +86,24 @@ void Glyph3DRenderer::realize()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
 
-    m_program = gl_create_program_from_resource("/org/dune3d/dune3d/canvas/shaders/glyph-3d-vertex.glsl",
-                                                "/org/dune3d/dune3d/canvas/shaders/glyph-fragment.glsl",
-                                                "/org/dune3d/dune3d/canvas/shaders/glyph-3d-geometry.glsl");
-    m_vao = create_vao(m_program, m_vbo);
+    m_program_geometry =
+            gl_create_program_from_resource("/org/dune3d/dune3d/canvas/shaders/glyph-3d-vertex.glsl",
+                                            "/org/dune3d/dune3d/canvas/shaders/glyph-fragment.glsl",
+                                            "/org/dune3d/dune3d/canvas/shaders/glyph-3d-geometry.glsl");
+    m_program_instanced =
+            gl_create_program_from_resource("/org/dune3d/dune3d/canvas/shaders/glyph-3d-instanced-vertex.glsl",
+                                            "/org/dune3d/dune3d/canvas/shaders/glyph-fragment.glsl", nullptr);
+    m_program = m_program_geometry;
+    create_flags_vbo();
+    m_vao = create_vao(m_program_geometry, m_vbo);
+    m_vao_instanced = create_vao_instanced(m_vbo);
 
     realize_base();
+    get_locations();
+}
 
+void Glyph3DRenderer::get_locations()
+{
     GET_LOC(this, screen);
     GET_LOC(this, msdf);
 }
@@ -95,18 +111,20 @@ void Glyph3DRenderer::realize()
 void Glyph3DRenderer::push()
 {
     m_ca.m_n_glyphs_3d = m_ca.m_glyphs_3d.size();
+    push_vertices(m_vbo, m_ca.m_glyphs_3d);
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(Canvas::Glyph3DVertex) * m_ca.m_n_glyphs_3d, m_ca.m_glyphs_3d.data(),
-                 GL_STATIC_DRAW);
+void Glyph3DRenderer::push_flags()
+{
+    upload_changed_flags(m_ca.m_glyphs_3d);
 }
 
 void Glyph3DRenderer::render()
 {
     if (!m_ca.m_n_glyphs_3d)
         return;
+    update_program();
     glUseProgram(m_program);
-    glBindVertexArray(m_vao);
     glActiveTexture(GL_TEXTURE0);
     glUniform1i(m_msdf_loc, 0);
     glBindTexture(GL_TEXTURE_2D, m_texture_glyph);
@@ -115,7 +133,14 @@ void Glyph3DRenderer::render()
     glUniformMatrix3fv(m_screen_loc, 1, GL_FALSE, glm::value_ptr(m_ca.m_screenmat));
     load_uniforms();
 
-    glDrawArrays(GL_POINTS, 0, m_ca.m_n_glyphs_3d);
+    if (is_instanced()) {
+        glBindVertexArray(m_vao_instanced);
+        draw_quads(m_vbo, 0, m_ca.m_n_glyphs_3d);
+    }
+    else {
+        glBindVertexArray(m_vao);
+        glDrawArrays(GL_POINTS, 0, m_ca.m_n_glyphs_3d);
+    }
 }
 
 size_t Glyph3DRenderer::get_vertex_count() const
@@ -15,11 +15,6 @@ GlyphRenderer::GlyphRenderer(Canvas &c) : BaseRenderer(c, Canvas::VertexType::GL
 
 GLuint GlyphRenderer::create_vao(GLuint program, GLuint &vbo_out)
 {
-    GLuint origin_index = glGetAttribLocation(program, "origin");
-    GLuint shift_index = glGetAttribLocation(program, "shift");
-    GLuint scale_index = glGetAttribLocation(program, "scale");
-    GLuint bits_index = glGetAttribLocation(program, "bits");
-    GLuint flags_index = glGetAttribLocation(program, "flags");
     GLuint vao, buffer;
 
     /* we need to create a VAO to store the other buffers */
@@ -38,25 +33,7 @@ GLuint GlyphRenderer::create_vao(GLuint program, GLuint &vbo_out)
     };
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
-    /* enable and set the position attribute */
-    glEnableVertexAttribArray(origin_index);
-    glVertexAttribPointer(origin_index, 3, GL_FLOAT, GL_FALSE, sizeof(Canvas::GlyphVertex), 0);
-    GL_CHECK_ERROR
-    glEnableVertexAttribArray(shift_index);
-    glVertexAttribPointer(shift_index, 2, GL_FLOAT, GL_FALSE, sizeof(Canvas::GlyphVertex),
-                          (void *)offsetof(Canvas::GlyphVertex, xs));
-    GL_CHECK_ERROR
-    glEnableVertexAttribArray(scale_index);
-    glVertexAttribPointer(scale_index, 1, GL_FLOAT, GL_FALSE, sizeof(Canvas::GlyphVertex),
-                          (void *)offsetof(Canvas::GlyphVertex, scale));
-    GL_CHECK_ERROR
-    glEnableVertexAttribArray(bits_index);
-    glVertexAttribIPointer(bits_index, 1, GL_UNSIGNED_INT, sizeof(Canvas::GlyphVertex),
-                           (void *)offsetof(Canvas::GlyphVertex, bits));
-    GL_CHECK_ERROR
-    glEnableVertexAttribArray(flags_index);
-    glVertexAttribIPointer(flags_index, 1, GL_UNSIGNED_INT, sizeof(Canvas::GlyphVertex),
-                           (void *)offsetof(Canvas::GlyphVertex, flags));
+    set_vertex_attrib_pointers(program, 0, false);
     GL_CHECK_ERROR
     /* enable and set the color attribute */
     /* reset the state; we will re-enable the VAO when needed */
@@ -69,6 +46,34 @@ GLuint GlyphRenderer::create_vao(GLuint program, GLuint &vbo_out)
     return vao;
 }
 
+void GlyphRenderer::set_vertex_attrib_pointers(GLuint program, size_t first, bool instanced)
+{
+    GLuint origin_index = glGetAttribLocation(program, "origin");
+    GLuint shift_index = glGetAttribLocation(program, "shift");
+    GLuint scale_index = glGetAttribLocation(program, "scale");
+    GLuint bits_index = glGetAttribLocation(program, "bits");
+    const size_t base = first * sizeof(Canvas::GlyphVertex);
+
+    /* enable and set the position attribute */
+    glEnableVertexAttribArray(origin_index);
+    glVertexAttribPointer(origin_index, 3, GL_FLOAT, GL_FALSE, sizeof(Canvas::GlyphVertex), (void *)base);
+    glEnableVertexAttribArray(shift_index);
+    glVertexAttribPointer(shift_index, 2, GL_FLOAT, GL_FALSE, sizeof(Canvas::GlyphVertex),
+                          (void *)(base + offsetof(Canvas::GlyphVertex, xs)));
+    glEnableVertexAttribArray(scale_index);
+    glVertexAttribPointer(scale_index, 1, GL_FLOAT, GL_FALSE, sizeof(Canvas::GlyphVertex),
+                          (void *)(base + offsetof(Canvas::GlyphVertex, scale)));
+    glEnableVertexAttribArray(bits_index);
+    glVertexAttribIPointer(bits_index, 1, GL_UNSIGNED_INT, sizeof(Canvas::GlyphVertex),
+                           (void *)(base + offsetof(Canvas::GlyphVertex, bits)));
+
+    if (instanced) {
+        for (const auto index : {origin_index, shift_index, scale_index, bits_index})
+            glVertexAttribDivisor(index, 1);
+    }
+    set_flags_attrib_pointer(program, first, instanced);
+}
+
 void GlyphRenderer::realize()
 {
     glGenTextures(1, &m_texture_glyph);
@@ -80,13 +85,23 @@ void GlyphRenderer::realize()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
 
-    m_program = gl_create_program_from_resource("/org/dune3d/dune3d/canvas/shaders/glyph-vertex.glsl",
-                                                "/org/dune3d/dune3d/canvas/shaders/glyph-fragment.glsl",
-                                                "/org/dune3d/dune3d/canvas/shaders/glyph-geometry.glsl");
-    m_vao = create_vao(m_program, m_vbo);
+    m_program_geometry = gl_create_program_from_resource("/org/dune3d/dune3d/canvas/shaders/glyph-vertex.glsl",
+                                                         "/org/dune3d/dune3d/canvas/shaders/glyph-fragment.glsl",
+                                                         "/org/dune3d/dune3d/canvas/shaders/glyph-geometry.glsl");
+    m_program_instanced =
+            gl_create_program_from_resource("/org/dune3d/dune3d/canvas/shaders/glyph-instanced-vertex.glsl",
+                                            "/org/dune3d/dune3d/canvas/shaders/glyph-fragment.glsl", nullptr);
+    m_program = m_program_geometry;
+    create_flags_vbo();
+    m_vao = create_vao(m_program_geometry, m_vbo);
+    m_vao_instanced = create_vao_instanced(m_vbo);
 
     realize_base();
+    get_locations();
+}
 
+void GlyphRenderer::get_locations()
+{
     GET_LOC(this, screen);
     GET_LOC(this, msdf);
     GET_LOC(this, scale_factor);
@@ -94,19 +109,22 @@ void GlyphRenderer::realize()
 
 void GlyphRenderer::push()
 {
-
     m_ca.m_n_glyphs = m_ca.m_glyphs.size();
+    m_ca.m_n_icon_badges = m_ca.m_icon_badges.size();
+    push_vertices(m_vbo, m_ca.m_glyphs, m_ca.m_icon_badges);
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(Canvas::GlyphVertex) * m_ca.m_n_glyphs, m_ca.m_glyphs.data(), GL_STATIC_DRAW);
+void GlyphRenderer::push_flags()
+{
+    upload_changed_flags(m_ca.m_glyphs);
 }
 
 void GlyphRenderer::render()
 {
-    if (!m_ca.m_n_glyphs)
+    if (!m_ca.m_n_glyphs && !m_ca.m_n_icon_badges)
         return;
+    update_program();
     glUseProgram(m_program);
-    glBindVertexArray(m_vao);
     glActiveTexture(GL_TEXTURE0);
     glUniform1i(m_msdf_loc, 0);
     glUniform1f(m_scale_factor_loc, m_ca.m_scale_factor);
@@ -116,7 +134,21 @@ void GlyphRenderer::render()
     glUniformMatrix3fv(m_screen_loc, 1, GL_FALSE, glm::value_ptr(m_ca.m_screenmat));
     load_uniforms();
 
-    glDrawArrays(GL_POINTS, 0, m_ca.m_n_glyphs);
+    // icon badges can't be picked
+    if (is_instanced()) {
+        glBindVertexArray(m_vao_instanced);
+        draw_quads(m_vbo, 0, m_ca.m_n_glyphs);
+        glColorMaski(1, GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        draw_quads(m_vbo, m_ca.m_n_glyphs, m_ca.m_n_icon_badges);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    }
+    else {
+        glBindVertexArray(m_vao);
+        glDrawArrays(GL_POINTS, 0, m_ca.m_n_glyphs);
+        glColorMaski(1, GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDrawArrays(GL_POINTS, m_ca.m_n_glyphs, m_ca.m_n_icon_badges);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    }
 }
 
 size_t GlyphRenderer::get_vertex_count() const
@@ -8,11 +8,20 @@ public:
     void realize();
     void render();
     void push();
+    void push_flags();
+
+    GLuint get_texture() const
+    {
+        return m_texture_glyph;
+    }
 
 private:
     size_t get_vertex_count() const override;
+    void get_locations() override;
+    void set_vertex_attrib_pointers(GLuint program, size_t first, bool instanced) override;
 
     GLuint m_vao;
+    GLuint m_vao_instanced;
     GLuint m_vbo;
 
     GLuint m_screen_loc;
@@ -20,6 +29,6 @@ private:
     GLuint m_scale_factor_loc;
     GLuint m_texture_glyph;
 
-    static GLuint create_vao(GLuint program, GLuint &vbo_out);
+    GLuint create_vao(GLuint program, GLuint &vbo_out);
 };
 } // namespace dune3d
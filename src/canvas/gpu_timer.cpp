@@ -0,0 +1,80 @@
+#include "gpu_timer.hpp"
+#include <algorithm>
+
+namespace dune3d {
+
+void GPUTimer::realize(size_t n_stages)
+{
+    m_n_stages = n_stages;
+    for (auto &frame : m_frames) {
+        frame.queries.resize(n_stages + 1);
+        frame.issued.resize(n_stages + 1);
+        glGenQueries(frame.queries.size(), frame.queries.data());
+    }
+}
+
+void GPUTimer::issue(Frame &frame, size_t index)
+{
+    glQueryCounter(frame.queries.at(index), GL_TIMESTAMP);
+    frame.issued.at(index) = true;
+}
+
+void GPUTimer::begin_frame(unsigned int tag)
+{
+    if (m_in_frame || m_n_pending == n_frames || !m_n_stages)
+        return;
+    auto &frame = m_frames.at(m_next);
+    std::fill(frame.issued.begin(), frame.issued.end(), false);
+    frame.tag = tag;
+    issue(frame, 0);
+    m_in_frame = true;
+}
+
+void GPUTimer::end_stage(size_t stage)
+{
+    if (!m_in_frame)
+        return;
+    issue(m_frames.at(m_next), stage + 1);
+}
+
+void GPUTimer::end_frame()
+{
+    if (!m_in_frame)
+        return;
+    auto &frame = m_frames.at(m_next);
+    // stages that weren't rendered end where the previous one did
+    for (size_t i = 1; i < frame.queries.size(); i++) {
+        if (!frame.issued.at(i))
+            issue(frame, i);
+    }
+    m_in_frame = false;
+    m_next = (m_next + 1) % n_frames;
+    m_n_pending++;
+}
+
+std::optional<GPUTimer::Result> GPUTimer::collect()
+{
+    if (!m_n_pending)
+        return {};
+    auto &frame = m_frames.at((m_next + n_frames - m_n_pending) % n_frames);
+    GLint available = 0;
+    glGetQueryObjectiv(frame.queries.back(), GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+        return {};
+
+    std::vector<GLuint64> timestamps(frame.queries.size());
+    for (size_t i = 0; i < frame.queries.size(); i++)
+        glGetQueryObjectui64v(frame.queries.at(i), GL_QUERY_RESULT, &timestamps.at(i));
+    m_n_pending--;
+
+    Result result;
+    result.tag = frame.tag;
+    for (size_t i = 1; i < timestamps.size(); i++) {
+        const auto dt = timestamps.at(i) > timestamps.at(i - 1) ? timestamps.at(i) - timestamps.at(i - 1) : 0;
+        result.stages.push_back(dt / 1e6f);
+        result.total += result.stages.back();
+    }
+    return result;
+}
+
+} // namespace dune3d
@@ -0,0 +1,46 @@
+#pragma once
+#include <epoxy/gl.h>
+#include <array>
+#include <optional>
+#include <vector>
+
+namespace dune3d {
+
+// Measures the GPU time of each stage of a frame with timestamp queries.
+// Results are collected a few frames later, so that waiting for them
+// never stalls the pipeline.
+class GPUTimer {
+public:
+    void realize(size_t n_stages);
+
+    // does nothing if all query sets are still in flight, the frame then
+    // doesn't get measured
+    void begin_frame(unsigned int tag);
+    void end_stage(size_t stage);
+    void end_frame();
+
+    struct Result {
+        unsigned int tag = 0;      // as passed to begin_frame
+        float total = 0;           // ms
+        std::vector<float> stages; // ms
+    };
+    std::optional<Result> collect();
+
+private:
+    static constexpr size_t n_frames = 3;
+    struct Frame {
+        // frame start followed by the end of each stage
+        std::vector<GLuint> queries;
+        std::vector<bool> issued;
+        unsigned int tag = 0;
+    };
+    std::array<Frame, n_frames> m_frames;
+    size_t m_n_stages = 0;
+    size_t m_next = 0;
+    size_t m_n_pending = 0;
+    bool m_in_frame = false;
+
+    void issue(Frame &frame, size_t index);
+};
+
+} // namespace dune3d
@@ -1,6 +1,7 @@
 #pragma once
 #include <glm/glm.hpp>
 #include <tuple>
+#include <memory>
 #include "face.hpp"
 #include <glm/gtx/quaternion.hpp>
 
@@ -14,7 +15,7 @@ enum class IconTextureID;
 
 class ICanvas {
 public:
-    enum class VertexType { POINT, LINE, GLYPH, GLYPH_3D, ICON, FACE_GROUP, SELECTION_INVISIBLE };
+    enum class VertexType { POINT, LINE, CURVE, GLYPH, GLYPH_3D, ICON, FACE_GROUP, SELECTION_INVISIBLE };
     struct VertexRef {
         VertexType type;
         size_t index;
@@ -24,9 +25,15 @@ public:
     };
 
     virtual void clear() = 0;
+    // everything drawn from here on until the next clear() is part of the
+    // overlay, which can be redrawn on its own, see Canvas::clear_overlay
+    virtual void begin_overlay() = 0;
     virtual VertexRef draw_point(glm::vec3 p) = 0;
     virtual VertexRef draw_line(glm::vec3 from, glm::vec3 to) = 0;
     virtual VertexRef draw_screen_line(glm::vec3 origin, glm::vec3 direction) = 0;
+    // arc in the plane spanned by the unit vectors u and v, going counterclockwise from a0 to a1,
+    // tessellated on the GPU according to its size on screen
+    virtual VertexRef draw_arc(glm::vec3 center, float radius, glm::vec3 u, glm::vec3 v, float a0, float a1) = 0;
     virtual std::vector<VertexRef> draw_bitmap_text(const glm::vec3 p, float size, const std::string &rtext) = 0;
     virtual std::vector<VertexRef> draw_bitmap_text_3d(const glm::vec3 p, const glm::quat &norm, float size,
                                                        const std::string &rtext) = 0;
@@ -35,6 +42,20 @@ public:
     enum class FaceColor { AS_IS, SOLID_MODEL, OTHER_BODY_SOLID_MODEL };
     virtual VertexRef add_face_group(const face::Faces &faces, glm::vec3 origin, glm::quat normal,
                                      FaceColor face_color) = 0;
+    // faces are drawn once for each transform in instances
+    virtual VertexRef add_face_group_instanced(const face::Faces &faces, const std::vector<glm::mat4> &instances,
+                                               glm::vec3 origin, glm::quat normal, FaceColor face_color) = 0;
+    // coarse_faces are drawn instead of faces while the view is being
+    // navigated, only worth building if get_adaptive_quality() is true
+    virtual VertexRef add_face_group_lod(const face::Faces &faces, const face::Faces &coarse_faces, glm::vec3 origin,
+                                         glm::quat normal, FaceColor face_color) = 0;
+    virtual bool get_adaptive_quality() const = 0;
+    // for faces that don't change between updates, such as imported models:
+    // they're uploaded once and stay on the GPU as long as owner is alive,
+    // part tells apart multiple face groups of the same owner
+    virtual VertexRef add_face_group_persistent(std::shared_ptr<const void> owner, unsigned int part,
+                                                const face::Faces &faces, const std::vector<glm::mat4> &instances,
+                                                glm::vec3 origin, glm::quat normal, FaceColor face_color) = 0;
     virtual VertexRef draw_icon(IconTexture::IconTextureID id, glm::vec3 origin, glm::vec2 shift,
                                 glm::vec3 v = {NAN, NAN, NAN}) = 0;
     virtual void set_vertex_inactive(bool inactive) = 0;
@@ -14,12 +14,6 @@ IconRenderer::IconRenderer(Canvas &c) : BaseRenderer(c, Canvas::VertexType::ICON
 
 GLuint IconRenderer::create_vao(GLuint program, GLuint &vbo_out)
 {
-    GLuint origin_index = glGetAttribLocation(program, "origin");
-    GLuint shift_index = glGetAttribLocation(program, "shift");
-    GLuint vec_index = glGetAttribLocation(program, "vec");
-    GLuint icon_x_index = glGetAttribLocation(program, "icon_x");
-    GLuint icon_y_index = glGetAttribLocation(program, "icon_y");
-    GLuint flags_index = glGetAttribLocation(program, "flags");
     GLuint vao, buffer;
 
     /* we need to create a VAO to store the other buffers */
@@ -33,30 +27,7 @@ GLuint IconRenderer::create_vao(GLuint program, GLuint &vbo_out)
     Canvas::IconVertex vertices[] = {{0, 0, 0, 0, 0, 0, 1}};
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
-    /* enable and set the position attribute */
-    glEnableVertexAttribArray(origin_index);
-    glVertexAttribPointer(origin_index, 3, GL_FLOAT, GL_FALSE, sizeof(Canvas::IconVertex), 0);
-    GL_CHECK_ERROR
-    glEnableVertexAttribArray(vec_index);
-    glVertexAttribPointer(vec_index, 3, GL_FLOAT, GL_FALSE, sizeof(Canvas::IconVertex),
-                          (void *)offsetof(Canvas::IconVertex, vx));
-    GL_CHECK_ERROR
-    glEnableVertexAttribArray(shift_index);
-    glVertexAttribPointer(shift_index, 2, GL_FLOAT, GL_FALSE, sizeof(Canvas::IconVertex),
-                          (void *)offsetof(Canvas::IconVertex, xs));
-    GL_CHECK_ERROR
-    glEnableVertexAttribArray(icon_x_index);
-    glVertexAttribIPointer(icon_x_index, 1, GL_UNSIGNED_SHORT, sizeof(Canvas::IconVertex),
-                           (void *)offsetof(Canvas::IconVertex, icon_x));
-    GL_CHECK_ERROR
-    glEnableVertexAttribArray(icon_y_index);
-    glVertexAttribIPointer(icon_y_index, 1, GL_UNSIGNED_SHORT, sizeof(Canvas::IconVertex),
-                           (void *)offsetof(Canvas::IconVertex, icon_y));
-    GL_CHECK_ERROR
-
-    glEnableVertexAttribArray(flags_index);
-    glVertexAttribIPointer(flags_index, 1, GL_UNSIGNED_INT, sizeof(Canvas::IconVertex),
-                           (void *)offsetof(Canvas::IconVertex, flags));
+    set_vertex_attrib_pointers(program, 0, false);
     GL_CHECK_ERROR
 
     /* enable and set the color attribute */
@@ -70,6 +41,38 @@ GLuint IconRenderer::create_vao(GLuint program, GLuint &vbo_out)
     return vao;
 }
 
+void IconRenderer::set_vertex_attrib_pointers(GLuint program, size_t first, bool instanced)
+{
+    GLuint origin_index = glGetAttribLocation(program, "origin");
+    GLuint shift_index = glGetAttribLocation(program, "shift");
+    GLuint vec_index = glGetAttribLocation(program, "vec");
+    GLuint icon_x_index = glGetAttribLocation(program, "icon_x");
+    GLuint icon_y_index = glGetAttribLocation(program, "icon_y");
+    const size_t base = first * sizeof(Canvas::IconVertex);
+
+    /* enable and set the position attribute */
+    glEnableVertexAttribArray(origin_index);
+    glVertexAttribPointer(origin_index, 3, GL_FLOAT, GL_FALSE, sizeof(Canvas::IconVertex), (void *)base);
+    glEnableVertexAttribArray(vec_index);
+    glVertexAttribPointer(vec_index, 3, GL_FLOAT, GL_FALSE, sizeof(Canvas::IconVertex),
+                          (void *)(base + offsetof(Canvas::IconVertex, vx)));
+    glEnableVertexAttribArray(shift_index);
+    glVertexAttribPointer(shift_index, 2, GL_FLOAT, GL_FALSE, sizeof(Canvas::IconVertex),
+                          (void *)(base + offsetof(Canvas::IconVertex, xs)));
+    glEnableVertexAttribArray(icon_x_index);
+    glVertexAttribIPointer(icon_x_index, 1, GL_UNSIGNED_SHORT, sizeof(Canvas::IconVertex),
+                           (void *)(base + offsetof(Canvas::IconVertex, icon_x)));
+    glEnableVertexAttribArray(icon_y_index);
+    glVertexAttribIPointer(icon_y_index, 1, GL_UNSIGNED_SHORT, sizeof(Canvas::IconVertex),
+                           (void *)(base + offsetof(Canvas::IconVertex, icon_y)));
+
+    if (instanced) {
+        for (const auto index : {origin_index, vec_index, shift_index, icon_x_index, icon_y_index})
+            glVertexAttribDivisor(index, 1);
+    }
+    set_flags_attrib_pointer(program, first, instanced);
+}
+
 void IconRenderer::realize()
 {
     glGenTextures(1, &m_texture_icon);
@@ -112,14 +115,24 @@ void IconRenderer::realize()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
 
-    m_program = gl_create_program_from_resource("/org/dune3d/dune3d/canvas/shaders/icon-vertex.glsl",
-                                                "/org/dune3d/dune3d/canvas/shaders/icon-fragment.glsl",
-                                                "/org/dune3d/dune3d/canvas/shaders/icon-geometry.glsl");
-    m_vao = create_vao(m_program, m_vbo);
+    m_program_geometry = gl_create_program_from_resource("/org/dune3d/dune3d/canvas/shaders/icon-vertex.glsl",
+                                                         "/org/dune3d/dune3d/canvas/shaders/icon-fragment.glsl",
+                                                         "/org/dune3d/dune3d/canvas/shaders/icon-geometry.glsl");
+    m_program_instanced =
+            gl_create_program_from_resource("/org/dune3d/dune3d/canvas/shaders/icon-instanced-vertex.glsl",
+                                            "/org/dune3d/dune3d/canvas/shaders/icon-fragment.glsl", nullptr);
+    m_program = m_program_geometry;
+    create_flags_vbo();
+    m_vao = create_vao(m_program_geometry, m_vbo);
+    m_vao_instanced = create_vao_instanced(m_vbo);
     m_ca.m_n_icons = 1;
 
     realize_base();
+    get_locations();
+}
 
+void IconRenderer::get_locations()
+{
     GET_LOC(this, screen);
     GET_LOC(this, tex);
     GET_LOC(this, icon_size);
@@ -132,22 +145,20 @@ void IconRenderer::push()
 {
     m_ca.m_n_icons = m_ca.m_icons.size();
     m_ca.m_n_icons_selection_invisible = m_ca.m_icons_selection_invisible.size();
+    push_vertices(m_vbo, m_ca.m_icons, m_ca.m_icons_selection_invisible);
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(Canvas::IconVertex) * (m_ca.m_n_icons + m_ca.m_n_icons_selection_invisible),
-                 nullptr, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(Canvas::IconVertex) * m_ca.m_n_icons, m_ca.m_icons.data());
-    glBufferSubData(GL_ARRAY_BUFFER, sizeof(Canvas::IconVertex) * m_ca.m_n_icons,
-                    sizeof(Canvas::IconVertex) * m_ca.m_n_icons_selection_invisible,
-                    m_ca.m_icons_selection_invisible.data());
+void IconRenderer::push_flags()
+{
+    upload_changed_flags(m_ca.m_icons);
 }
 
 void IconRenderer::render()
 {
     if (!m_ca.m_n_icons && !m_ca.m_n_icons_selection_invisible)
         return;
+    update_program();
     glUseProgram(m_program);
-    glBindVertexArray(m_vao);
     glActiveTexture(GL_TEXTURE1);
     glUniform1i(m_tex_loc, 1);
     glUniform1f(m_icon_size_loc, IconTexture::icon_size);
@@ -160,6 +171,16 @@ void IconRenderer::render()
     glUniformMatrix3fv(m_screen_loc, 1, GL_FALSE, glm::value_ptr(m_ca.m_screenmat));
     load_uniforms();
 
+    if (is_instanced()) {
+        glBindVertexArray(m_vao_instanced);
+        draw_quads(m_vbo, 0, m_ca.m_n_icons);
+        glColorMaski(1, GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        draw_quads(m_vbo, m_ca.m_n_icons, m_ca.m_n_icons_selection_invisible);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        return;
+    }
+
+    glBindVertexArray(m_vao);
     glDrawArrays(GL_POINTS, 0, m_ca.m_n_icons);
     glColorMaski(1, GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
     glDrawArrays(GL_POINTS, m_ca.m_n_icons, m_ca.m_n_icons_selection_invisible);
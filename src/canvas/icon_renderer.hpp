@@ -8,11 +8,15 @@ public:
     void realize();
     void render();
     void push();
+    void push_flags();
 
 private:
     size_t get_vertex_count() const override;
+    void get_locations() override;
+    void set_vertex_attrib_pointers(GLuint program, size_t first, bool instanced) override;
 
     GLuint m_vao;
+    GLuint m_vao_instanced;
     GLuint m_vbo;
 
     GLuint m_screen_loc;
@@ -23,7 +27,7 @@ private:
     GLuint m_texture_icon;
     GLuint m_scale_factor_loc;
 
-    static GLuint create_vao(GLuint program, GLuint &vbo_out);
+    GLuint create_vao(GLuint program, GLuint &vbo_out);
 
     unsigned int m_texture_size;
 };
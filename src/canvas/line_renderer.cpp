@@ -16,9 +16,6 @@ LineRenderer::LineRenderer(Canvas &ca) : BaseRenderer(ca, Canvas::VertexType::LI
 
 GLuint LineRenderer::create_vao(GLuint program, GLuint &vbo_out)
 {
-    GLuint p1_index = glGetAttribLocation(program, "p1");
-    GLuint p2_index = glGetAttribLocation(program, "p2");
-    GLuint flags_index = glGetAttribLocation(program, "flags");
     GLuint vao, buffer;
 
     /* we need to create a VAO to store the other buffers */
@@ -35,15 +32,7 @@ GLuint LineRenderer::create_vao(GLuint program, GLuint &vbo_out)
     };
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
-    /* enable and set the position attribute */
-    glEnableVertexAttribArray(p1_index);
-    glVertexAttribPointer(p1_index, 3, GL_FLOAT, GL_FALSE, sizeof(Canvas::LineVertex), 0);
-    glEnableVertexAttribArray(p2_index);
-    glVertexAttribPointer(p2_index, 3, GL_FLOAT, GL_FALSE, sizeof(Canvas::LineVertex),
-                          (void *)offsetof(Canvas::LineVertex, x2));
-    glEnableVertexAttribArray(flags_index);
-    glVertexAttribIPointer(flags_index, 1, GL_UNSIGNED_INT, sizeof(Canvas::LineVertex),
-                           (void *)offsetof(Canvas::LineVertex, flags));
+    set_vertex_attrib_pointers(program, 0, false);
 
     /* enable and set the color attribute */
     /* reset the state; we will re-enable the VAO when needed */
@@ -56,36 +45,68 @@ GLuint LineRenderer::create_vao(GLuint program, GLuint &vbo_out)
     return vao;
 }
 
+void LineRenderer::set_vertex_attrib_pointers(GLuint program, size_t first, bool instanced)
+{
+    GLuint p1_index = glGetAttribLocation(program, "p1");
+    GLuint p2_index = glGetAttribLocation(program, "p2");
+    const size_t base = first * sizeof(Canvas::LineVertex);
+
+    /* enable and set the position attribute */
+    glEnableVertexAttribArray(p1_index);
+    glVertexAttribPointer(p1_index, 3, GL_FLOAT, GL_FALSE, sizeof(Canvas::LineVertex), (void *)base);
+    glEnableVertexAttribArray(p2_index);
+    glVertexAttribPointer(p2_index, 3, GL_FLOAT, GL_FALSE, sizeof(Canvas::LineVertex),
+                          (void *)(base + offsetof(Canvas::LineVertex, x2)));
+
+    if (instanced) {
+        for (const auto index : {p1_index, p2_index})
+            glVertexAttribDivisor(index, 1);
+    }
+    set_flags_attrib_pointer(program, first, instanced);
+}
+
 void LineRenderer::realize()
 {
-    m_program = gl_create_program_from_resource("/org/dune3d/dune3d/canvas/shaders/line-vertex.glsl",
-                                                "/org/dune3d/dune3d/canvas/shaders/line-fragment.glsl",
-                                                "/org/dune3d/dune3d/canvas/shaders/line-geometry.glsl");
-    m_vao = create_vao(m_program, m_vbo);
+    m_program_geometry = gl_create_program_from_resource("/org/dune3d/dune3d/canvas/shaders/line-vertex.glsl",
+                                                         "/org/dune3d/dune3d/canvas/shaders/line-fragment.glsl",
+                                                         "/org/dune3d/dune3d/canvas/shaders/line-geometry.glsl");
+    m_program_instanced =
+            gl_create_program_from_resource("/org/dune3d/dune3d/canvas/shaders/line-instanced-vertex.glsl",
+                                            "/org/dune3d/dune3d/canvas/shaders/line-fragment.glsl", nullptr);
+    m_program = m_program_geometry;
+    create_flags_vbo();
+    m_vao = create_vao(m_program_geometry, m_vbo);
+    m_vao_instanced = create_vao_instanced(m_vbo);
 
     realize_base();
+    get_locations();
+}
+
+void LineRenderer::get_locations()
+{
     GET_LOC(this, screen_scale);
+    GET_LOC(this, viewport);
+    GET_LOC(this, line_width);
 }
 
 void LineRenderer::push()
 {
     m_ca.m_n_lines = m_ca.m_lines.size();
     m_ca.m_n_lines_selection_invisible = m_ca.m_lines_selection_invisible.size();
-    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(Canvas::LineVertex) * (m_ca.m_n_lines + m_ca.m_n_lines_selection_invisible),
-                 nullptr, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(Canvas::LineVertex) * m_ca.m_n_lines, m_ca.m_lines.data());
-    glBufferSubData(GL_ARRAY_BUFFER, sizeof(Canvas::LineVertex) * m_ca.m_n_lines,
-                    sizeof(Canvas::LineVertex) * m_ca.m_n_lines_selection_invisible,
-                    m_ca.m_lines_selection_invisible.data());
+    push_vertices(m_vbo, m_ca.m_lines, m_ca.m_lines_selection_invisible);
+}
+
+void LineRenderer::push_flags()
+{
+    upload_changed_flags(m_ca.m_lines);
 }
 
 void LineRenderer::render()
 {
     if (!m_ca.m_n_lines && !m_ca.m_n_lines_selection_invisible)
         return;
+    update_program();
     glUseProgram(m_program);
-    glBindVertexArray(m_vao);
 
     {
         const auto m = std::min(m_ca.m_width, m_ca.m_height);
@@ -93,6 +114,19 @@ void LineRenderer::render()
     }
     load_uniforms();
 
+    if (is_instanced()) {
+        glBindVertexArray(m_vao_instanced);
+        glUniform2f(m_viewport_loc, m_ca.m_dev_width, m_ca.m_dev_height);
+        glUniform1f(m_line_width_loc, m_ca.m_appearance.line_width * m_ca.m_scale_factor);
+
+        draw_quads(m_vbo, 0, m_ca.m_n_lines);
+        glColorMaski(1, GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        draw_quads(m_vbo, m_ca.m_n_lines, m_ca.m_n_lines_selection_invisible);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        return;
+    }
+
+    glBindVertexArray(m_vao);
 #ifndef __APPLE__
     glLineWidth(m_ca.m_appearance.line_width * m_ca.m_scale_factor);
 #endif
@@ -14,7 +14,6 @@ PointRenderer::PointRenderer(Canvas &c) : BaseRenderer(c, Canvas::VertexType::PO
 GLuint PointRenderer::create_vao(GLuint program, GLuint &vbo_out)
 {
     GLuint position_index = glGetAttribLocation(program, "position");
-    GLuint flags_index = glGetAttribLocation(program, "flags");
     GLuint vao, buffer;
 
     /* we need to create a VAO to store the other buffers */
@@ -35,9 +34,7 @@ GLuint PointRenderer::create_vao(GLuint program, GLuint &vbo_out)
     /* enable and set the position attribute */
     glEnableVertexAttribArray(position_index);
     glVertexAttribPointer(position_index, 3, GL_FLOAT, GL_FALSE, sizeof(Canvas::PointVertex), 0);
-    glEnableVertexAttribArray(flags_index);
-    glVertexAttribIPointer(flags_index, 1, GL_UNSIGNED_INT, sizeof(Canvas::PointVertex),
-                           (void *)offsetof(Canvas::PointVertex, flags));
+    set_flags_attrib_pointer(program, 0, false);
 
     /* enable and set the color attribute */
     /* reset the state; we will re-enable the VAO when needed */
@@ -54,6 +51,7 @@ void PointRenderer::realize()
 {
     m_program = gl_create_program_from_resource("/org/dune3d/dune3d/canvas/shaders/point-vertex.glsl",
                                                 "/org/dune3d/dune3d/canvas/shaders/point-fragment.glsl", nullptr);
+    create_flags_vbo();
     m_vao = create_vao(m_program, m_vbo);
     realize_base();
 
@@ -64,13 +62,12 @@ void PointRenderer::push()
 {
     m_ca.m_n_points = m_ca.m_points.size();
     m_ca.m_n_points_selection_invisible = m_ca.m_points_selection_invisible.size();
-    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(Canvas::PointVertex) * (m_ca.m_n_points + m_ca.m_n_points_selection_invisible),
-                 nullptr, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(Canvas::PointVertex) * m_ca.m_n_points, m_ca.m_points.data());
-    glBufferSubData(GL_ARRAY_BUFFER, sizeof(Canvas::PointVertex) * m_ca.m_n_points,
-                    sizeof(Canvas::PointVertex) * m_ca.m_n_points_selection_invisible,
-                    m_ca.m_points_selection_invisible.data());
+    push_vertices(m_vbo, m_ca.m_points, m_ca.m_points_selection_invisible);
+}
+
+void PointRenderer::push_flags()
+{
+    upload_changed_flags(m_ca.m_points);
 }
 
 void PointRenderer::render()
@@ -8,6 +8,7 @@ public:
     void realize();
     void render();
     void push();
+    void push_flags();
 
 private:
     size_t get_vertex_count() const override;
@@ -16,6 +17,6 @@ private:
     GLuint m_vbo;
 
     GLuint m_z_offset_loc;
-    static GLuint create_vao(GLuint program, GLuint &vbo_out);
+    GLuint create_vao(GLuint program, GLuint &vbo_out);
 };
 } // namespace dune3d
@@ -0,0 +1,6 @@
+#pragma once
+
+namespace dune3d {
+// how lines, glyphs and icons get expanded into screen-space primitives
+enum class PrimitiveMode { GEOMETRY_SHADER, INSTANCED };
+}
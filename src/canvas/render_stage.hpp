@@ -0,0 +1,8 @@
+#pragma once
+#include <cstddef>
+
+namespace dune3d {
+// parts of a frame whose GPU time gets measured, in the order they're rendered
+enum class RenderStage { BACKGROUND, FACES, POINTS, LINES, CURVES, GLYPHS, GLYPHS_3D, ICONS, OVERLAYS };
+static constexpr size_t n_render_stages = static_cast<size_t>(RenderStage::OVERLAYS) + 1;
+} // namespace dune3d
@@ -31,3 +31,12 @@ public:
     friend bool operator==(const SelectableRef &, const SelectableRef &) = default;
 };
 } // namespace dune3d
+
+namespace std {
+template <> struct hash<dune3d::SelectableRef> {
+    std::size_t operator()(const dune3d::SelectableRef &k) const
+    {
+        return k.item.hash() ^ (static_cast<std::size_t>(k.type) << 8) ^ k.point;
+    }
+};
+} // namespace std
@@ -0,0 +1,59 @@
+#version 330
+layout(points) in;
+// stays within the guaranteed 1024 output components
+layout(line_strip, max_vertices = 121) out;
+
+#define MAX_SEGMENTS 120
+#define MIN_SEGMENTS 4
+// maximum distance between the arc and its segments in pixels
+#define TOLERANCE .25
+
+in vec3 center_to_geom[1];
+in float radius_to_geom[1];
+in vec3 u_to_geom[1];
+in vec3 v_to_geom[1];
+in vec2 angles_to_geom[1];
+in uint flags_to_geom[1];
+flat in uint pick_to_geom[1];
+flat out uint pick_to_frag;
+flat out vec3 color_to_frag;
+
+uniform mat4 view;
+uniform mat4 proj;
+uniform vec2 viewport;
+
+##ubo
+
+vec4 project(vec3 p) {
+	return proj*view*vec4(p, 1);
+}
+
+vec2 to_pixels(vec4 p) {
+	return p.xy / p.w * viewport * .5;
+}
+
+void main() {
+	vec3 center = center_to_geom[0];
+	float radius = radius_to_geom[0];
+	vec3 u = u_to_geom[0]*radius;
+	vec3 v = v_to_geom[0]*radius;
+	float a0 = angles_to_geom[0].x;
+	float span = angles_to_geom[0].y - a0;
+
+	vec2 center_px = to_pixels(project(center));
+	float radius_px = max(length(to_pixels(project(center+u)) - center_px),
+	                      length(to_pixels(project(center+v)) - center_px));
+	radius_px = clamp(radius_px, TOLERANCE, 1e5);
+	float dphi = 2*acos(1-TOLERANCE/radius_px);
+	int segments = int(clamp(ceil(abs(span)/dphi), float(MIN_SEGMENTS), float(MAX_SEGMENTS)));
+
+	vec3 color = get_color(flags_to_geom[0]);
+	for(int i = 0; i <= segments; i++) {
+		float a = a0 + span*float(i)/float(segments);
+		color_to_frag = color;
+		pick_to_frag = pick_to_geom[0];
+		gl_Position = project(center + cos(a)*u + sin(a)*v);
+		EmitVertex();
+	}
+	EndPrimitive();
+}
@@ -0,0 +1,26 @@
+#version 330
+layout(location=0) in vec3 center;
+layout(location=1) in float radius;
+layout(location=2) in vec3 u;
+layout(location=3) in vec3 v;
+layout(location=4) in vec2 angles;
+layout(location=5) in uint flags;
+
+out vec3 center_to_geom;
+out float radius_to_geom;
+out vec3 u_to_geom;
+out vec3 v_to_geom;
+out vec2 angles_to_geom;
+out uint flags_to_geom;
+flat out uint pick_to_geom;
+uniform uint pick_base;
+
+void main() {
+	pick_to_geom = uint(gl_VertexID+int(pick_base));
+	center_to_geom = center;
+	radius_to_geom = radius;
+	u_to_geom = u;
+	v_to_geom = v;
+	angles_to_geom = angles;
+	flags_to_geom = flags;
+}
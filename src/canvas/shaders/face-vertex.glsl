@@ -3,27 +3,40 @@
 in vec3 position;
 in vec3 normal;
 in vec3 color;
+in uint group;
 
 out vec3 normal_to_fragment;
 out vec3 color_to_fragment;
 out vec3 pos_to_fragment;
+flat out uint flags_to_fragment;
+flat out uint pick_to_fragment;
 
 uniform mat4 view;
 uniform mat4 proj;
-uniform vec3 origin;
-uniform mat3 normal_mat;
-uniform vec3 override_color;
+uniform uint pick_base;
+// per-group parameters and per-instance transforms, see FaceRenderer::push_groups
+uniform samplerBuffer groups;
+uniform samplerBuffer instances;
 
 void main()
 {
-    // gl_Position = proj*view*vec4(position, 1, 1);
+    int g = int(group) * 6;
+    vec4 origin_flags = texelFetch(groups, g);
+    vec4 override_color = texelFetch(groups, g+1);
+    mat3 normal_mat = mat3(texelFetch(groups, g+2).xyz, texelFetch(groups, g+3).xyz, texelFetch(groups, g+4).xyz);
+    int inst = (int(texelFetch(groups, g+5).x) + gl_InstanceID) * 4;
+    mat4 instance_transform = mat4(texelFetch(instances, inst), texelFetch(instances, inst+1),
+                                   texelFetch(instances, inst+2), texelFetch(instances, inst+3));
+
     color_to_fragment = color;
-    if(!isnan(override_color.r))
-        color_to_fragment = override_color;
-    vec4 p4 = vec4(position*normal_mat + origin, 1);
-    vec4 n4 = vec4(normal, 0);
+    if(override_color.w != 0)
+        color_to_fragment = override_color.rgb;
+    vec4 p4 = vec4((instance_transform * vec4(position, 1)).xyz*normal_mat + origin_flags.xyz, 1);
+    vec4 n4 = instance_transform * vec4(normal, 0);
 
     gl_Position = (proj * view) * p4;
     pos_to_fragment = p4.xyz;
     normal_to_fragment = normalize(n4.xyz);
+    flags_to_fragment = uint(origin_flags.w);
+    pick_to_fragment = pick_base + group;
 }
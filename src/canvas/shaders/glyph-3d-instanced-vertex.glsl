@@ -0,0 +1,31 @@
+#version 330
+in vec2 corner;
+in vec3 origin;
+in vec3 right;
+in vec3 up;
+in uint bits;
+in uint flags;
+
+flat out uint pick_to_frag;
+flat out vec3 color_to_frag;
+smooth out vec2 texcoord_to_fragment;
+uniform uint pick_base;
+
+uniform mat4 view;
+uniform mat4 proj;
+
+##ubo
+
+void main() {
+	pick_to_frag = uint(gl_InstanceID+int(pick_base));
+	color_to_frag = get_color(flags);
+
+	vec4 o = (proj*view*vec4(origin, 1));
+	vec4 r = (proj*view*vec4(right, 0));
+	vec4 u = (proj*view*vec4(up, 0));
+
+	GlyphInfo glyph = unpack_glyph_info(bits);
+
+	gl_Position = o+r*corner.x+u*corner.y;
+	texcoord_to_fragment = (vec2(glyph.x,glyph.y)+vec2(glyph.w,glyph.h)*corner)/1024;
+}
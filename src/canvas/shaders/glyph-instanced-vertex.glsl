@@ -0,0 +1,35 @@
+#version 330
+in vec2 corner;
+in vec3 origin;
+in vec2 shift;
+in float scale;
+in uint bits;
+in uint flags;
+
+flat out uint pick_to_frag;
+flat out vec3 color_to_frag;
+smooth out vec2 texcoord_to_fragment;
+uniform uint pick_base;
+
+uniform mat4 view;
+uniform mat4 proj;
+uniform mat3 screen;
+uniform float scale_factor;
+
+##ubo
+
+void main() {
+	pick_to_frag = uint(gl_InstanceID+int(pick_base));
+	color_to_frag = get_color(flags);
+
+	vec4 o = (proj*view*vec4(origin, 1));
+	o /= o.w;
+	vec4 sh = vec4(screen * vec3(shift * scale_factor, 0), 0);
+
+	GlyphInfo glyph = unpack_glyph_info(bits);
+	vec3 sz = vec3(glyph.w, -glyph.h, 0)*scale*scale_factor;
+	vec4 size = vec4(screen * sz, 0);
+
+	gl_Position = o+sh+vec4(size.xy*corner, 0, 0);
+	texcoord_to_fragment = (vec2(glyph.x,glyph.y)+vec2(glyph.w,glyph.h)*corner)/1024;
+}
@@ -35,6 +35,8 @@ vec2 scale_size(vec2 v)
 }
 
 void main() {
+	if(FLAG_IS_SET(flags_to_geom[0], VERTEX_FLAG_HIDDEN))
+		return;
 	color_to_frag = get_color(flags_to_geom[0]);
 	
 	vec4 o = origin_to_geom[0];
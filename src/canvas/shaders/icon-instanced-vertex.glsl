@@ -0,0 +1,57 @@
+#version 330
+in vec2 corner;
+in vec3 origin;
+in vec2 shift;
+in uint icon_x;
+in uint icon_y;
+in uint flags;
+in vec3 vec;
+
+flat out uint pick_to_frag;
+flat out vec3 color_to_frag;
+smooth out vec2 texcoord_to_fragment;
+uniform uint pick_base;
+
+uniform mat4 view;
+uniform mat4 proj;
+uniform mat3 screen;
+uniform float icon_size;
+uniform float icon_border;
+uniform float texture_size;
+uniform float scale_factor;
+
+##ubo
+
+vec2 rot(vec2 v, vec2 sh) {
+	return vec2(sh.x * v.x - sh.y * v.y, sh.x * v.y + sh.y * v.x);
+}
+
+void main() {
+	pick_to_frag = uint(gl_InstanceID+int(pick_base));
+	color_to_frag = get_color(flags);
+
+	vec4 o = (proj*view*vec4(origin, 1));
+	o /= o.w;
+
+	vec2 v = vec2(1,0);
+	if(!isnan(vec.x)) {
+		vec3 t = screen*vec3(1,-1,0);
+		vec4 v4 = proj*view*vec4(vec, 0);
+		v4.y *= -1;
+		v = normalize(v4.xy/t.xy);
+		if(v.x < v.y)
+			v *= -1;
+	}
+
+	vec4 sh = vec4(screen * vec3(rot(v, shift)*icon_size*scale_factor, 0), 0);
+
+	vec3 sz = vec3(icon_size, icon_size, 0) * scale_factor / 2;
+	sz.xy *= rot(v, corner*2-1);
+
+	vec2 icon_pos = vec2(icon_x, icon_y) * (icon_size + 2*icon_border) + vec2(1.5,1.5);
+
+	gl_Position = o+sh+vec4((screen * sz).xy, 0, 0);
+	if(FLAG_IS_SET(flags, VERTEX_FLAG_HIDDEN))
+		gl_Position = vec4(2, 2, 2, 1); // outside of the clip volume
+	texcoord_to_fragment = (icon_pos+corner*icon_size)/texture_size;
+}
@@ -0,0 +1,51 @@
+#version 330
+in vec2 corner;
+in vec3 p1;
+in vec3 p2;
+in uint flags;
+
+flat out uint pick_to_frag;
+flat out vec3 color_to_frag;
+uniform uint pick_base;
+
+uniform mat4 view;
+uniform mat4 proj;
+uniform float screen_scale;
+uniform vec2 viewport;
+uniform float line_width;
+
+##ubo
+
+void main() {
+	pick_to_frag = uint(gl_InstanceID+int(pick_base));
+	color_to_frag = get_color(flags);
+	vec4 a;
+	vec4 b;
+	if(FLAG_IS_SET(flags, VERTEX_FLAG_SCREEN)) { //screen
+		a = (proj*view*vec4(p1, 1));
+		a /= a.w;
+		vec4 tx = (proj*view*vec4(p1+vec3(1,0,0), 1));
+		tx /= tx.w;
+		tx.xyz -= a.xyz;
+		vec4 ty = (proj*view*vec4(p1+vec3(0,1,0), 1));
+		ty /= ty.w;
+		ty.xyz -= a.xyz;
+		vec4 tz = (proj*view*vec4(p1+vec3(0,0,1), 1));
+		tz /= tz.w;
+		tz.xyz -= a.xyz;
+		float s = max(length(tx.xyz), max(length(ty.xyz), length(tz.xyz)));
+		vec3 d = (tx.xyz*p2.x + ty.xyz*p2.y + tz.xyz*p2.z)/s * screen_scale;
+		b = vec4(a.xyz + d, 1);
+	}
+	else {
+		a = (proj*view*vec4(p1, 1));
+		b = (proj*view*vec4(p2, 1));
+	}
+
+	// widen the segment to a quad that's line_width pixels across
+	vec2 dir = (b.xy/b.w - a.xy/a.w) * viewport;
+	vec2 n = length(dir) > 0 ? normalize(vec2(-dir.y, dir.x)) : vec2(0, 1);
+	vec4 p = mix(a, b, corner.x);
+	p.xy += n * (corner.y - .5) * line_width * 2 / viewport * p.w;
+	gl_Position = p;
+}
@@ -0,0 +1,9 @@
+#version 330
+layout(location = 0) out vec4 outputColor;
+layout(location = 1) out uint pick;
+uniform vec4 color;
+
+void main() {
+	outputColor = color;
+	pick = 0u;
+}
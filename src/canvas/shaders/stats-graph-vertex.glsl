@@ -0,0 +1,7 @@
+#version 330
+in vec2 position;
+uniform mat3 screenmat;
+
+void main() {
+	gl_Position = vec4(screenmat*vec3(position, 1), 1);
+}
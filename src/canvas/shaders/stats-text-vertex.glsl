@@ -0,0 +1,25 @@
+#version 330
+in vec2 corner;
+in vec2 position;
+in float scale;
+in uint bits;
+
+flat out uint pick_to_frag;
+flat out vec3 color_to_frag;
+smooth out vec2 texcoord_to_fragment;
+
+uniform mat3 screenmat;
+uniform vec3 color;
+
+void main() {
+	pick_to_frag = 0u;
+	color_to_frag = color;
+
+	// same packing as unpack_glyph_info in ubo.glsl
+	vec2 glyph_pos = vec2((bits>>22)&uint(0x3ff), (bits>>12)&uint(0x3ff));
+	vec2 glyph_size = vec2((bits>>6)&uint(0x3f), (bits>>0)&uint(0x3f));
+
+	vec2 p = position + vec2(glyph_size.x, -glyph_size.y)*scale*corner;
+	gl_Position = vec4(screenmat*vec3(p, 1), 1);
+	texcoord_to_fragment = (glyph_pos+glyph_size*corner)/1024;
+}
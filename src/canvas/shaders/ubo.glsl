@@ -6,6 +6,7 @@
 #define VERTEX_FLAG_CONSTRUCTION (1u << 4)
 #define VERTEX_FLAG_HIGHLIGHT (1u << 5)
 #define VERTEX_FLAG_SCREEN (1u << 6)
+#define VERTEX_FLAG_HIDDEN (1u << 7)
 #define VERTEX_FLAG_COLOR_MASK (VERTEX_FLAG_SELECTED | VERTEX_FLAG_HOVER | VERTEX_FLAG_INACTIVE | VERTEX_FLAG_CONSTRAINT | VERTEX_FLAG_CONSTRUCTION | VERTEX_FLAG_HIGHLIGHT)
 
 #define FLAG_IS_SET(x, flag) (((x) & (flag)) != 0u)
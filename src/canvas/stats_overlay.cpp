@@ -0,0 +1,314 @@
+#include "stats_overlay.hpp"
+#include "canvas.hpp"
+#include "gl_util.hpp"
+#include "color_palette.hpp"
+#include "bitmap_font_util.hpp"
+#include <glm/gtc/type_ptr.hpp>
+#include <glibmm/ustring.h>
+#include <algorithm>
+#include <format>
+
+namespace dune3d {
+
+void StatsOverlay::History::add(float v)
+{
+    m_values.at(m_pos) = v;
+    m_pos = (m_pos + 1) % m_values.size();
+}
+
+float StatsOverlay::History::get(size_t i) const
+{
+    return m_values.at((m_pos + i) % m_values.size());
+}
+
+float StatsOverlay::History::get_max() const
+{
+    return *std::max_element(m_values.begin(), m_values.end());
+}
+
+void StatsOverlay::realize()
+{
+    m_text_program = gl_create_program_from_resource("/org/dune3d/dune3d/canvas/shaders/stats-text-vertex.glsl",
+                                                     "/org/dune3d/dune3d/canvas/shaders/glyph-fragment.glsl", nullptr);
+    m_graph_program =
+            gl_create_program_from_resource("/org/dune3d/dune3d/canvas/shaders/stats-graph-vertex.glsl",
+                                            "/org/dune3d/dune3d/canvas/shaders/stats-graph-fragment.glsl", nullptr);
+
+    {
+        glGenVertexArrays(1, &m_text_vao);
+        glBindVertexArray(m_text_vao);
+
+        /* each glyph is drawn as an instance of the unit quad */
+        static const float corners[] = {0, 0, 1, 0, 0, 1, 1, 1};
+        GLuint quad_buffer;
+        glGenBuffers(1, &quad_buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, quad_buffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+        GLuint corner_index = glGetAttribLocation(m_text_program, "corner");
+        glEnableVertexAttribArray(corner_index);
+        glVertexAttribPointer(corner_index, 2, GL_FLOAT, GL_FALSE, 0, 0);
+
+        glGenBuffers(1, &m_text_vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, m_text_vbo);
+        GLuint position_index = glGetAttribLocation(m_text_program, "position");
+        GLuint scale_index = glGetAttribLocation(m_text_program, "scale");
+        GLuint bits_index = glGetAttribLocation(m_text_program, "bits");
+        glEnableVertexAttribArray(position_index);
+        glVertexAttribPointer(position_index, 2, GL_FLOAT, GL_FALSE, sizeof(GlyphVertex), 0);
+        glEnableVertexAttribArray(scale_index);
+        glVertexAttribPointer(scale_index, 1, GL_FLOAT, GL_FALSE, sizeof(GlyphVertex),
+                              (void *)offsetof(GlyphVertex, scale));
+        glEnableVertexAttribArray(bits_index);
+        glVertexAttribIPointer(bits_index, 1, GL_UNSIGNED_INT, sizeof(GlyphVertex),
+                               (void *)offsetof(GlyphVertex, bits));
+        for (const auto index : {position_index, scale_index, bits_index})
+            glVertexAttribDivisor(index, 1);
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+    }
+    {
+        glGenVertexArrays(1, &m_graph_vao);
+        glBindVertexArray(m_graph_vao);
+        glGenBuffers(1, &m_graph_vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, m_graph_vbo);
+        GLuint position_index = glGetAttribLocation(m_graph_program, "position");
+        glEnableVertexAttribArray(position_index);
+        glVertexAttribPointer(position_index, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), 0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+    }
+
+    m_text_screenmat_loc = glGetUniformLocation(m_text_program, "screenmat");
+    m_text_color_loc = glGetUniformLocation(m_text_program, "color");
+    m_text_msdf_loc = glGetUniformLocation(m_text_program, "msdf");
+    m_graph_screenmat_loc = glGetUniformLocation(m_graph_program, "screenmat");
+    m_graph_color_loc = glGetUniformLocation(m_graph_program, "color");
+}
+
+void StatsOverlay::set_active(bool active)
+{
+    m_active = active;
+    m_ca.queue_draw();
+}
+
+void StatsOverlay::add_frame(float cpu_time, std::optional<float> pick_time)
+{
+    m_cpu_time = cpu_time;
+    m_cpu_history.add(cpu_time);
+    if (pick_time)
+        m_pick_time = *pick_time;
+}
+
+void StatsOverlay::set_gpu_times(float total, const std::vector<float> &stages)
+{
+    m_gpu_time = total;
+    m_gpu_history.add(total);
+    for (size_t i = 0; i < std::min(stages.size(), m_stage_times.size()); i++)
+        m_stage_times.at(i) = stages.at(i);
+}
+
+void StatsOverlay::set_timing(const std::string &label, float ms)
+{
+    m_timings[label] = ms;
+}
+
+void StatsOverlay::set_cache_stats(const std::string &label, const CacheStats &stats)
+{
+    m_cache_stats[label] = stats;
+}
+
+static const float char_space = 1;
+
+void StatsOverlay::add_text(glm::vec2 baseline, float scale, const std::string &rtext)
+{
+    Glib::ustring text(rtext);
+    float x = 0;
+    for (auto codepoint : text) {
+        if (codepoint != ' ') {
+            auto info = bitmap_font::get_glyph_info(codepoint);
+            if (!info.is_valid())
+                info = bitmap_font::get_glyph_info('?');
+            m_glyphs.push_back({
+                    .x = baseline.x + x + info.minx * scale,
+                    .y = baseline.y - info.miny * scale,
+                    .scale = scale,
+                    .bits = info.pack_bits(),
+            });
+            x += info.advance * char_space * scale;
+        }
+        else {
+            x += 7 * char_space * scale;
+        }
+    }
+}
+
+static std::string format_bytes(size_t bytes)
+{
+    if (bytes < 1024)
+        return std::format("{} B", bytes);
+    else if (bytes < 1024 * 1024)
+        return std::format("{:.1f} KiB", bytes / 1024.);
+    else
+        return std::format("{:.1f} MiB", bytes / (1024. * 1024.));
+}
+
+static std::string format_ms(float ms)
+{
+    return std::format("{:.2f} ms", ms);
+}
+
+void StatsOverlay::render()
+{
+    if (!m_active)
+        return;
+
+    using VT = Canvas::VertexType;
+    struct Row {
+        RenderStage stage;
+        const char *name;
+        std::optional<VT> type;
+    };
+    static const std::array<Row, n_render_stages> rows = {{
+            {RenderStage::BACKGROUND, "Background", {}},
+            {RenderStage::FACES, "Face groups", VT::FACE_GROUP},
+            {RenderStage::POINTS, "Points", VT::POINT},
+            {RenderStage::LINES, "Lines", VT::LINE},
+            {RenderStage::CURVES, "Curves", VT::CURVE},
+            {RenderStage::GLYPHS, "Glyphs", VT::GLYPH},
+            {RenderStage::GLYPHS_3D, "3D glyphs", VT::GLYPH_3D},
+            {RenderStage::ICONS, "Icons", VT::ICON},
+            {RenderStage::OVERLAYS, "Overlays", {}},
+    }};
+
+    auto get_count = [this](VT type) -> size_t {
+        switch (type) {
+        case VT::FACE_GROUP:
+            return m_ca.m_face_groups.size();
+        case VT::POINT:
+            return m_ca.m_points.size();
+        case VT::LINE:
+            return m_ca.m_lines.size();
+        case VT::CURVE:
+            return m_ca.m_curves.size();
+        case VT::GLYPH:
+            return m_ca.m_glyphs.size();
+        case VT::GLYPH_3D:
+            return m_ca.m_glyphs_3d.size();
+        case VT::ICON:
+            return m_ca.m_icons.size();
+        default:
+            return 0;
+        }
+    };
+
+    size_t n_triangles = 0;
+    for (const auto &group : m_ca.m_face_groups) {
+        const auto length = (m_ca.m_navigating && group.coarse_length) ? group.coarse_length : group.length;
+        n_triangles += length / 3 * group.instance_count;
+    }
+
+    const float sf = m_ca.m_scale_factor;
+    const float text_scale = .75 * sf;
+    const float line_height = 16 * sf;
+    const float margin = 8 * sf;
+    const float padding = 8 * sf;
+    const std::array<float, 4> columns = {0, 100 * sf, 190 * sf, 270 * sf};
+    const float graph_width = history_size * 3 * sf;
+    const float graph_height = 60 * sf;
+    const float width = std::max(columns.back() + 80 * sf, graph_width) + 2 * padding;
+
+    m_glyphs.clear();
+    const glm::vec2 origin(margin, margin);
+    glm::vec2 baseline = origin + glm::vec2(padding, padding + line_height * .8f);
+    auto add_row = [&](const std::array<std::string, 4> &cells) {
+        for (size_t i = 0; i < cells.size(); i++)
+            add_text(baseline + glm::vec2(columns.at(i), 0), text_scale, cells.at(i));
+        baseline.y += line_height;
+    };
+
+    add_row({"CPU " + format_ms(m_cpu_time), "GPU " + format_ms(m_gpu_time), "Picks " + format_ms(m_pick_time), ""});
+    for (const auto &[label, ms] : m_timings)
+        add_row({label, format_ms(ms), "", ""});
+    baseline.y += line_height / 2;
+    add_row({"", "Count", "GPU", "Upload"});
+    for (const auto &row : rows) {
+        std::string count, upload;
+        if (row.type) {
+            count = std::to_string(get_count(*row.type));
+            upload = format_bytes(m_ca.m_uploaded_bytes.at(static_cast<size_t>(*row.type)));
+        }
+        add_row({row.name, count, format_ms(m_stage_times.at(static_cast<size_t>(row.stage))), upload});
+    }
+    add_row({"Triangles", std::to_string(n_triangles), "", ""});
+    if (m_cache_stats.size()) {
+        baseline.y += line_height / 2;
+        add_row({"Cache", "Hits", "Misses", "Evicted"});
+        for (const auto &[label, stats] : m_cache_stats) {
+            add_row({label, std::to_string(stats.hits), std::to_string(stats.misses),
+                     std::to_string(stats.evictions)});
+        }
+    }
+
+    // history of CPU and GPU frame times, scaled to fit
+    float full_scale = 10;
+    while (full_scale < std::max(m_cpu_history.get_max(), m_gpu_history.get_max()))
+        full_scale *= 2;
+    const glm::vec2 graph_origin(origin.x + padding, baseline.y);
+    add_text(graph_origin + glm::vec2(0, line_height * .8f), text_scale, std::format("{:.0f} ms", full_scale));
+    const float graph_bottom = graph_origin.y + graph_height;
+    const float height = graph_bottom + padding - origin.y;
+
+    m_graph_vertices.clear();
+    m_graph_vertices.emplace_back(origin.x, origin.y);
+    m_graph_vertices.emplace_back(origin.x + width, origin.y);
+    m_graph_vertices.emplace_back(origin.x, origin.y + height);
+    m_graph_vertices.emplace_back(origin.x + width, origin.y + height);
+    m_graph_vertices.emplace_back(graph_origin.x, graph_origin.y);
+    m_graph_vertices.emplace_back(graph_origin.x + graph_width, graph_origin.y);
+    for (const auto history : {&m_cpu_history, &m_gpu_history}) {
+        for (size_t i = 0; i < history_size; i++) {
+            const float x = graph_origin.x + graph_width * i / (history_size - 1);
+            const float y = graph_bottom - graph_height * std::min(history->get(i) / full_scale, 1.f);
+            m_graph_vertices.emplace_back(x, y);
+        }
+    }
+
+    glColorMaski(1, GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+    glUseProgram(m_graph_program);
+    glBindVertexArray(m_graph_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_graph_vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec2) * m_graph_vertices.size(), m_graph_vertices.data(),
+                 GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glUniformMatrix3fv(m_graph_screenmat_loc, 1, GL_FALSE, glm::value_ptr(m_ca.m_screenmat));
+    const auto &appearance = m_ca.m_appearance;
+    gl_color_to_uniform_4f(m_graph_color_loc, appearance.get_color(ColorP::BACKGROUND_BOTTOM), .85);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    gl_color_to_uniform_4f(m_graph_color_loc, appearance.get_color(ColorP::INACTIVE_ENTITY));
+    glDrawArrays(GL_LINES, 4, 2);
+    gl_color_to_uniform_4f(m_graph_color_loc, appearance.get_color(ColorP::HOVER));
+    glDrawArrays(GL_LINE_STRIP, 6, history_size);
+    gl_color_to_uniform_4f(m_graph_color_loc, appearance.get_color(ColorP::CONSTRAINT));
+    glDrawArrays(GL_LINE_STRIP, 6 + history_size, history_size);
+
+    glUseProgram(m_text_program);
+    glBindVertexArray(m_text_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_text_vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(GlyphVertex) * m_glyphs.size(), m_glyphs.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glUniformMatrix3fv(m_text_screenmat_loc, 1, GL_FALSE, glm::value_ptr(m_ca.m_screenmat));
+    gl_color_to_uniform_3f(m_text_color_loc, appearance.get_color(ColorP::ENTITY));
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_ca.m_glyph_renderer.get_texture());
+    glUniform1i(m_text_msdf_loc, 0);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, m_glyphs.size());
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+    glBindVertexArray(0);
+    glUseProgram(0);
+}
+
+} // namespace dune3d
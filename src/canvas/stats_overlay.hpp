@@ -0,0 +1,94 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <epoxy/gl.h>
+#include "render_stage.hpp"
+#include <array>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace dune3d {
+
+class Canvas;
+
+// Frame times and scene statistics drawn on top of the canvas
+class StatsOverlay {
+public:
+    void realize();
+    void render();
+
+    void set_active(bool active);
+    bool get_active() const
+    {
+        return m_active;
+    }
+
+    void add_frame(float cpu_time, std::optional<float> pick_time);
+    void set_gpu_times(float total, const std::vector<float> &stages);
+    // for things that happen outside of the canvas, such as updating the document
+    void set_timing(const std::string &label, float ms);
+
+    struct CacheStats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0;
+    };
+    void set_cache_stats(const std::string &label, const CacheStats &stats);
+
+    StatsOverlay(Canvas &c) : m_ca(c)
+    {
+    }
+
+private:
+    Canvas &m_ca;
+    bool m_active = false;
+
+    GLuint m_text_program;
+    GLuint m_text_vao;
+    GLuint m_text_vbo;
+    GLuint m_text_screenmat_loc;
+    GLuint m_text_color_loc;
+    GLuint m_text_msdf_loc;
+
+    GLuint m_graph_program;
+    GLuint m_graph_vao;
+    GLuint m_graph_vbo;
+    GLuint m_graph_screenmat_loc;
+    GLuint m_graph_color_loc;
+
+    static constexpr size_t history_size = 120;
+    class History {
+    public:
+        void add(float v);
+        // oldest first
+        float get(size_t i) const;
+        float get_max() const;
+
+    private:
+        std::array<float, history_size> m_values = {};
+        size_t m_pos = 0;
+    };
+    History m_cpu_history;
+    History m_gpu_history;
+
+    float m_cpu_time = 0;
+    float m_gpu_time = 0;
+    float m_pick_time = 0;
+    std::array<float, n_render_stages> m_stage_times = {};
+    std::map<std::string, float> m_timings;
+    std::map<std::string, CacheStats> m_cache_stats;
+
+    struct GlyphVertex {
+        float x;
+        float y;
+        float scale;
+        uint32_t bits;
+    };
+    std::vector<GlyphVertex> m_glyphs;
+    std::vector<glm::vec2> m_graph_vertices;
+
+    void add_text(glm::vec2 baseline, float scale, const std::string &text);
+};
+} // namespace dune3d
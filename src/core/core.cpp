@@ -4,6 +4,7 @@
 #include "nlohmann/json.hpp"
 #include "tool_id.hpp"
 #include "document/document.hpp"
+#include "document/document_binary.hpp"
 #include "document/group/group.hpp"
 #include "document/group/group_extrude.hpp"
 #include "document/entity/entity_workplane.hpp"
@@ -15,6 +16,7 @@ namespace dune3d {
 
 Core::Core(EditorInterface &intf) : m_intf(intf)
 {
+    m_saver.signal_finished().connect(sigc::mem_fun(*this, &Core::handle_save_finished));
 }
 
 Core::~Core() = default;
@@ -58,6 +60,11 @@ UUID Core::add_document(const std::filesystem::path &path)
 
 void Core::close_document(const UUID &uu)
 {
+    // the user chose to keep or discard the changes, so the autosave isn't needed anymore
+    if (auto it = m_documents.find(uu); it != m_documents.end() && it->second.has_path()) {
+        std::error_code ec;
+        std::filesystem::remove(get_autosave_path(it->second.m_path), ec);
+    }
     m_documents.erase(uu);
     if (m_current_document == uu && m_documents.size()) {
         m_current_document = m_documents.begin()->first;
@@ -124,6 +131,16 @@ Core::DocumentInfo::DocumentInfo(const UUID &uu, const std::filesystem::path &pa
 {
     history_push("init");
     m_current_group = m_doc->get_groups_sorted().back()->m_uuid;
+
+    if (!has_path())
+        return;
+    const auto autosave_path = get_autosave_path(path);
+    std::error_code ec;
+    if (std::filesystem::exists(autosave_path, ec)
+        && std::filesystem::last_write_time(autosave_path, ec) > std::filesystem::last_write_time(path, ec)) {
+        Logger::log_warning("found autosave newer than the document, open it to recover unsaved changes",
+                            Logger::Domain::DOCUMENT, path_to_string(autosave_path));
+    }
 }
 
 
@@ -145,6 +162,12 @@ void Core::DocumentInfo::history_push(const std::string &comment)
     m_history_manager.push(std::make_unique<HistoryItemDocument>(m_doc.value(), comment));
 }
 
+std::shared_ptr<const Document> Core::DocumentInfo::get_snapshot() const
+{
+    auto item = m_history_manager.get_current_shared();
+    return {item, &dynamic_cast<const HistoryItemDocument &>(*item).document};
+}
+
 void Core::DocumentInfo::history_load(const HistoryManager::HistoryItem &it)
 {
     auto &itd = dynamic_cast<const HistoryItemDocument &>(it);
@@ -177,21 +200,49 @@ bool Core::DocumentInfo::redo()
     return true;
 }
 
-void Core::DocumentInfo::save()
+void Core::DocumentInfo::save(DocumentSaver &saver)
 {
     if (is_read_only())
         return;
     if (has_path()) {
         m_doc->m_version.update_file_from_app();
-        save_json_to_file(m_path, m_doc->serialize());
+        // the last history item is what has been committed, so there's no need to copy the document
+        saver.enqueue({.doc = m_uuid,
+                       .kind = DocumentSaver::Kind::SAVE,
+                       .snapshot = get_snapshot(),
+                       .path = m_path,
+                       .autosave_path = get_autosave_path(m_path)});
+        m_last_autosave.reset();
         m_needs_save = false;
     }
 }
 
-void Core::DocumentInfo::save_as(const std::filesystem::path &path)
+void Core::DocumentInfo::save_as(const std::filesystem::path &path, DocumentSaver &saver)
 {
     m_path = path;
-    save();
+    save(saver);
+}
+
+void Core::DocumentInfo::autosave(DocumentSaver &saver)
+{
+    if (is_read_only() || !has_path() || !m_needs_save)
+        return;
+    auto item = m_history_manager.get_current_shared();
+    if (m_last_autosave.lock() == item)
+        return;
+    m_last_autosave = item;
+    saver.enqueue({.doc = m_uuid,
+                   .kind = DocumentSaver::Kind::AUTOSAVE,
+                   .snapshot = get_snapshot(),
+                   .path = get_autosave_path(m_path)});
+}
+
+std::filesystem::path Core::get_autosave_path(const std::filesystem::path &path)
+{
+    auto autosave_path = path;
+    autosave_path += ".autosave";
+    autosave_path += BinaryDocument::suffix;
+    return autosave_path;
 }
 
 bool Core::DocumentInfo::has_path() const
@@ -237,6 +288,14 @@ std::set<SelectableRef> Core::get_tool_selection() const
         return m_last_tool_selection;
 }
 
+std::set<UUID> Core::get_tool_overlay_entities() const
+{
+    if (m_tool)
+        return m_tool->get_overlay_entities();
+    else
+        return {};
+}
+
 Core::CanBeginInfo Core::tool_can_begin(ToolID tool_id, const std::set<SelectableRef> &sel)
 {
     if (!has_documents())
@@ -440,7 +499,7 @@ bool Core::is_read_only() const
 void Core::save_all()
 {
     for (auto &[uu, doc] : m_documents) {
-        doc.save();
+        doc.save(m_saver);
     }
     m_signal_needs_save.emit();
 }
@@ -449,7 +508,7 @@ void Core::save()
 {
     if (!has_documents())
         return;
-    get_current_document_info().save();
+    get_current_document_info().save(m_saver);
     m_signal_needs_save.emit();
 }
 
@@ -457,7 +516,43 @@ void Core::save_as(const std::filesystem::path &path)
 {
     if (!has_documents())
         return;
-    get_current_document_info().save_as(path);
+    get_current_document_info().save_as(path, m_saver);
+    m_signal_needs_save.emit();
+}
+
+bool Core::is_saving() const
+{
+    if (!has_documents())
+        return false;
+    return m_saver.is_busy(m_current_document);
+}
+
+void Core::autosave()
+{
+    for (auto &[uu, doc] : m_documents) {
+        doc.autosave(m_saver);
+    }
+    m_signal_needs_save.emit();
+}
+
+void Core::handle_save_finished(const DocumentSaver::Result &result)
+{
+    if (result.kind == DocumentSaver::Kind::AUTOSAVE) {
+        if (!m_documents.contains(result.doc)) {
+            // closed while the autosave was in progress
+            std::error_code ec;
+            std::filesystem::remove(result.path, ec);
+        }
+        else if (result.error.size()) {
+            Logger::log_warning("error autosaving document", Logger::Domain::DOCUMENT, result.error);
+        }
+    }
+    else if (result.error.size()) {
+        Logger::log_critical("error saving document " + path_to_string(result.path), Logger::Domain::DOCUMENT,
+                             result.error);
+        if (m_documents.contains(result.doc))
+            m_documents.at(result.doc).m_needs_save = true;
+    }
     m_signal_needs_save.emit();
 }
 
@@ -2,6 +2,7 @@
 #include "document/document.hpp"
 #include "icore.hpp"
 #include "util/history_manager.hpp"
+#include "document_saver.hpp"
 #include <filesystem>
 #include <optional>
 #include <sigc++/sigc++.h>
@@ -74,6 +75,7 @@ public:
     ToolID get_tool_id() const;
 
     std::set<SelectableRef> get_tool_selection() const;
+    std::set<UUID> get_tool_overlay_entities() const;
 
     bool get_needs_save_any() const;
     bool get_needs_save() const;
@@ -83,6 +85,11 @@ public:
     void save_all();
     void save();
     void save_as(const std::filesystem::path &path);
+    bool is_saving() const;
+
+    // writes documents with unsaved changes to their autosave file
+    void autosave();
+    static std::filesystem::path get_autosave_path(const std::filesystem::path &path);
 
     void rebuild(const std::string &comment);
 
@@ -157,8 +164,10 @@ private:
         void history_load(const HistoryManager::HistoryItem &it);
         void history_push(const std::string &comment);
         void revert();
-        void save();
-        void save_as(const std::filesystem::path &path);
+        void save(DocumentSaver &saver);
+        void save_as(const std::filesystem::path &path, DocumentSaver &saver);
+        void autosave(DocumentSaver &saver);
+        std::shared_ptr<const Document> get_snapshot() const;
         bool has_path() const override;
         Document &get_document() override
         {
@@ -200,6 +209,7 @@ private:
         bool m_needs_save = false;
         UUID m_current_group;
         HistoryManager m_history_manager;
+        std::weak_ptr<const HistoryManager::HistoryItem> m_last_autosave;
     };
 
     DocumentInfo &get_current_document_info()
@@ -213,6 +223,8 @@ private:
 
 
     std::map<UUID, DocumentInfo> m_documents;
+    DocumentSaver m_saver;
+    void handle_save_finished(const DocumentSaver::Result &result);
 
     UUID m_current_document;
 
@@ -0,0 +1,106 @@
+#include "document_saver.hpp"
+#include "document/document.hpp"
+#include "document/document_binary.hpp"
+#include "nlohmann/json.hpp"
+#include "util/util.hpp"
+#include <algorithm>
+
+namespace dune3d {
+
+DocumentSaver::DocumentSaver()
+{
+    m_dispatcher.connect([this] {
+        std::list<Result> results;
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            results.splice(results.begin(), m_results);
+        }
+        for (const auto &it : results) {
+            m_signal_finished.emit(it);
+        }
+    });
+    m_thread = std::thread(&DocumentSaver::worker, this);
+}
+
+DocumentSaver::~DocumentSaver()
+{
+    // pending saves still need to make it to disk
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_one();
+    m_thread.join();
+}
+
+void DocumentSaver::enqueue(Job job)
+{
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        // a newer snapshot makes a queued autosave of the same document obsolete
+        const auto n_erased = std::erase_if(
+                m_jobs, [&job](const Job &other) { return other.doc == job.doc && other.kind == Kind::AUTOSAVE; });
+        m_busy[job.doc] -= n_erased;
+        m_busy[job.doc]++;
+        m_jobs.push_back(std::move(job));
+    }
+    m_cond.notify_one();
+}
+
+bool DocumentSaver::is_busy(const UUID &doc) const
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (auto it = m_busy.find(doc); it != m_busy.end())
+        return it->second;
+    return false;
+}
+
+void DocumentSaver::run_job(const Job &job)
+{
+    if (BinaryDocument::has_binary_suffix(job.path))
+        job.snapshot->save_binary(job.path);
+    else
+        save_json_to_file(job.path, job.snapshot->serialize());
+
+    if (job.kind == Kind::SAVE && !job.autosave_path.empty()) {
+        std::error_code ec;
+        std::filesystem::remove(job.autosave_path, ec);
+    }
+}
+
+void DocumentSaver::worker()
+{
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cond.wait(lock, [this] { return m_stop || m_jobs.size(); });
+            if (m_jobs.empty())
+                return;
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        Result result{.doc = job.doc, .kind = job.kind, .path = job.path};
+        try {
+            run_job(job);
+        }
+        catch (const std::exception &e) {
+            result.error = e.what();
+        }
+        catch (...) {
+            result.error = "unknown exception";
+        }
+
+        // drop the snapshot before the main thread learns that we're done with it
+        job.snapshot.reset();
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_busy.at(job.doc)--;
+            m_results.push_back(std::move(result));
+        }
+        m_dispatcher.emit();
+    }
+}
+
+} // namespace dune3d
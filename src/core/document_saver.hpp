@@ -0,0 +1,69 @@
+#pragma once
+#include "util/uuid.hpp"
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <glibmm/dispatcher.h>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sigc++/sigc++.h>
+#include <thread>
+
+namespace dune3d {
+
+class Document;
+
+// Serializes and writes documents on a worker thread. Jobs operate on
+// snapshots that aren't modified anymore, so editing can go on meanwhile.
+class DocumentSaver {
+public:
+    DocumentSaver();
+    ~DocumentSaver();
+
+    enum class Kind { SAVE, AUTOSAVE };
+
+    struct Job {
+        UUID doc;
+        Kind kind;
+        std::shared_ptr<const Document> snapshot;
+        std::filesystem::path path;
+        // deleted once a save has succeeded
+        std::filesystem::path autosave_path;
+    };
+    void enqueue(Job job);
+    bool is_busy(const UUID &doc) const;
+
+    struct Result {
+        UUID doc;
+        Kind kind;
+        std::filesystem::path path;
+        std::string error;
+    };
+
+    // emitted on the main thread
+    using type_signal_finished = sigc::signal<void(const Result &)>;
+    type_signal_finished signal_finished()
+    {
+        return m_signal_finished;
+    }
+
+private:
+    void worker();
+    static void run_job(const Job &job);
+
+    std::deque<Job> m_jobs;
+    std::map<UUID, unsigned int> m_busy;
+    bool m_stop = false;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cond;
+
+    std::list<Result> m_results;
+    Glib::Dispatcher m_dispatcher;
+    type_signal_finished m_signal_finished;
+
+    std::thread m_thread;
+};
+
+} // namespace dune3d
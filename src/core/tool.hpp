@@ -154,6 +154,16 @@ public:
         return false;
     }
 
+    /**
+     * @returns the entities that are the only ones to change when the cursor
+     * moves, these get drawn into the canvas' overlay so that only it needs to
+     * be redrawn. If empty, the whole document gets redrawn.
+     */
+    virtual std::set<UUID> get_overlay_entities() const
+    {
+        return {};
+    }
+
     std::set<SelectableRef> m_selection;
 
     virtual ~ToolBase()
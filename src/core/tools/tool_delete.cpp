@@ -30,7 +30,7 @@ ToolResponse ToolDelete::begin(const ToolArgs &args)
     auto &doc = get_doc();
 
     ItemsToDelete items_to_delete;
-    const Group *first_anchor_group = nullptr;
+    std::set<UUID> anchor_groups;
     std::set<EntityAndPoint> deleted_anchors;
 
     for (auto &sr : m_selection) {
@@ -42,7 +42,7 @@ ToolResponse ToolDelete::begin(const ToolArgs &args)
                 if (en_step->m_anchors.contains(sr.point)) {
                     en_step->remove_anchor(sr.point);
                     deleted_anchors.insert(sr.get_entity_and_point());
-                    doc.accumulate_first_group(first_anchor_group, en_step->m_group);
+                    anchor_groups.insert(en_step->m_group);
                 }
                 else {
                     items_to_delete.entities.insert(sr.item);
@@ -72,8 +72,8 @@ ToolResponse ToolDelete::begin(const ToolArgs &args)
 
     doc.delete_items(items_to_delete);
 
-    if (first_anchor_group) {
-        doc.set_group_solve_pending(first_anchor_group->m_uuid);
+    for (const auto &group : anchor_groups) {
+        doc.set_group_solve_pending(group);
     }
 
 
@@ -29,6 +29,13 @@ glm::dvec2 ToolDrawCircle2D::get_cursor_pos_in_plane() const
     return m_wrkpl->project(get_cursor_pos_for_workplane(*m_wrkpl));
 }
 
+std::set<UUID> ToolDrawCircle2D::get_overlay_entities() const
+{
+    if (m_temp_circle)
+        return {m_temp_circle->m_uuid};
+    return {};
+}
+
 ToolResponse ToolDrawCircle2D::update(const ToolArgs &args)
 {
     if (args.type == ToolEventType::MOVE) {
@@ -214,6 +214,21 @@ Constraint *ToolDrawContour::constrain_point_and_add_head_tangent_constraint(con
 }
 
 
+std::set<UUID> ToolDrawContour::get_overlay_entities() const
+{
+    std::set<UUID> r;
+    if (m_temp_line)
+        r.insert(m_temp_line->m_uuid);
+    else if (m_temp_arc)
+        r.insert(m_temp_arc->m_uuid);
+    else
+        return r;
+    // keeping the temporary line tangent moves the end of the arc before it
+    if (m_entities.size() > 1)
+        r.insert(m_entities.at(m_entities.size() - 2)->m_uuid);
+    return r;
+}
+
 ToolResponse ToolDrawContour::update(const ToolArgs &args)
 {
     if (args.type == ToolEventType::MOVE) {
@@ -71,6 +71,13 @@ ToolResponse ToolDrawLine3D::end_tool()
     return ToolResponse();
 }
 
+std::set<UUID> ToolDrawLine3D::get_overlay_entities() const
+{
+    if (m_temp_line)
+        return {m_temp_line->m_uuid};
+    return {};
+}
+
 ToolResponse ToolDrawLine3D::update(const ToolArgs &args)
 {
     if (args.type == ToolEventType::MOVE) {
@@ -11,6 +11,7 @@ public:
 
     ToolResponse begin(const ToolArgs &args) override;
     ToolResponse update(const ToolArgs &args) override;
+    std::set<UUID> get_overlay_entities() const override;
     std::set<InToolActionID> get_actions() const override
     {
         using I = InToolActionID;
@@ -33,6 +33,13 @@ glm::dvec2 ToolDrawPoint2D::get_cursor_pos_in_plane() const
     return m_wrkpl->project(get_cursor_pos_for_workplane(*m_wrkpl));
 }
 
+std::set<UUID> ToolDrawPoint2D::get_overlay_entities() const
+{
+    if (m_temp_point)
+        return {m_temp_point->m_uuid};
+    return {};
+}
+
 ToolResponse ToolDrawPoint2D::update(const ToolArgs &args)
 {
     if (args.type == ToolEventType::MOVE) {
@@ -31,6 +31,16 @@ glm::dvec2 ToolDrawRectangle::get_cursor_pos_in_plane() const
     return m_wrkpl->project(get_cursor_pos_for_workplane(*m_wrkpl));
 }
 
+std::set<UUID> ToolDrawRectangle::get_overlay_entities() const
+{
+    std::set<UUID> r;
+    if (m_lines.front()) {
+        for (auto line : m_lines)
+            r.insert(line->m_uuid);
+    }
+    return r;
+}
+
 ToolResponse ToolDrawRectangle::update(const ToolArgs &args)
 {
     if (args.type == ToolEventType::MOVE) {
@@ -68,6 +68,17 @@ void ToolDrawRegularPolygon::update_sides(const glm::dvec2 &p)
     }
 }
 
+std::set<UUID> ToolDrawRegularPolygon::get_overlay_entities() const
+{
+    std::set<UUID> r;
+    if (m_temp_circle) {
+        r.insert(m_temp_circle->m_uuid);
+        for (auto side : m_sides)
+            r.insert(side->m_uuid);
+    }
+    return r;
+}
+
 ToolResponse ToolDrawRegularPolygon::update(const ToolArgs &args)
 {
     if (args.type == ToolEventType::MOVE) {
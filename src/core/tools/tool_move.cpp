@@ -46,18 +46,15 @@ ToolResponse ToolMove::begin(const ToolArgs &args)
             m_inital_pos_wrkpl.emplace(uu, wrkpl.project(get_cursor_pos_for_workplane(wrkpl)));
         }
     }
-    const Group *first_group = nullptr;
     for (const auto &sr : m_selection) {
         if (sr.type == SelectableRef::Type::ENTITY) {
             auto &entity = get_entity(sr.item);
             if (entity.m_move_instead.contains(sr.point)) {
                 auto &enp = entity.m_move_instead.at(sr.point);
                 auto &other_entity = get_entity(enp.entity);
-                get_doc().accumulate_first_group(first_group, other_entity.m_group);
                 m_entities.emplace(&other_entity, enp.point);
             }
             else {
-                get_doc().accumulate_first_group(first_group, entity.m_group);
                 m_entities.emplace(&entity, sr.point);
             }
         }
@@ -72,12 +69,11 @@ ToolResponse ToolMove::begin(const ToolArgs &args)
         }
         // we don't care about constraints since dragging them is pureley cosmetic
     }
-    if (first_group)
-        m_first_group = first_group->m_uuid;
 
 
     for (auto [entity, point] : m_entities) {
         m_dragged_list.emplace_back(entity->m_uuid, point);
+        m_groups.insert(entity->m_group);
     }
 
     return ToolResponse();
@@ -187,7 +183,9 @@ ToolResponse ToolMove::update(const ToolArgs &args)
             }
         }
 
-        doc.set_group_solve_pending(m_first_group);
+        for (const auto &group : m_groups) {
+            doc.set_group_solve_pending(group);
+        }
         m_core.solve_current(m_dragged_list);
 
         for (auto sr : m_selection) {
@@ -52,10 +52,8 @@ ToolResponse ToolToggleConstruction::begin(const ToolArgs &args)
     if (entities.size() == 0)
         return ToolResponse::end();
 
-    const Group *first_group = nullptr;
-
     for (auto en : entities) {
-        get_doc().accumulate_first_group(first_group, en->m_group);
+        get_doc().set_group_generate_pending(en->m_group);
         switch (m_tool_id) {
         case ToolID::TOGGLE_CONSTRUCTION:
             en->m_construction = !en->m_construction;
@@ -70,9 +68,6 @@ ToolResponse ToolToggleConstruction::begin(const ToolArgs &args)
         default:;
         }
     }
-    if (first_group)
-        get_doc().set_group_generate_pending(first_group->m_uuid);
-
     return ToolResponse::commit();
 }
 
@@ -1,13 +1,18 @@
 #include "document.hpp"
+#include "document_binary.hpp"
 #include "nlohmann/json.hpp"
 #include "entity/entity.hpp"
 #include "constraint/constraint.hpp"
 #include "group/group.hpp"
 #include "util/util.hpp"
 #include "util/fs_util.hpp"
+#include "util/stopwatch.hpp"
+#include "group/group_array.hpp"
 #include "group/group_extrude.hpp"
 #include "group/group_reference.hpp"
 #include "group/group_sketch.hpp"
+#include "group/igroup_solid_model.hpp"
+#include "group/igroup_source_group.hpp"
 #include "system/system.hpp"
 #include "logger/logger.hpp"
 #include "logger/log_util.hpp"
@@ -50,6 +55,54 @@ json Document::serialize() const
     return j;
 }
 
+void Document::save_binary(const std::filesystem::path &path) const
+{
+    using Section = BinaryDocument::Section;
+    BinaryDocumentWriter writer{path};
+    {
+        auto j = json{{"type", "document"}};
+        m_version.serialize(j);
+        writer.write_meta(j);
+    }
+
+    writer.begin_section(Section::GROUPS);
+    for (const auto &[uu, it] : m_groups) {
+        writer.add_record(uu, it->serialize(*this));
+    }
+    writer.end_section();
+
+    // the group index needs each group's items to be next to each other
+    {
+        std::map<UUID, std::vector<const Entity *>> by_group;
+        for (const auto &[uu, it] : m_entities) {
+            if (it->m_kind == ItemKind::USER)
+                by_group[it->m_group].push_back(it.get());
+        }
+        writer.begin_section(Section::ENTITIES);
+        for (const auto &[group, entities] : by_group) {
+            for (auto en : entities) {
+                writer.add_record(en->m_uuid, en->serialize());
+            }
+        }
+        writer.end_section();
+    }
+    {
+        std::map<UUID, std::vector<const Constraint *>> by_group;
+        for (const auto &[uu, it] : m_constraints) {
+            by_group[it->m_group].push_back(it.get());
+        }
+        writer.begin_section(Section::CONSTRAINTS);
+        for (const auto &[group, constraints] : by_group) {
+            for (auto constraint : constraints) {
+                writer.add_record(constraint->m_uuid, constraint->serialize());
+            }
+        }
+        writer.end_section();
+    }
+
+    writer.finish();
+}
+
 static const unsigned int app_version = 12;
 
 unsigned int Document::get_app_version()
@@ -67,8 +120,10 @@ Document::Document() : m_version(app_version)
     sketch.set_index({}, 1);
     sketch.m_name = "Sketch 1";
     sketch.m_active_wrkpl = grp.get_workplane_xy_uuid();
+    update_groups_sorted();
 
     set_group_generate_pending(grp.m_uuid);
+    set_group_generate_pending(sketch.m_uuid);
     update_pending();
 }
 
@@ -87,8 +142,50 @@ Document::Document(const json &j, const std::filesystem::path &containing_dir) :
                          std::forward_as_tuple(Group::new_from_json(uu, it)));
     }
 
-    if (m_groups.size())
-        set_group_generate_pending(get_groups_sorted().front()->m_uuid);
+    finish_loading();
+}
+
+Document::Document(BinaryDocumentReader &reader, const std::filesystem::path &containing_dir)
+    : m_version(app_version, reader.get_meta())
+{
+    using Section = BinaryDocument::Section;
+    reader.read_section(Section::GROUPS,
+                        [this](const UUID &uu, const json &j) { m_groups.emplace(uu, Group::new_from_json(uu, j)); });
+    if (reader.has_group_index()) {
+        for (const auto &group : reader.get_indexed_groups())
+            load_group_items(reader, group, containing_dir);
+    }
+    else {
+        reader.read_section(Section::ENTITIES, [this, &containing_dir](const UUID &uu, const json &j) {
+            m_entities.emplace(uu, Entity::new_from_json(uu, j, containing_dir));
+        });
+        reader.read_section(Section::CONSTRAINTS, [this](const UUID &uu, const json &j) {
+            m_constraints.emplace(uu, Constraint::new_from_json(uu, j));
+        });
+    }
+
+    finish_loading();
+}
+
+void Document::load_group_items(BinaryDocumentReader &reader, const UUID &group,
+                                const std::filesystem::path &containing_dir)
+{
+    using Section = BinaryDocument::Section;
+    reader.read_group_items(group, Section::ENTITIES, [this, &containing_dir](const UUID &uu, const json &j) {
+        m_entities.emplace(uu, Entity::new_from_json(uu, j, containing_dir));
+    });
+    reader.read_group_items(group, Section::CONSTRAINTS, [this](const UUID &uu, const json &j) {
+        m_constraints.emplace(uu, Constraint::new_from_json(uu, j));
+    });
+}
+
+void Document::finish_loading()
+{
+    update_groups_sorted();
+
+    for (const auto &[uu, group] : m_groups) {
+        set_group_generate_pending(uu);
+    }
     update_pending();
 
     erase_invalid();
@@ -110,36 +207,75 @@ Document::Document(const Document &other) : m_version(other.m_version)
     for (const auto &[uu, it] : other.m_groups) {
         m_groups.emplace(uu, it->clone());
     }
+    update_groups_sorted();
 }
 
 Document Document::new_from_file(const std::filesystem::path &path)
 {
     try {
+        if (BinaryDocument::is_binary_document(path)) {
+            BinaryDocumentReader reader{path};
+            return Document{reader, path.parent_path()};
+        }
         return Document{load_json_from_file(path), path.parent_path()};
     }
     CATCH_LOG(Logger::Level::WARNING, "error opening document" + path_to_string(path), Logger::Domain::DOCUMENT)
     return {};
 }
 
-std::vector<Group *> Document::get_groups_sorted()
+const std::vector<Group *> &Document::get_groups_sorted()
 {
-    auto groups = static_cast<const Document *>(this)->get_groups_sorted();
-    std::vector<Group *> r;
-    r.reserve(groups.size());
-    for (auto g : groups) {
-        r.push_back(const_cast<Group *>(g));
-    }
-    return r;
+    return m_groups_sorted;
+}
+
+const std::vector<const Group *> &Document::get_groups_sorted() const
+{
+    return m_groups_sorted_const;
 }
-std::vector<const Group *> Document::get_groups_sorted() const
+
+void Document::update_groups_sorted()
 {
-    std::vector<const Group *> r;
-    r.reserve(m_groups.size());
+    m_group_dependencies.reset();
+    m_groups_sorted.clear();
+    m_groups_sorted.reserve(m_groups.size());
     for (auto &[uu, it] : m_groups) {
-        r.push_back(it.get());
+        m_groups_sorted.push_back(it.get());
+    }
+    std::ranges::sort(m_groups_sorted, {}, [](auto a) { return a->get_index(); });
+
+    m_groups_sorted_const.assign(m_groups_sorted.begin(), m_groups_sorted.end());
+
+    m_group_positions.clear();
+    const Group *body_group = nullptr;
+    const Group *solid_model_group = nullptr;
+    for (size_t i = 0; i < m_groups_sorted.size(); i++) {
+        auto group = m_groups_sorted.at(i);
+        if (group->m_body) {
+            body_group = group;
+            solid_model_group = nullptr;
+        }
+        m_group_positions.emplace(group->m_uuid, GroupPosition{i, body_group, solid_model_group});
+        if (dynamic_cast<const IGroupSolidModel *>(group))
+            solid_model_group = group;
     }
-    std::ranges::sort(r, {}, [](auto a) { return a->get_index(); });
-    return r;
+}
+
+size_t Document::get_group_position(const UUID &group) const
+{
+    return m_group_positions.at(group).position;
+}
+
+const Group &Document::get_body_group(const UUID &group) const
+{
+    auto body_group = m_group_positions.at(group).body_group;
+    if (!body_group)
+        throw std::runtime_error("body not found");
+    return *body_group;
+}
+
+const Group *Document::get_previous_solid_model_group(const UUID &group) const
+{
+    return m_group_positions.at(group).previous_solid_model_group;
 }
 
 std::vector<Document::BodyGroups> Document::get_groups_by_body() const
@@ -156,75 +292,200 @@ std::vector<Document::BodyGroups> Document::get_groups_by_body() const
     return r;
 }
 
-void Document::update_pending(const UUID &last_group_to_update_i, const std::vector<EntityAndPoint> &dragged)
+std::shared_ptr<const Document::GroupDependencies> Document::get_group_dependencies() const
+{
+    if (m_group_dependencies)
+        return m_group_dependencies;
+
+    // equivalent to Group::get_referenced_groups, but iterates over all
+    // entities and constraints only once rather than once per group
+    std::map<UUID, std::set<UUID>> referenced_entities;
+    for (const auto &[uu, en] : m_entities) {
+        auto refs = en->get_referenced_entities();
+        referenced_entities[en->m_group].insert(refs.begin(), refs.end());
+    }
+    for (const auto &[uu, co] : m_constraints) {
+        auto refs = co->get_referenced_entities();
+        referenced_entities[co->m_group].insert(refs.begin(), refs.end());
+    }
+
+    auto r = std::make_shared<GroupDependencies>();
+    for (const auto &[uu, group] : m_groups) {
+        auto &ents = referenced_entities[uu];
+        if (group->m_active_wrkpl)
+            ents.insert(group->m_active_wrkpl);
+        auto required_entities = group->get_required_entities(*this);
+        ents.insert(required_entities.begin(), required_entities.end());
+
+        auto &deps = (*r)[uu];
+        for (const auto &en_uu : ents) {
+            if (auto it = m_entities.find(en_uu); it != m_entities.end())
+                deps.insert(it->second->m_group);
+        }
+        auto required_groups = group->get_required_groups(*this);
+        deps.insert(required_groups.begin(), required_groups.end());
+        if (auto gr_src = dynamic_cast<const IGroupSourceGroup *>(group.get()))
+            deps.insert(gr_src->get_source_group());
+        deps.erase(uu);
+        deps.erase(UUID());
+    }
+    m_group_dependencies = r;
+    return r;
+}
+
+void Document::update_pending(const UUID &last_group_to_update, const std::vector<EntityAndPoint> &dragged)
 {
+    const Stopwatch stopwatch;
     try {
-        auto groups_sorted = get_groups_sorted();
-        if (groups_sorted.empty())
+        auto pending = std::move(m_pending_groups);
+        m_pending_groups.clear();
+        map_erase_if(pending, [this](auto &x) { return !m_groups.contains(x.first); });
+        if (pending.empty()) {
+            erase_invalid();
             return;
-        const UUID last_group_to_update =
-                last_group_to_update_i == groups_sorted.back()->m_uuid ? UUID() : last_group_to_update_i;
-        auto get_first_index = [this](const UUID &uu) {
-            if (m_groups.contains(uu))
-                return get_group(uu).get_index();
-            else
-                return INT_MAX;
+        }
+
+        const auto &groups_sorted = get_groups_sorted();
+        // generating groups resets the cache, this keeps our copy alive
+        const auto dependencies_ptr = get_group_dependencies();
+        const auto &dependencies = *dependencies_ptr;
+
+        // groups after last_group_to_update are only marked pending, so
+        // that they get updated once they're needed
+        auto n_update = groups_sorted.size();
+        for (size_t i = 0; i < groups_sorted.size(); i++) {
+            if (groups_sorted.at(i)->m_uuid == last_group_to_update) {
+                n_update = i + 1;
+                break;
+            }
+        }
+
+        std::map<UUID, PendingGroup> todo;
+        auto find_dependency = [&todo, &dependencies, this](const Group &group, auto pred) -> const Group * {
+            for (const auto &dep : dependencies.at(group.m_uuid)) {
+                if (auto it = todo.find(dep); it != todo.end() && pred(it->second))
+                    return &get_group(dep);
+            }
+            return nullptr;
         };
 
-        const auto first_generate_index = get_first_index(m_first_group_generate);
-        const auto first_solve_index = get_first_index(m_first_group_solve);
-        const auto first_update_solid_model_index = get_first_index(m_first_group_update_solid_model);
-        const Group *last_group = nullptr;
         // first pass: generate
-        if (m_first_group_generate) {
-            for (auto group : groups_sorted) {
-                if (last_group && last_group->m_uuid == last_group_to_update) {
-                    // we've seen all groups we needed to see, update to the rest
-                    if (m_first_group_generate)
-                        m_first_group_generate = group->m_uuid;
-                    break;
-                }
-                const auto index = group->get_index();
-                if (index >= first_generate_index) {
-                    generate_group(*group);
+        for (size_t i = 0; i < groups_sorted.size(); i++) {
+            auto &group = *groups_sorted.at(i);
+            PendingGroup it;
+            if (auto it_pending = pending.find(group.m_uuid); it_pending != pending.end()) {
+                it = it_pending->second;
+                if (it.reason.empty())
+                    it.reason = "marked pending";
+            }
+            if (!it.generate) {
+                if (auto dep = find_dependency(group, [](auto &x) { return x.generate; })) {
+                    it.generate = true;
+                    it.reason = "depends on regenerated group " + dep->m_name;
                 }
-                last_group = group;
             }
+            if (!(it.generate || it.solve || it.update_solid_model))
+                continue;
+            if (it.generate && i < n_update)
+                generate_group(group);
+            todo.emplace(group.m_uuid, it);
         }
-        if (!last_group_to_update)
-            m_first_group_generate = UUID();
 
         erase_invalid();
 
-        last_group = nullptr;
-        for (auto group : groups_sorted) {
-            if (last_group && last_group->m_uuid == last_group_to_update) {
-                // we've seen all groups we needed to see, update to the rest
-                if (m_first_group_solve)
-                    m_first_group_solve = group->m_uuid;
-                if (m_first_group_update_solid_model)
-                    m_first_group_update_solid_model = group->m_uuid;
-                return;
+        // second pass: solve and update solid model
+        // solid models accumulate across a body, so once one got updated,
+        // all later ones in the same body need to be updated as well
+        const Group *last_solid_model_group = nullptr;
+        for (size_t i = 0; i < groups_sorted.size(); i++) {
+            auto &group = *groups_sorted.at(i);
+            if (group.m_body)
+                last_solid_model_group = nullptr;
+            const bool is_solid_model_group = dynamic_cast<const IGroupSolidModel *>(&group);
+
+            auto it_todo = todo.find(group.m_uuid);
+            PendingGroup it;
+            if (it_todo != todo.end())
+                it = it_todo->second;
+            if (it.generate)
+                it.solve = true;
+            if (!it.solve) {
+                if (auto dep = find_dependency(group, [](auto &x) { return x.solve; })) {
+                    it.solve = true;
+                    it.reason = "depends on re-solved group " + dep->m_name;
+                }
+            }
+            if (it.solve)
+                it.update_solid_model = true;
+            if (!it.update_solid_model && is_solid_model_group && last_solid_model_group) {
+                it.update_solid_model = true;
+                it.reason = "follows updated group " + last_solid_model_group->m_name + " in body";
             }
-            const auto index = group->get_index();
-            if (index >= first_solve_index) {
-                solve_group(*group, dragged);
+            if (it.update_solid_model && (is_solid_model_group || pending.contains(group.m_uuid)))
+                last_solid_model_group = &group;
+
+            if (!(it.generate || it.solve || it.update_solid_model))
+                continue;
+
+            if (i < n_update) {
+                if (it.solve)
+                    solve_group(group, dragged);
+                if (it.update_solid_model)
+                    update_solid_model(group);
             }
-            if (index >= first_update_solid_model_index) {
-                update_solid_model(*group);
+            else {
+                m_pending_groups.insert_or_assign(group.m_uuid, it);
             }
+            todo.insert_or_assign(group.m_uuid, it);
+        }
 
-            last_group = group;
+        // dragging updates way too often to be worth logging
+        if (dragged.empty()) {
+            std::string detail;
+            size_t n_updated = 0;
+            for (size_t i = 0; i < n_update; i++) {
+                auto &group = *groups_sorted.at(i);
+                if (!todo.contains(group.m_uuid))
+                    continue;
+                auto &it = todo.at(group.m_uuid);
+                std::string what;
+                auto append = [&what](const char *w) {
+                    if (what.size())
+                        what += ", ";
+                    what += w;
+                };
+                if (it.generate)
+                    append("generate");
+                if (it.solve)
+                    append("solve");
+                if (it.update_solid_model)
+                    append("solid model");
+                if (detail.size())
+                    detail += "\n";
+                detail += group.m_name + ": " + what;
+                detail += " (" + it.reason + ")";
+                n_updated++;
+            }
+            Logger::log_debug("updated " + std::to_string(n_updated) + " of " + std::to_string(groups_sorted.size())
+                                      + " groups",
+                              Logger::Domain::DOCUMENT, detail);
         }
-        // we've seen all groups, reset all pendings
-        m_first_group_solve = UUID();
-        m_first_group_update_solid_model = UUID();
     }
     CATCH_LOG(Logger::Level::CRITICAL, "error updating document", Logger::Domain::DOCUMENT)
+    m_last_update_duration = stopwatch.get_ms();
 }
 
 void Document::generate_group(Group &group)
 {
+    m_group_dependencies.reset();
+    // arrays only materialize the instances that are referenced, arrays of
+    // an array need all of them
+    if (auto gr_array = dynamic_cast<const GroupArray *>(&group)) {
+        if (auto it = m_groups.find(gr_array->m_source_group); it != m_groups.end()) {
+            if (auto group_array = dynamic_cast<const GroupArray *>(it->second.get()))
+                group_array->materialize_all_instances(*this);
+        }
+    }
     if (auto gg = dynamic_cast<IGroupGenerate *>(&group)) {
         for (auto &[uu, it] : m_entities) {
             if (it->m_group == group.m_uuid && it->m_kind == ItemKind::GENRERATED) {
@@ -308,13 +569,13 @@ void Document::insert_group(std::unique_ptr<Group> new_group, const UUID &after)
             group->set_index({}, group->get_index() + 1);
     }
     m_groups.emplace(new_group->m_uuid, std::move(new_group));
+    update_groups_sorted();
 }
 
 UUID Document::get_group_rel(const UUID &group, int delta) const
 {
-    auto groups = get_groups_sorted();
-    auto &current_group = get_group(group);
-    int pos = std::ranges::find(groups, &current_group) - groups.begin();
+    auto &groups = get_groups_sorted();
+    int pos = get_group_position(group);
     pos += delta;
     if (pos < 0 || pos >= (int)groups.size())
         return UUID();
@@ -333,6 +594,7 @@ bool Document::reorder_group(const UUID &group_uu, const UUID &after)
     const auto group_before = get_group_rel(group_uu, -1);
     if (!group_before)
         return false;
+    const auto group_after = get_group_rel(group_uu, 1);
 
     for (auto gr : groups_sorted) {
         if (gr->m_uuid == group_uu)
@@ -357,9 +619,11 @@ bool Document::reorder_group(const UUID &group_uu, const UUID &after)
             gr->set_index({}, index++);
         }
     }
+    update_groups_sorted();
 
     set_group_generate_pending(group_uu);
     set_group_generate_pending(group_before);
+    set_group_generate_pending(group_after);
     set_group_generate_pending(after);
 
     return true;
@@ -396,34 +660,6 @@ size_t ItemsToDelete::size() const
     return entities.size() + groups.size() + constraints.size();
 }
 
-void Document::accumulate_first_group(const Group *&first_group, const UUID &group_uu) const
-{
-    auto &group = get_group(group_uu);
-    if (!first_group || group.get_index() < first_group->get_index())
-        first_group = &group;
-}
-
-UUID ItemsToDelete::get_first_group(const Document &doc) const
-{
-    const Group *first_group = nullptr;
-    for (const auto &uu : groups) {
-        doc.accumulate_first_group(first_group, uu);
-    }
-    for (const auto &uu : entities) {
-        auto &en = doc.get_entity(uu);
-        doc.accumulate_first_group(first_group, en.m_group);
-    }
-    for (const auto &uu : constraints) {
-        auto &co = doc.get_constraint(uu);
-        doc.accumulate_first_group(first_group, co.m_group);
-    }
-
-    if (first_group)
-        return first_group->m_uuid;
-    else
-        return UUID();
-}
-
 ItemsToDelete Document::get_additional_items_to_delete(const ItemsToDelete &items_initial) const
 {
     ItemsToDelete items = items_initial;
@@ -496,13 +732,34 @@ ItemsToDelete Document::get_additional_items_to_delete(const ItemsToDelete &item
 
 void Document::delete_items(const ItemsToDelete &items)
 {
-    set_group_generate_pending(items.get_first_group(*this));
+    m_group_dependencies.reset();
+    for (auto &it : items.entities) {
+        set_group_generate_pending(get_entity(it).m_group);
+    }
+    for (auto &it : items.constraints) {
+        set_group_generate_pending(get_constraint(it).m_group);
+    }
+    {
+        // groups following a deleted one might end up in a different body
+        // or on top of a different solid model
+        bool after_deleted = false;
+        for (auto gr : get_groups_sorted()) {
+            if (items.groups.contains(gr->m_uuid)) {
+                after_deleted = true;
+            }
+            else if (after_deleted) {
+                set_group_generate_pending(gr->m_uuid);
+                after_deleted = false;
+            }
+        }
+    }
     for (auto &it : items.entities) {
         m_entities.erase(it);
     }
     for (auto &it : items.groups) {
         m_groups.erase(it);
     }
+    update_groups_sorted();
     for (auto &it : items.constraints) {
         m_constraints.erase(it);
     }
@@ -515,6 +772,18 @@ void Document::delete_items(const ItemsToDelete &items)
     }
 }
 
+bool Document::materialize_entities(const std::set<UUID> &uus)
+{
+    bool materialized = false;
+    for (auto &[uu, group] : m_groups) {
+        if (auto group_array = dynamic_cast<GroupArray *>(group.get()))
+            materialized = group_array->materialize_instances(*this, uus) || materialized;
+    }
+    if (materialized)
+        m_group_dependencies.reset();
+    return materialized;
+}
+
 glm::dvec3 Document::get_point(const EntityAndPoint &ep) const
 {
     return get_entity(ep.entity).get_point(ep.point, *this);
@@ -525,33 +794,28 @@ bool Document::is_valid_point(const EntityAndPoint &ep) const
     return get_entity(ep.entity).is_valid_point(ep.point);
 }
 
-void Document::update_group_if_less(UUID &uu, const UUID &new_group)
-{
-    if (uu == UUID()) {
-        uu = new_group;
-        return;
-    }
-    auto current_index = get_group(uu).get_index();
-    auto new_index = get_group(new_group).get_index();
-    if (new_index < current_index)
-        uu = new_group;
-}
-
 void Document::set_group_generate_pending(const UUID &group)
 {
-    update_group_if_less(m_first_group_generate, group);
+    if (!group)
+        return;
+    m_group_dependencies.reset();
+    m_pending_groups[group].generate = true;
     set_group_solve_pending(group);
 }
 
 void Document::set_group_solve_pending(const UUID &group)
 {
-    update_group_if_less(m_first_group_solve, group);
+    if (!group)
+        return;
+    m_pending_groups[group].solve = true;
     set_group_update_solid_model_pending(group);
 }
 
 void Document::set_group_update_solid_model_pending(const UUID &group)
 {
-    update_group_if_less(m_first_group_update_solid_model, group);
+    if (!group)
+        return;
+    m_pending_groups[group].update_solid_model = true;
 }
 
 UUID Document::get_group_after(const UUID &group_uu, MoveGroup dir) const
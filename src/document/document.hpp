@@ -8,6 +8,7 @@
 #include <glm/glm.hpp>
 #include "util/file_version.hpp"
 #include "entity/entity_and_point.hpp"
+#include "entity/entity_cast.hpp"
 
 namespace dune3d {
 using json = nlohmann::json;
@@ -15,13 +16,13 @@ class Entity;
 class Constraint;
 class Group;
 class Body;
+class BinaryDocumentReader;
 enum class GroupType;
 
 struct ItemsToDelete {
     std::set<UUID> entities;
     std::set<UUID> groups;
     std::set<UUID> constraints;
-    UUID get_first_group(const class Document &doc) const;
 
     void append(const ItemsToDelete &other);
     void subtract(const ItemsToDelete &other);
@@ -33,6 +34,11 @@ class Document {
 public:
     Document();
     explicit Document(const json &j, const std::filesystem::path &containing_dir);
+    explicit Document(BinaryDocumentReader &reader, const std::filesystem::path &containing_dir);
+    // reads only the entities and constraints of the given group from a
+    // binary document, the document's groups must already be there
+    void load_group_items(BinaryDocumentReader &reader, const UUID &group,
+                          const std::filesystem::path &containing_dir);
     static Document new_from_file(const std::filesystem::path &path);
     Document(const Document &other);
 
@@ -47,20 +53,21 @@ public:
         auto en = std::make_unique<T>(uu);
         auto p = en.get();
         m_entities.emplace(uu, std::move(en));
+        m_group_dependencies.reset();
         return *p;
     }
 
     template <typename T = Entity> T &get_entity(const UUID &uu)
     {
-        return dynamic_cast<T &>(*m_entities.at(uu));
+        return entity_cast<T>(*m_entities.at(uu));
     }
 
     template <typename T> T &get_or_add_entity(const UUID &uu, bool *was_added = nullptr)
     {
-        if (m_entities.count(uu)) {
+        if (auto it = m_entities.find(uu); it != m_entities.end()) {
             if (was_added)
                 *was_added = false;
-            return dynamic_cast<T &>(*m_entities.at(uu));
+            return entity_cast<T>(*it->second);
         }
         else {
             if (was_added)
@@ -71,7 +78,7 @@ public:
 
     template <typename T = Entity> const T &get_entity(const UUID &uu) const
     {
-        return dynamic_cast<const T &>(*m_entities.at(uu));
+        return entity_cast<T>(std::as_const(*m_entities.at(uu)));
     }
 
     template <typename T = Constraint> const T &get_constraint(const UUID &uu) const
@@ -94,6 +101,7 @@ public:
         auto en = std::make_unique<T>(uu);
         auto p = en.get();
         m_constraints.emplace(uu, std::move(en));
+        m_group_dependencies.reset();
         return *p;
     }
 
@@ -117,6 +125,7 @@ public:
         auto en = std::make_unique<T>(uu);
         auto p = en.get();
         m_groups.emplace(uu, std::move(en));
+        update_groups_sorted();
         return *p;
     }
 
@@ -128,13 +137,28 @@ public:
         return *p;
     }
 
+    // array instances nothing refers to aren't entities, creates the ones among uus
+    // and keeps them until the next call, returns true if any had to be created
+    bool materialize_entities(const std::set<UUID> &uus);
+
     glm::dvec3 get_point(const EntityAndPoint &ep) const;
     bool is_valid_point(const EntityAndPoint &ep) const;
 
-    std::vector<Group *> get_groups_sorted();
-    std::vector<const Group *> get_groups_sorted() const;
+    const std::vector<Group *> &get_groups_sorted();
+    const std::vector<const Group *> &get_groups_sorted() const;
+
+    // position of the group in get_groups_sorted()
+    size_t get_group_position(const UUID &group) const;
+
+    // the group that starts the body the group belongs to
+    const Group &get_body_group(const UUID &group) const;
 
-    void accumulate_first_group(const Group *&first_group, const UUID &group_uu) const;
+    // the closest solid model group before the group in the same body, if any
+    const Group *get_previous_solid_model_group(const UUID &group) const;
+
+    // needs to be called after changing a group's body, the document
+    // takes care of this for everything else affecting the group order
+    void update_groups_sorted();
 
     class BodyGroups {
     public:
@@ -153,6 +177,11 @@ public:
 
     void erase_invalid();
     void update_pending(const UUID &last_group = UUID(), const std::vector<EntityAndPoint> &dragged = {});
+    // in ms, of the last update_pending that had anything to do
+    float get_last_update_duration() const
+    {
+        return m_last_update_duration;
+    }
 
     void set_group_generate_pending(const UUID &group);
     void set_group_solve_pending(const UUID &group);
@@ -171,22 +200,46 @@ public:
     std::string find_next_group_name(GroupType type) const;
 
     json serialize() const;
+    // streams the document to a binary file without building a JSON tree of it
+    void save_binary(const std::filesystem::path &path) const;
 
     ~Document();
 
 private:
+    void finish_loading();
+
     std::map<UUID, std::unique_ptr<Group>> m_groups;
 
-    UUID m_first_group_generate;
-    UUID m_first_group_solve;
-    UUID m_first_group_update_solid_model;
+    std::vector<Group *> m_groups_sorted;
+    std::vector<const Group *> m_groups_sorted_const;
+    struct GroupPosition {
+        size_t position;
+        const Group *body_group;
+        const Group *previous_solid_model_group;
+    };
+    std::map<UUID, GroupPosition> m_group_positions;
+
+    struct PendingGroup {
+        bool generate = false;
+        bool solve = false;
+        bool update_solid_model = false;
+        std::string reason;
+    };
+    std::map<UUID, PendingGroup> m_pending_groups;
+    float m_last_update_duration = 0;
+
+    // groups each group depends on, i.e. the groups of referenced entities,
+    // required groups and the source group
+    using GroupDependencies = std::map<UUID, std::set<UUID>>;
+    std::shared_ptr<const GroupDependencies> get_group_dependencies() const;
+    // only solving doesn't change what entities and constraints refer to, so
+    // the cache survives dragging but gets reset by everything else
+    mutable std::shared_ptr<const GroupDependencies> m_group_dependencies;
 
     void generate_group(Group &group);
     void solve_group(Group &group, const std::vector<EntityAndPoint> &dragged);
     void update_solid_model(Group &group);
 
-    void update_group_if_less(UUID &uu, const UUID &new_group);
-
     void insert_group(std::unique_ptr<Group> group, const UUID &after);
 };
 } // namespace dune3d
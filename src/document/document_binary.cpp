@@ -0,0 +1,429 @@
+#include "document_binary.hpp"
+#include <cstring>
+
+namespace dune3d {
+
+static constexpr uint64_t cbor_tag_uuid = 37;
+static constexpr uint16_t no_type = 0xffff;
+static constexpr size_t section_table_offset = sizeof(BinaryDocument::magic) + 4 + 4;
+static constexpr size_t section_table_entry_size = 4 + 8 + 8;
+
+static const std::vector<BinaryDocument::Section> all_sections = {
+        BinaryDocument::Section::META,        BinaryDocument::Section::TYPES,
+        BinaryDocument::Section::GROUPS,      BinaryDocument::Section::ENTITIES,
+        BinaryDocument::Section::CONSTRAINTS, BinaryDocument::Section::GROUP_INDEX,
+};
+
+template <typename T> static void write_le(std::ostream &os, T v)
+{
+    unsigned char buf[sizeof(T)];
+    for (size_t i = 0; i < sizeof(T); i++) {
+        buf[i] = (v >> (i * 8)) & 0xff;
+    }
+    os.write(reinterpret_cast<const char *>(buf), sizeof(buf));
+}
+
+template <typename T> static T read_le(std::istream &is)
+{
+    unsigned char buf[sizeof(T)];
+    if (!is.read(reinterpret_cast<char *>(buf), sizeof(buf)))
+        throw std::runtime_error("unexpected end of binary document");
+    T v = 0;
+    for (size_t i = 0; i < sizeof(T); i++) {
+        v |= static_cast<T>(buf[i]) << (i * 8);
+    }
+    return v;
+}
+
+static void write_uuid(std::ostream &os, const UUID &uu)
+{
+    os.write(reinterpret_cast<const char *>(uu.get_bytes()), UUID::size);
+}
+
+static UUID read_uuid(std::istream &is)
+{
+    unsigned char buf[UUID::size];
+    if (!is.read(reinterpret_cast<char *>(buf), sizeof(buf)))
+        throw std::runtime_error("unexpected end of binary document");
+    return UUID{buf};
+}
+
+static void write_bytes(std::ostream &os, const std::vector<uint8_t> &bytes)
+{
+    write_le<uint32_t>(os, bytes.size());
+    os.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+}
+
+static std::vector<uint8_t> read_bytes(std::istream &is)
+{
+    const auto size = read_le<uint32_t>(is);
+    std::vector<uint8_t> bytes(size);
+    if (!is.read(reinterpret_cast<char *>(bytes.data()), size))
+        throw std::runtime_error("unexpected end of binary document");
+    return bytes;
+}
+
+// only canonical (lowercase) UUIDs are converted so that they come back unchanged
+static bool is_uuid_string(const std::string &s)
+{
+    if (s.size() != 36)
+        return false;
+    for (size_t i = 0; i < s.size(); i++) {
+        const auto c = s.at(i);
+        if (i == 8 || i == 13 || i == 18 || i == 23) {
+            if (c != '-')
+                return false;
+        }
+        else if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void encode_uuids(json &j)
+{
+    if (j.is_string()) {
+        const auto &s = j.get_ref<const std::string &>();
+        if (is_uuid_string(s)) {
+            const UUID uu{s};
+            j = json::binary(std::vector<uint8_t>(uu.get_bytes(), uu.get_bytes() + UUID::size), cbor_tag_uuid);
+        }
+    }
+    else if (j.is_structured()) {
+        for (auto &it : j) {
+            encode_uuids(it);
+        }
+    }
+}
+
+static void decode_uuids(json &j)
+{
+    if (j.is_binary()) {
+        const auto &bin = j.get_binary();
+        if (bin.has_subtype() && bin.subtype() == cbor_tag_uuid && bin.size() == UUID::size)
+            j = static_cast<std::string>(UUID{bin.data()});
+    }
+    else if (j.is_structured()) {
+        for (auto &it : j) {
+            decode_uuids(it);
+        }
+    }
+}
+
+static UUID get_group(const json &j)
+{
+    if (j.is_object() && j.contains("group") && j.at("group").is_string())
+        return UUID{j.at("group").get<std::string>()};
+    return UUID();
+}
+
+bool BinaryDocument::is_binary_document(const std::filesystem::path &path)
+{
+    std::ifstream ifs{path, std::ios::binary};
+    char buf[sizeof(magic)];
+    if (!ifs.read(buf, sizeof(buf)))
+        return false;
+    return memcmp(buf, magic, sizeof(magic)) == 0;
+}
+
+bool BinaryDocument::has_binary_suffix(const std::filesystem::path &path)
+{
+    return path.extension() == suffix;
+}
+
+json BinaryDocument::load_as_json(const std::filesystem::path &path)
+{
+    BinaryDocumentReader reader{path};
+    json j = reader.get_meta();
+    for (const auto &[section, key] : {std::make_pair(Section::GROUPS, "groups"),
+                                       std::make_pair(Section::ENTITIES, "entities"),
+                                       std::make_pair(Section::CONSTRAINTS, "constraints")}) {
+        auto o = json::object();
+        reader.read_section(section, [&o](const UUID &uu, const json &it) { o[static_cast<std::string>(uu)] = it; });
+        j[key] = o;
+    }
+    return j;
+}
+
+void BinaryDocument::save_from_json(const std::filesystem::path &path, const json &j)
+{
+    BinaryDocumentWriter writer{path};
+    {
+        auto meta = j;
+        meta.erase("groups");
+        meta.erase("entities");
+        meta.erase("constraints");
+        writer.write_meta(meta);
+    }
+
+    writer.begin_section(Section::GROUPS);
+    for (const auto &[uu, it] : j.at("groups").items()) {
+        writer.add_record(UUID{uu}, it);
+    }
+    writer.end_section();
+
+    for (const auto &[section, key] :
+         {std::make_pair(Section::ENTITIES, "entities"), std::make_pair(Section::CONSTRAINTS, "constraints")}) {
+        std::map<UUID, std::vector<std::pair<UUID, const json *>>> by_group;
+        for (const auto &[uu, it] : j.at(key).items()) {
+            by_group[get_group(it)].emplace_back(UUID{uu}, &it);
+        }
+        writer.begin_section(section);
+        for (const auto &[group, items] : by_group) {
+            for (const auto &[uu, it] : items) {
+                writer.add_record(uu, *it);
+            }
+        }
+        writer.end_section();
+    }
+
+    writer.finish();
+}
+
+BinaryDocumentWriter::BinaryDocumentWriter(const std::filesystem::path &path)
+    : m_path(path), m_tmp_path(path.string() + ".tmp"), m_ofs(m_tmp_path, std::ios::binary | std::ios::trunc)
+{
+    if (!m_ofs.is_open())
+        throw std::runtime_error("file " + m_tmp_path.string() + " not opened");
+    m_ofs.write(BinaryDocument::magic, sizeof(BinaryDocument::magic));
+    write_le<uint32_t>(m_ofs, BinaryDocument::format_version);
+    write_le<uint32_t>(m_ofs, all_sections.size());
+    // filled in by finish()
+    const std::vector<char> table(all_sections.size() * section_table_entry_size, 0);
+    m_ofs.write(table.data(), table.size());
+}
+
+BinaryDocumentWriter::~BinaryDocumentWriter()
+{
+    if (!m_finished) {
+        m_ofs.close();
+        std::error_code ec;
+        std::filesystem::remove(m_tmp_path, ec);
+    }
+}
+
+void BinaryDocumentWriter::begin_section(BinaryDocument::Section section)
+{
+    if (m_current_section)
+        throw std::logic_error("section already open");
+    if (m_sections.contains(section))
+        throw std::logic_error("section already written");
+    m_current_section = section;
+    m_sections[section].offset = m_ofs.tellp();
+    m_current_range = nullptr;
+}
+
+void BinaryDocumentWriter::end_section()
+{
+    if (!m_current_section)
+        throw std::logic_error("no section open");
+    auto &info = m_sections.at(*m_current_section);
+    info.size = static_cast<uint64_t>(m_ofs.tellp()) - info.offset;
+    m_current_section.reset();
+}
+
+void BinaryDocumentWriter::write_meta(const json &j)
+{
+    begin_section(BinaryDocument::Section::META);
+    auto meta = j;
+    encode_uuids(meta);
+    write_bytes(m_ofs, json::to_cbor(meta));
+    end_section();
+}
+
+uint16_t BinaryDocumentWriter::get_type_index(const std::string &type)
+{
+    if (auto it = m_type_indices.find(type); it != m_type_indices.end())
+        return it->second;
+    if (m_types.size() >= no_type)
+        throw std::runtime_error("too many item types");
+    const uint16_t idx = m_types.size();
+    m_types.push_back(type);
+    m_type_indices.emplace(type, idx);
+    return idx;
+}
+
+void BinaryDocumentWriter::add_record(const UUID &uu, json j)
+{
+    using Section = BinaryDocument::Section;
+    if (!m_current_section)
+        throw std::logic_error("no section open");
+    const auto section = *m_current_section;
+    if (section == Section::ENTITIES || section == Section::CONSTRAINTS) {
+        const auto group = get_group(j);
+        if (!m_current_range || group != m_current_group) {
+            auto &item = m_group_index[group];
+            auto &range = (section == Section::ENTITIES) ? item.entities : item.constraints;
+            if (range.count)
+                throw std::logic_error("items aren't grouped by group");
+            range.offset = m_ofs.tellp();
+            m_current_range = &range;
+            m_current_group = group;
+        }
+        m_current_range->count++;
+    }
+
+    uint16_t type = no_type;
+    if (j.is_object() && j.contains("type") && j.at("type").is_string()) {
+        type = get_type_index(j.at("type").get<std::string>());
+        j.erase("type");
+    }
+    encode_uuids(j);
+
+    write_uuid(m_ofs, uu);
+    write_le<uint16_t>(m_ofs, type);
+    write_bytes(m_ofs, json::to_cbor(j));
+}
+
+void BinaryDocumentWriter::finish()
+{
+    using Section = BinaryDocument::Section;
+    if (m_current_section)
+        throw std::logic_error("section still open");
+
+    begin_section(Section::TYPES);
+    write_le<uint32_t>(m_ofs, m_types.size());
+    for (const auto &type : m_types) {
+        write_le<uint16_t>(m_ofs, type.size());
+        m_ofs.write(type.data(), type.size());
+    }
+    end_section();
+
+    begin_section(Section::GROUP_INDEX);
+    write_le<uint32_t>(m_ofs, m_group_index.size());
+    for (const auto &[group, item] : m_group_index) {
+        write_uuid(m_ofs, group);
+        for (const auto &range : {item.entities, item.constraints}) {
+            write_le<uint64_t>(m_ofs, range.offset);
+            write_le<uint32_t>(m_ofs, range.count);
+        }
+    }
+    end_section();
+
+    m_ofs.seekp(section_table_offset);
+    for (const auto section : all_sections) {
+        SectionInfo info;
+        if (m_sections.contains(section))
+            info = m_sections.at(section);
+        write_le<uint32_t>(m_ofs, static_cast<uint32_t>(section));
+        write_le<uint64_t>(m_ofs, info.offset);
+        write_le<uint64_t>(m_ofs, info.size);
+    }
+
+    m_ofs.close();
+    if (m_ofs.fail())
+        throw std::runtime_error("error writing " + m_tmp_path.string());
+    std::filesystem::rename(m_tmp_path, m_path);
+    m_finished = true;
+}
+
+BinaryDocumentReader::BinaryDocumentReader(const std::filesystem::path &path) : m_ifs(path, std::ios::binary)
+{
+    using Section = BinaryDocument::Section;
+    if (!m_ifs.is_open())
+        throw std::runtime_error("file " + path.string() + " not opened");
+
+    char buf[sizeof(BinaryDocument::magic)];
+    if (!m_ifs.read(buf, sizeof(buf)) || memcmp(buf, BinaryDocument::magic, sizeof(buf)))
+        throw std::runtime_error("not a binary document");
+    if (read_le<uint32_t>(m_ifs) > BinaryDocument::format_version)
+        throw std::runtime_error("binary document has been created by a newer version");
+
+    const auto n_sections = read_le<uint32_t>(m_ifs);
+    for (uint32_t i = 0; i < n_sections; i++) {
+        const auto section = static_cast<Section>(read_le<uint32_t>(m_ifs));
+        auto &info = m_sections[section];
+        info.offset = read_le<uint64_t>(m_ifs);
+        info.size = read_le<uint64_t>(m_ifs);
+    }
+
+    m_ifs.seekg(get_section(Section::META).offset);
+    m_meta = json::from_cbor(read_bytes(m_ifs), true, true, json::cbor_tag_handler_t::store);
+    decode_uuids(m_meta);
+
+    m_ifs.seekg(get_section(Section::TYPES).offset);
+    const auto n_types = read_le<uint32_t>(m_ifs);
+    m_types.reserve(n_types);
+    for (uint32_t i = 0; i < n_types; i++) {
+        std::string type(read_le<uint16_t>(m_ifs), '\0');
+        if (!m_ifs.read(type.data(), type.size()))
+            throw std::runtime_error("unexpected end of binary document");
+        m_types.push_back(std::move(type));
+    }
+
+    // files written without the index can only be read section by section
+    if (!m_sections.contains(Section::GROUP_INDEX))
+        return;
+    m_ifs.seekg(get_section(Section::GROUP_INDEX).offset);
+    const auto n_groups = read_le<uint32_t>(m_ifs);
+    for (uint32_t i = 0; i < n_groups; i++) {
+        auto &item = m_group_index[read_uuid(m_ifs)];
+        for (auto range : {&item.entities, &item.constraints}) {
+            range->offset = read_le<uint64_t>(m_ifs);
+            range->count = read_le<uint32_t>(m_ifs);
+        }
+    }
+}
+
+const BinaryDocumentReader::SectionInfo &BinaryDocumentReader::get_section(BinaryDocument::Section section) const
+{
+    if (!m_sections.contains(section))
+        throw std::runtime_error("binary document is missing a section");
+    return m_sections.at(section);
+}
+
+void BinaryDocumentReader::read_records(uint64_t offset, uint64_t end, std::optional<uint32_t> count,
+                                        const RecordCallback &cb)
+{
+    m_ifs.clear();
+    m_ifs.seekg(offset);
+    uint64_t pos = offset;
+    uint32_t n = 0;
+    while (count ? (n < *count) : (pos < end)) {
+        const auto uu = read_uuid(m_ifs);
+        const auto type = read_le<uint16_t>(m_ifs);
+        const auto bytes = read_bytes(m_ifs);
+        pos += UUID::size + 2 + 4 + bytes.size();
+        n++;
+
+        auto j = json::from_cbor(bytes, true, true, json::cbor_tag_handler_t::store);
+        decode_uuids(j);
+        if (type != no_type)
+            j["type"] = m_types.at(type);
+        cb(uu, j);
+    }
+}
+
+void BinaryDocumentReader::read_section(BinaryDocument::Section section, const RecordCallback &cb)
+{
+    const auto &info = get_section(section);
+    read_records(info.offset, info.offset + info.size, {}, cb);
+}
+
+std::vector<UUID> BinaryDocumentReader::get_indexed_groups() const
+{
+    std::vector<UUID> groups;
+    for (const auto &[group, item] : m_group_index) {
+        groups.push_back(group);
+    }
+    return groups;
+}
+
+void BinaryDocumentReader::read_group_items(const UUID &group, BinaryDocument::Section section,
+                                            const RecordCallback &cb)
+{
+    using Section = BinaryDocument::Section;
+    if (section != Section::ENTITIES && section != Section::CONSTRAINTS)
+        throw std::logic_error("only entities and constraints are indexed by group");
+    if (!m_group_index.contains(group))
+        return;
+    const auto &item = m_group_index.at(group);
+    const auto &range = (section == Section::ENTITIES) ? item.entities : item.constraints;
+    if (!range.count)
+        return;
+    const auto &info = get_section(section);
+    read_records(range.offset, info.offset + info.size, range.count, cb);
+}
+
+} // namespace dune3d
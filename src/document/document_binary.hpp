@@ -0,0 +1,142 @@
+#pragma once
+#include "nlohmann/json.hpp"
+#include "util/uuid.hpp"
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <optional>
+#include <vector>
+
+namespace dune3d {
+using json = nlohmann::json;
+
+// Compact alternative to the JSON document format. The file starts with a
+// section table, followed by the sections themselves:
+//
+//  META         top-level document keys (type, version) as CBOR
+//  TYPES        table of item type names referenced by the records
+//  GROUPS, ENTITIES, CONSTRAINTS
+//               one record per item: 16 byte UUID, type index, CBOR payload
+//  GROUP_INDEX  location of each group's entities and constraints so that
+//               they can be read without going through the whole file
+//
+// UUID-valued strings in the payloads are stored as 16 byte CBOR byte
+// strings tagged with 37, so converting from and to JSON is lossless.
+
+class BinaryDocument {
+public:
+    enum class Section : uint32_t {
+        META = 1,
+        TYPES = 2,
+        GROUPS = 3,
+        ENTITIES = 4,
+        CONSTRAINTS = 5,
+        GROUP_INDEX = 6,
+    };
+
+    static constexpr char magic[] = {'D', '3', 'D', 'B'};
+    static constexpr uint32_t format_version = 1;
+    static constexpr const char *suffix = ".d3dbin";
+
+    static bool is_binary_document(const std::filesystem::path &path);
+    static bool has_binary_suffix(const std::filesystem::path &path);
+
+    // lossless conversion from and to the JSON document format
+    static json load_as_json(const std::filesystem::path &path);
+    static void save_from_json(const std::filesystem::path &path, const json &j);
+};
+
+class BinaryDocumentWriter {
+public:
+    // writes to a temporary file that replaces path once finish() has been called
+    explicit BinaryDocumentWriter(const std::filesystem::path &path);
+    ~BinaryDocumentWriter();
+
+    void write_meta(const json &j);
+
+    // records in the ENTITIES and CONSTRAINTS sections must be grouped by
+    // their "group" member for the group index to be built
+    void begin_section(BinaryDocument::Section section);
+    void add_record(const UUID &uu, json j);
+    void end_section();
+
+    void finish();
+
+private:
+    std::filesystem::path m_path;
+    std::filesystem::path m_tmp_path;
+    std::ofstream m_ofs;
+
+    struct SectionInfo {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+    };
+    std::map<BinaryDocument::Section, SectionInfo> m_sections;
+    std::optional<BinaryDocument::Section> m_current_section;
+
+    std::vector<std::string> m_types;
+    std::map<std::string, uint16_t> m_type_indices;
+    uint16_t get_type_index(const std::string &type);
+
+    struct GroupRange {
+        uint64_t offset = 0;
+        uint32_t count = 0;
+    };
+    struct GroupIndexItem {
+        GroupRange entities;
+        GroupRange constraints;
+    };
+    std::map<UUID, GroupIndexItem> m_group_index;
+    GroupRange *m_current_range = nullptr;
+    UUID m_current_group;
+
+    bool m_finished = false;
+};
+
+class BinaryDocumentReader {
+public:
+    explicit BinaryDocumentReader(const std::filesystem::path &path);
+
+    const json &get_meta() const
+    {
+        return m_meta;
+    }
+
+    using RecordCallback = std::function<void(const UUID &uu, const json &j)>;
+    void read_section(BinaryDocument::Section section, const RecordCallback &cb);
+
+    // groups can be loaded lazily by only reading their own items
+    bool has_group_index() const
+    {
+        return m_group_index.size();
+    }
+    std::vector<UUID> get_indexed_groups() const;
+    void read_group_items(const UUID &group, BinaryDocument::Section section, const RecordCallback &cb);
+
+private:
+    std::ifstream m_ifs;
+
+    struct SectionInfo {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+    };
+    std::map<BinaryDocument::Section, SectionInfo> m_sections;
+    json m_meta;
+    std::vector<std::string> m_types;
+
+    struct GroupRange {
+        uint64_t offset = 0;
+        uint32_t count = 0;
+    };
+    struct GroupIndexItem {
+        GroupRange entities;
+        GroupRange constraints;
+    };
+    std::map<UUID, GroupIndexItem> m_group_index;
+
+    const SectionInfo &get_section(BinaryDocument::Section section) const;
+    void read_records(uint64_t offset, uint64_t end, std::optional<uint32_t> count, const RecordCallback &cb);
+};
+
+} // namespace dune3d
@@ -0,0 +1,30 @@
+#pragma once
+#include "entity.hpp"
+#include <typeinfo>
+#include <type_traits>
+
+namespace dune3d {
+
+// Checked downcast that compares the entity's type with T::s_type instead of
+// going through dynamic_cast. Like dynamic_cast, throws std::bad_cast on mismatch.
+template <typename T> T &entity_cast(Entity &en)
+{
+    if constexpr (std::is_same_v<T, Entity>) {
+        return en;
+    }
+    else if constexpr (requires { T::s_type; }) {
+        if (en.get_type() != T::s_type)
+            throw std::bad_cast();
+        return static_cast<T &>(en);
+    }
+    else {
+        return dynamic_cast<T &>(en);
+    }
+}
+
+template <typename T> const T &entity_cast(const Entity &en)
+{
+    return entity_cast<T>(const_cast<Entity &>(en));
+}
+
+} // namespace dune3d
@@ -127,14 +127,8 @@ std::unique_ptr<Group> Group::new_from_json(const UUID &uu, const json &j)
 
 Group::BodyAndGroup Group::find_body(const Document &doc) const
 {
-    const Group *body_group = nullptr;
-    for (auto group : doc.get_groups_sorted()) {
-        if (group->m_body)
-            body_group = group;
-        if (group == this)
-            return {body_group->m_body.value(), *body_group};
-    }
-    throw std::runtime_error("body not found");
+    auto &body_group = doc.get_body_group(m_uuid);
+    return {body_group.m_body.value(), body_group};
 }
 
 GroupStatusMessage::Status GroupStatusMessage::summarize(const std::list<GroupStatusMessage> &msgs)
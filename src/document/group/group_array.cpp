@@ -12,6 +12,7 @@
 #include "document/entity/entity_circle3d.hpp"
 #include "document/entity/entity_arc3d.hpp"
 #include "document/solid_model.hpp"
+#include "document/constraint/constraint.hpp"
 
 namespace dune3d {
 GroupArray::GroupArray(const UUID &uu) : Group(uu)
@@ -50,100 +51,205 @@ UUID GroupArray::get_entity_uuid(const UUID &uu, unsigned int instance) const
                       {reinterpret_cast<const uint8_t *>(&instance), sizeof(instance)});
 }
 
-void GroupArray::generate(Document &doc) const
+bool GroupArray::is_arrayed(const Entity &en) const
+{
+    if (en.m_group != m_source_group)
+        return false;
+    if (en.m_construction)
+        return false;
+    switch (en.get_type()) {
+    case Entity::Type::LINE_2D:
+    case Entity::Type::CIRCLE_2D:
+    case Entity::Type::ARC_2D:
+        return dynamic_cast<const IEntityInWorkplane &>(en).get_workplane() == m_active_wrkpl;
+    case Entity::Type::LINE_3D:
+    case Entity::Type::CIRCLE_3D:
+    case Entity::Type::ARC_3D:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool GroupArray::is_source_of_other_array(const Document &doc) const
+{
+    for (const auto &[uu, group] : doc.get_groups()) {
+        if (auto gr_array = dynamic_cast<const GroupArray *>(group.get());
+            gr_array && uu != m_uuid && gr_array->m_source_group == m_uuid)
+            return true;
+    }
+    return false;
+}
+
+static std::unique_ptr<Entity> create_entity(Entity::Type type, const UUID &uu)
+{
+    switch (type) {
+    case Entity::Type::LINE_2D:
+        return std::make_unique<EntityLine2D>(uu);
+    case Entity::Type::CIRCLE_2D:
+        return std::make_unique<EntityCircle2D>(uu);
+    case Entity::Type::ARC_2D:
+        return std::make_unique<EntityArc2D>(uu);
+    case Entity::Type::LINE_3D:
+        return std::make_unique<EntityLine3D>(uu);
+    case Entity::Type::CIRCLE_3D:
+        return std::make_unique<EntityCircle3D>(uu);
+    case Entity::Type::ARC_3D:
+        return std::make_unique<EntityArc3D>(uu);
+    default:
+        throw std::runtime_error("can't array entity of type " + Entity::get_type_name(type));
+    }
+}
+
+void GroupArray::update_instance(const Document &doc, const Entity &src, Entity &dest, unsigned int instance) const
+{
+    dest.m_kind = ItemKind::GENRERATED;
+    dest.m_generated_from = src.m_uuid;
+    dest.m_group = m_uuid;
+
+    switch (src.get_type()) {
+    case Entity::Type::LINE_2D: {
+        const auto &li = entity_cast<EntityLine2D>(src);
+        auto &new_line = entity_cast<EntityLine2D>(dest);
+        new_line.m_p1 = transform(li.m_p1, instance);
+        new_line.m_p2 = transform(li.m_p2, instance);
+        new_line.m_wrkpl = li.m_wrkpl;
+    } break;
+
+    case Entity::Type::CIRCLE_2D: {
+        const auto &circle = entity_cast<EntityCircle2D>(src);
+        auto &new_circle = entity_cast<EntityCircle2D>(dest);
+        new_circle.m_center = transform(circle.m_center, instance);
+        new_circle.m_radius = circle.m_radius;
+        new_circle.m_wrkpl = circle.m_wrkpl;
+    } break;
+
+    case Entity::Type::ARC_2D: {
+        const auto &arc = entity_cast<EntityArc2D>(src);
+        auto &new_arc = entity_cast<EntityArc2D>(dest);
+        new_arc.m_no_radius_constraint = true;
+        new_arc.m_from = transform(arc.m_from, instance);
+        new_arc.m_to = transform(arc.m_to, instance);
+        new_arc.m_center = transform(arc.m_center, instance);
+        new_arc.m_wrkpl = arc.m_wrkpl;
+    } break;
+
+    case Entity::Type::LINE_3D: {
+        const auto &li = entity_cast<EntityLine3D>(src);
+        auto &new_line = entity_cast<EntityLine3D>(dest);
+        new_line.m_p1 = transform(doc, li.m_p1, instance);
+        new_line.m_p2 = transform(doc, li.m_p2, instance);
+    } break;
+
+    case Entity::Type::CIRCLE_3D: {
+        const auto &circle = entity_cast<EntityCircle3D>(src);
+        auto &new_circle = entity_cast<EntityCircle3D>(dest);
+        new_circle.m_center = transform(doc, circle.m_center, instance);
+        new_circle.m_radius = circle.m_radius;
+        new_circle.m_normal = circle.m_normal;
+    } break;
+
+    case Entity::Type::ARC_3D: {
+        const auto &arc = entity_cast<EntityArc3D>(src);
+        auto &new_arc = entity_cast<EntityArc3D>(dest);
+        new_arc.m_from = transform(doc, arc.m_from, instance);
+        new_arc.m_to = transform(doc, arc.m_to, instance);
+        new_arc.m_center = transform(doc, arc.m_center, instance);
+        new_arc.m_normal = arc.m_normal;
+    } break;
+
+    default:;
+    }
+}
+
+void GroupArray::generate_instances(Document &doc, const std::function<bool(const UUID &)> &filter) const
 {
     for (const auto &[uu, it] : doc.m_entities) {
-        if (it->m_group != m_source_group)
+        if (!is_arrayed(*it))
             continue;
-        if (it->m_construction)
+        for (unsigned int instance = 0; instance < m_count; instance++) {
+            const auto new_uu = get_entity_uuid(uu, instance);
+            if (!filter(new_uu))
+                continue;
+            auto en_it = doc.m_entities.find(new_uu);
+            if (en_it == doc.m_entities.end())
+                en_it = doc.m_entities.emplace(new_uu, create_entity(it->get_type(), new_uu)).first;
+            update_instance(doc, *it, *en_it->second, instance);
+        }
+    }
+}
+
+void GroupArray::generate(Document &doc) const
+{
+    // arrays of this array repeat its entities and tie them to the
+    // instances in the solver, so they need all of them
+    if (is_source_of_other_array(doc)) {
+        materialize_all_instances(doc);
+        return;
+    }
+
+    auto referenced = m_pinned_instances.uus;
+    for (const auto &[uu, constraint] : doc.m_constraints) {
+        auto refs = constraint->get_referenced_entities();
+        referenced.insert(refs.begin(), refs.end());
+    }
+    for (const auto &[uu, group] : doc.get_groups()) {
+        auto refs = group->get_required_entities(doc);
+        referenced.insert(refs.begin(), refs.end());
+    }
+    generate_instances(doc, [&referenced](const UUID &uu) { return referenced.contains(uu); });
+}
+
+void GroupArray::materialize_all_instances(Document &doc) const
+{
+    generate_instances(doc, [](const UUID &) { return true; });
+}
+
+bool GroupArray::materialize_instances(Document &doc, const std::set<UUID> &uus)
+{
+    m_pinned_instances.uus.clear();
+    std::set<UUID> missing;
+    for (const auto &uu : uus) {
+        if (auto it = doc.m_entities.find(uu); it != doc.m_entities.end()) {
+            if (it->second->m_group == m_uuid && it->second->m_kind == ItemKind::GENRERATED)
+                m_pinned_instances.uus.insert(uu);
+        }
+        else {
+            missing.insert(uu);
+        }
+    }
+    if (missing.empty())
+        return false;
+
+    bool materialized = false;
+    generate_instances(doc, [this, &missing, &materialized](const UUID &uu) {
+        if (!missing.contains(uu))
+            return false;
+        m_pinned_instances.uus.insert(uu);
+        materialized = true;
+        return true;
+    });
+    return materialized;
+}
+
+void GroupArray::for_each_virtual_instance(const Document &doc,
+                                           const std::function<void(const Entity &)> &fn) const
+{
+    // one entity per type that gets moved to each instance in turn
+    std::map<Entity::Type, std::unique_ptr<Entity>> scratch;
+    for (const auto &[uu, it] : doc.m_entities) {
+        if (!is_arrayed(*it))
             continue;
+        auto &en = scratch[it->get_type()];
+        if (!en)
+            en = create_entity(it->get_type(), UUID());
         for (unsigned int instance = 0; instance < m_count; instance++) {
-            if (it->get_type() == Entity::Type::LINE_2D) {
-                const auto &li = dynamic_cast<const EntityLine2D &>(*it);
-                if (li.m_wrkpl != m_active_wrkpl)
-                    continue;
-                {
-                    auto new_line_uu = get_entity_uuid(uu, instance);
-                    auto &new_line = doc.get_or_add_entity<EntityLine2D>(new_line_uu);
-                    new_line.m_p1 = transform(li.m_p1, instance);
-                    new_line.m_p2 = transform(li.m_p2, instance);
-                    new_line.m_kind = ItemKind::GENRERATED;
-                    new_line.m_generated_from = uu;
-                    new_line.m_group = m_uuid;
-                    new_line.m_wrkpl = li.m_wrkpl;
-                }
-            }
-            else if (it->get_type() == Entity::Type::CIRCLE_2D) {
-                const auto &circle = dynamic_cast<const EntityCircle2D &>(*it);
-                if (circle.m_wrkpl != m_active_wrkpl)
-                    continue;
-                {
-                    auto new_circle_uu = get_entity_uuid(uu, instance);
-                    auto &new_circle = doc.get_or_add_entity<EntityCircle2D>(new_circle_uu);
-                    new_circle.m_center = transform(circle.m_center, instance);
-                    new_circle.m_radius = circle.m_radius;
-                    new_circle.m_kind = ItemKind::GENRERATED;
-                    new_circle.m_generated_from = uu;
-                    new_circle.m_group = m_uuid;
-                    new_circle.m_wrkpl = circle.m_wrkpl;
-                }
-            }
-            else if (it->get_type() == Entity::Type::ARC_2D) {
-                const auto &arc = dynamic_cast<const EntityArc2D &>(*it);
-                if (arc.m_wrkpl != m_active_wrkpl)
-                    continue;
-                {
-                    auto new_arc_uu = get_entity_uuid(uu, instance);
-                    auto &new_arc = doc.get_or_add_entity<EntityArc2D>(new_arc_uu);
-                    new_arc.m_no_radius_constraint = true;
-                    new_arc.m_from = transform(arc.m_from, instance);
-                    new_arc.m_to = transform(arc.m_to, instance);
-                    new_arc.m_center = transform(arc.m_center, instance);
-                    new_arc.m_kind = ItemKind::GENRERATED;
-                    new_arc.m_generated_from = uu;
-                    new_arc.m_group = m_uuid;
-                    new_arc.m_wrkpl = arc.m_wrkpl;
-                }
-            }
-            else if (it->get_type() == Entity::Type::LINE_3D) {
-                const auto &li = dynamic_cast<const EntityLine3D &>(*it);
-                {
-                    auto new_line_uu = get_entity_uuid(uu, instance);
-                    auto &new_line = doc.get_or_add_entity<EntityLine3D>(new_line_uu);
-                    new_line.m_p1 = transform(doc, li.m_p1, instance);
-                    new_line.m_p2 = transform(doc, li.m_p2, instance);
-                    new_line.m_kind = ItemKind::GENRERATED;
-                    new_line.m_generated_from = uu;
-                    new_line.m_group = m_uuid;
-                }
-            }
-            else if (it->get_type() == Entity::Type::CIRCLE_3D) {
-                const auto &circle = dynamic_cast<const EntityCircle3D &>(*it);
-                {
-                    auto new_circle_uu = get_entity_uuid(uu, instance);
-                    auto &new_circle = doc.get_or_add_entity<EntityCircle3D>(new_circle_uu);
-                    new_circle.m_center = transform(doc, circle.m_center, instance);
-                    new_circle.m_radius = circle.m_radius;
-                    new_circle.m_kind = ItemKind::GENRERATED;
-                    new_circle.m_generated_from = uu;
-                    new_circle.m_group = m_uuid;
-                    new_circle.m_normal = circle.m_normal;
-                }
-            }
-            else if (it->get_type() == Entity::Type::ARC_3D) {
-                const auto &arc = dynamic_cast<const EntityArc3D &>(*it);
-                {
-                    auto new_arc_uu = get_entity_uuid(uu, instance);
-                    auto &new_arc = doc.get_or_add_entity<EntityArc3D>(new_arc_uu);
-                    new_arc.m_from = transform(doc, arc.m_from, instance);
-                    new_arc.m_to = transform(doc, arc.m_to, instance);
-                    new_arc.m_center = transform(doc, arc.m_center, instance);
-                    new_arc.m_kind = ItemKind::GENRERATED;
-                    new_arc.m_generated_from = uu;
-                    new_arc.m_group = m_uuid;
-                    new_arc.m_normal = arc.m_normal;
-                }
-            }
+            const auto new_uu = get_entity_uuid(uu, instance);
+            if (doc.m_entities.contains(new_uu))
+                continue;
+            en->m_uuid = new_uu;
+            update_instance(doc, *it, *en, instance);
+            fn(*en);
         }
     }
 }
@@ -4,11 +4,14 @@
 #include "igroup_solid_model.hpp"
 #include "igroup_source_group.hpp"
 #include <glm/glm.hpp>
+#include <functional>
+#include <vector>
 
 namespace dune3d {
 
 class Document;
 class SolidModel;
+class Entity;
 
 class GroupArray : public Group, public IGroupGenerate, public IGroupSolidModel, public IGroupSourceGroup {
 public:
@@ -43,6 +46,17 @@ public:
 
     UUID get_entity_uuid(const UUID &uu, unsigned int instance) const;
 
+    // Instances only get materialized as entities if a constraint or another
+    // group refers to them. fn gets called for each of the remaining ones
+    // with an entity that's only valid during the call and gets reused for
+    // the next instance of the same type.
+    void for_each_virtual_instance(const Document &doc, const std::function<void(const Entity &)> &fn) const;
+
+    // materializes the instances among uus and keeps them across regenerating
+    // the group until the next call, returns true if any had to be created
+    bool materialize_instances(Document &doc, const std::set<UUID> &uus);
+    void materialize_all_instances(Document &doc) const;
+
     std::list<GroupStatusMessage> m_array_messages;
     std::list<GroupStatusMessage> get_messages() const override;
 
@@ -59,6 +73,29 @@ public:
 protected:
     virtual glm::dvec2 transform(const glm::dvec2 &p, unsigned int instance) const = 0;
     virtual glm::dvec3 transform(const Document &doc, const glm::dvec3 &p, unsigned int instance) const = 0;
+
+private:
+    // instances kept by materialize_instances, these only matter to the
+    // document the canvas shows, so copies such as history items start
+    // out without any
+    class PinnedInstances {
+    public:
+        PinnedInstances() = default;
+        PinnedInstances(const PinnedInstances &)
+        {
+        }
+        PinnedInstances &operator=(const PinnedInstances &)
+        {
+            return *this;
+        }
+        std::set<UUID> uus;
+    };
+    PinnedInstances m_pinned_instances;
+
+    bool is_arrayed(const Entity &en) const;
+    bool is_source_of_other_array(const Document &doc) const;
+    void update_instance(const Document &doc, const Entity &src, Entity &dest, unsigned int instance) const;
+    void generate_instances(Document &doc, const std::function<bool(const UUID &)> &filter) const;
 };
 
 } // namespace dune3d
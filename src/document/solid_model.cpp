@@ -8,27 +8,37 @@ namespace dune3d {
 
 SolidModel::~SolidModel() = default;
 
+static thread_local bool s_preview = false;
+
+SolidModel::PreviewScope::PreviewScope()
+{
+    s_preview = true;
+}
+
+SolidModel::PreviewScope::~PreviewScope()
+{
+    s_preview = false;
+}
+
+bool SolidModel::get_preview()
+{
+    return s_preview;
+}
+
 const IGroupSolidModel *SolidModel::get_last_solid_model_group(const Document &doc, const Group &group)
 {
-    const IGroupSolidModel *last_solid_model_group = nullptr;
-
-    auto this_body = &group.find_body(doc).body;
-
-    for (auto gr : doc.get_groups_sorted()) {
-        if (gr->m_uuid == group.m_uuid)
-            break;
-        if (auto gr_solid = dynamic_cast<const IGroupSolidModel *>(gr)) {
-            if (auto solid_model = dynamic_cast<const SolidModelOcc *>(gr_solid->get_solid_model())) {
-                auto body = &gr->find_body(doc).body;
-                if (body != this_body)
-                    continue;
-                if (!solid_model->m_shape_acc.IsNull())
-                    last_solid_model_group = gr_solid;
-            }
+    // usually the previous solid model group is the one we're looking for,
+    // ones that didn't produce a shape are skipped
+    for (auto gr = doc.get_previous_solid_model_group(group.m_uuid); gr;
+         gr = doc.get_previous_solid_model_group(gr->m_uuid)) {
+        auto &gr_solid = dynamic_cast<const IGroupSolidModel &>(*gr);
+        if (auto solid_model = dynamic_cast<const SolidModelOcc *>(gr_solid.get_solid_model())) {
+            if (!solid_model->m_shape_acc.IsNull())
+                return &gr_solid;
         }
     }
 
-    return last_solid_model_group;
+    return nullptr;
 }
 
 const SolidModel *SolidModel::get_last_solid_model(const Document &doc, const Group &group)
@@ -4,6 +4,7 @@
 #include <filesystem>
 #include <vector>
 #include <map>
+#include <string>
 #include <glm/glm.hpp>
 #include "group/all_groups_fwd.hpp"
 
@@ -16,8 +17,29 @@ class IGroupSolidModel;
 
 class SolidModel {
 public:
-    face::Faces m_faces;
-    std::map<unsigned int, std::vector<glm::dvec3>> m_edges;
+    using Edges = std::map<unsigned int, std::vector<glm::dvec3>>;
+
+    // meshes are created on first use and dropped again once they
+    // haven't been used for a while, so hold on to the returned pointers
+    // for as long as they're needed
+    virtual std::shared_ptr<const face::Faces> get_faces() const = 0;
+    // lower resolution mesh for drawing while the view is being navigated
+    virtual std::shared_ptr<const face::Faces> get_faces_coarse() const = 0;
+    virtual std::shared_ptr<const Edges> get_edges() const = 0;
+
+    // solid models created on this thread while a PreviewScope exists are
+    // previews: they get a coarse mesh to keep scrubbing group parameters
+    // interactive and are kept out of the SolidModelCache
+    class PreviewScope {
+    public:
+        PreviewScope();
+        ~PreviewScope();
+    };
+    static bool get_preview();
+    const bool m_preview = get_preview();
+
+    // hash of the inputs this model was created from, see SolidModelCache
+    std::string m_cache_key;
 
     static std::shared_ptr<const SolidModel> create(const Document &doc, GroupExtrude &group);
     static std::shared_ptr<const SolidModel> create(const Document &doc, GroupFillet &group);
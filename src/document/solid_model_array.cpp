@@ -1,9 +1,11 @@
 #include "solid_model.hpp"
 #include "solid_model_occ.hpp"
+#include "solid_model_cache.hpp"
 #include "document.hpp"
 #include "entity/entity_workplane.hpp"
 #include "group/group_linear_array.hpp"
 #include "group/group_polar_array.hpp"
+#include "nlohmann/json.hpp"
 #include <BRepBuilderAPI_Transform.hxx>
 
 #include <BRepAlgoAPI_Fuse.hxx>
@@ -43,8 +45,30 @@ static std::shared_ptr<const SolidModel> create_array(const Document &doc, Group
         return nullptr;
     }
 
+    std::vector<gp_Trsf> trsfs;
+    trsfs.reserve(group.m_count);
+    auto j_trsfs = json::array();
     for (unsigned int instance = 0; instance < group.m_count; instance++) {
-        auto trsf = make_trsf(instance);
+        auto &trsf = trsfs.emplace_back(make_trsf(instance));
+        auto &j_trsf = j_trsfs.emplace_back(json::array());
+        for (int row = 1; row <= 3; row++) {
+            for (int col = 1; col <= 4; col++) {
+                j_trsf.push_back(trsf.Value(row, col));
+            }
+        }
+    }
+    const json inputs = {
+            {"type", "array"},
+            {"source", source_solid_model->m_cache_key},
+            {"transforms", j_trsfs},
+            {"operation", static_cast<int>(group.m_operation)},
+            {"last", last_solid_model->m_cache_key},
+    };
+    mod->m_cache_key = SolidModelCache::make_key(inputs);
+    if (auto cached = SolidModelCache::get().find(mod->m_cache_key))
+        return cached;
+
+    for (const auto &trsf : trsfs) {
         TopoDS_Shape sh = BRepBuilderAPI_Transform(source_solid_model->m_shape, trsf);
         if (mod->m_shape.IsNull())
             mod->m_shape = sh;
@@ -59,8 +83,8 @@ static std::shared_ptr<const SolidModel> create_array(const Document &doc, Group
         return nullptr;
     }
 
-    mod->find_edges();
-    mod->triangulate();
+    SolidModelCache::get().add(mod->m_cache_key, mod);
+
     return mod;
 }
 
@@ -0,0 +1,341 @@
+#include "solid_model_cache.hpp"
+#include "solid_model_occ.hpp"
+#include "util/fs_util.hpp"
+#include "logger/logger.hpp"
+#include "logger/log_util.hpp"
+#include "nlohmann/json.hpp"
+#include <glibmm.h>
+#include <BinTools.hxx>
+#include <BRepBuilderAPI_Copy.hxx>
+#include <span>
+#include <algorithm>
+
+namespace dune3d {
+
+namespace fs = std::filesystem;
+
+static fs::path get_cache_dir()
+{
+    return fs::path(Glib::get_user_cache_dir()) / "dune3d" / "solid_model";
+}
+
+SolidModelCache::SolidModelCache()
+{
+    std::error_code ec;
+    fs::create_directories(get_cache_dir(), ec);
+    scan_disk();
+    m_thread = std::thread(&SolidModelCache::disk_writer, this);
+}
+
+SolidModelCache::~SolidModelCache()
+{
+    // it's only a cache, so writes that haven't started yet can be dropped
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_one();
+    m_thread.join();
+}
+
+SolidModelCache &SolidModelCache::get()
+{
+    static SolidModelCache instance;
+    return instance;
+}
+
+std::string SolidModelCache::make_key(const json &inputs)
+{
+    const auto s = inputs.dump();
+    Glib::Checksum chk(Glib::Checksum::Type::SHA256);
+    chk.update(reinterpret_cast<const unsigned char *>(s.data()), s.size());
+    return chk.get_string();
+}
+
+std::shared_ptr<const SolidModel> SolidModelCache::find(const std::string &key)
+{
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        if (auto it = m_models.find(key); it != m_models.end()) {
+            m_stats.hits++;
+            m_lru.splice(m_lru.begin(), m_lru, it->second.lru_it);
+            return it->second.model;
+        }
+    }
+
+    // reading the shapes takes a while, so don't hold up the writer and other lookups meanwhile
+    auto model = load_from_disk(key);
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (!model) {
+        m_stats.misses++;
+        return nullptr;
+    }
+    m_stats.disk_hits++;
+    if (auto dit = m_disk_entries.find(key); dit != m_disk_entries.end())
+        m_disk_lru.splice(m_disk_lru.begin(), m_disk_lru, dit->second.lru_it);
+    // another thread may have been faster
+    if (auto it = m_models.find(key); it != m_models.end()) {
+        m_lru.splice(m_lru.begin(), m_lru, it->second.lru_it);
+        return it->second.model;
+    }
+    m_lru.push_front(key);
+    m_models.emplace(key, Entry{model, m_lru.begin()});
+    evict();
+    return model;
+}
+
+void SolidModelCache::add(const std::string &key, std::shared_ptr<const SolidModel> model)
+{
+    // previews have the same key as the full-quality model but a coarse mesh
+    if (!model || model->m_preview)
+        return;
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (auto it = m_models.find(key); it != m_models.end()) {
+        it->second.model = model;
+        m_lru.splice(m_lru.begin(), m_lru, it->second.lru_it);
+        return;
+    }
+    m_lru.push_front(key);
+    m_models.emplace(key, Entry{model, m_lru.begin()});
+    evict();
+}
+
+void SolidModelCache::queue_write(const std::string &key, const SolidModelOcc &model)
+{
+    if (model.m_shape_acc.IsNull())
+        return;
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        if (m_disk_entries.contains(key))
+            return;
+        if (std::ranges::any_of(m_pending_writes, [&key](const auto &wr) { return wr.key == key; }))
+            return;
+    }
+
+    // copied on the calling thread, which is the one that meshes models,
+    // including the triangulation so that loading doesn't need to remesh
+    PendingWrite wr{.key = key, .shape_acc = BRepBuilderAPI_Copy(model.m_shape_acc, true, true).Shape()};
+    if (!model.m_shape.IsNull())
+        wr.shape = BRepBuilderAPI_Copy(model.m_shape, true, true).Shape();
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_pending_writes.push_back(std::move(wr));
+    m_cond.notify_one();
+}
+
+void SolidModelCache::evict()
+{
+    while (m_models.size() > m_max_entries) {
+        m_models.erase(m_lru.back());
+        m_lru.pop_back();
+        m_stats.evictions++;
+    }
+}
+
+// each model is stored as the two shapes in OCC's binary BRep format,
+// which includes the triangulation, and a small UBJSON file written last
+// so that its presence marks a complete entry
+
+std::shared_ptr<const SolidModel> SolidModelCache::load_from_disk(const std::string &key) const
+{
+    const auto base = get_cache_dir() / key;
+    const auto json_path = fs::path(base).concat("-v2.ubjson");
+    if (!fs::exists(json_path))
+        return nullptr;
+    try {
+        auto rd = Glib::file_get_contents(path_to_string(json_path));
+        const auto j = json::from_ubjson(std::span(rd.data(), rd.size()));
+
+        auto mod = std::make_shared<SolidModelOcc>();
+        if (j.at("shape").get<bool>()) {
+            if (!BinTools::Read(mod->m_shape, path_to_string(fs::path(base).concat("-shape.bin")).c_str()))
+                return nullptr;
+        }
+        if (!BinTools::Read(mod->m_shape_acc, path_to_string(fs::path(base).concat("-acc.bin")).c_str()))
+            return nullptr;
+        mod->m_cache_key = key;
+
+        // keeps recently used entries from being pruned
+        fs::last_write_time(json_path, fs::file_time_type::clock::now());
+        return mod;
+    }
+    CATCH_LOG(Logger::Level::WARNING, "error loading cached solid model", Logger::Domain::DOCUMENT)
+    return nullptr;
+}
+
+// written to a temporary file first, so that neither a concurrent load
+// nor a crash can see a partially written file
+static bool write_shape(const TopoDS_Shape &shape, const fs::path &path)
+{
+    auto tmp_path = path;
+    tmp_path += ".tmp";
+    if (!BinTools::Write(shape, path_to_string(tmp_path).c_str())) {
+        std::error_code ec;
+        fs::remove(tmp_path, ec);
+        return false;
+    }
+    fs::rename(tmp_path, path);
+    return true;
+}
+
+uintmax_t SolidModelCache::save_to_disk(const std::string &key, const TopoDS_Shape &shape,
+                                        const TopoDS_Shape &shape_acc)
+{
+    const auto base = get_cache_dir() / key;
+    const auto shape_path = fs::path(base).concat("-shape.bin");
+    const auto acc_path = fs::path(base).concat("-acc.bin");
+    const auto json_path = fs::path(base).concat("-v2.ubjson");
+    try {
+        if (!shape.IsNull()) {
+            if (!write_shape(shape, shape_path))
+                return 0;
+        }
+        if (!write_shape(shape_acc, acc_path))
+            return 0;
+
+        const json j = {
+                {"shape", !shape.IsNull()},
+        };
+        const auto bs = json::to_ubjson(j);
+        // also goes through a temporary file
+        Glib::file_set_contents(path_to_string(json_path), reinterpret_cast<const gchar *>(bs.data()), bs.size());
+
+        uintmax_t size = fs::file_size(acc_path) + fs::file_size(json_path);
+        if (!shape.IsNull())
+            size += fs::file_size(shape_path);
+        return size;
+    }
+    CATCH_LOG(Logger::Level::WARNING, "error saving solid model to cache", Logger::Domain::DOCUMENT)
+    return 0;
+}
+
+void SolidModelCache::remove_from_disk(const std::string &key)
+{
+    const auto base = get_cache_dir() / key;
+    std::error_code ec;
+    // the UBJSON file marks a complete entry, so it goes first
+    fs::remove(fs::path(base).concat("-v2.ubjson"), ec);
+    fs::remove(fs::path(base).concat("-shape.bin"), ec);
+    fs::remove(fs::path(base).concat("-acc.bin"), ec);
+}
+
+void SolidModelCache::scan_disk()
+{
+    // entries that haven't been used for a month are unlikely to be
+    // needed again
+    const auto cutoff = fs::file_time_type::clock::now() - std::chrono::days(30);
+    std::vector<std::pair<fs::file_time_type, std::string>> entries;
+    std::map<std::string, uintmax_t> sizes;
+    std::vector<fs::path> tmp_paths;
+    try {
+        for (const auto &it : fs::directory_iterator(get_cache_dir())) {
+            const auto &path = it.path();
+            if (path.extension() == ".tmp") {
+                // left behind by an interrupted write
+                tmp_paths.push_back(path);
+                continue;
+            }
+            auto stem = path.stem().string();
+            const auto key = stem.substr(0, stem.rfind('-'));
+            sizes[key] += it.file_size();
+            if (path.extension() == ".ubjson")
+                entries.emplace_back(it.last_write_time(), key);
+        }
+    }
+    CATCH_LOG(Logger::Level::WARNING, "error scanning solid model cache", Logger::Domain::DOCUMENT)
+
+    for (const auto &path : tmp_paths) {
+        std::error_code ec;
+        fs::remove(path, ec);
+    }
+
+    // oldest first, so that the most recently used one ends up at the front
+    std::ranges::sort(entries);
+    for (const auto &[time, key] : entries) {
+        if (time < cutoff)
+            remove_from_disk(key);
+        else
+            add_disk_entry(key, sizes.at(key));
+    }
+    // shapes without a UBJSON file are from an interrupted write
+    for (const auto &[key, size] : sizes) {
+        if (!m_disk_entries.contains(key))
+            remove_from_disk(key);
+    }
+    for (const auto &key : evict_disk())
+        remove_from_disk(key);
+}
+
+void SolidModelCache::add_disk_entry(const std::string &key, uintmax_t size)
+{
+    if (auto it = m_disk_entries.find(key); it != m_disk_entries.end()) {
+        m_disk_used -= it->second.size;
+        m_disk_lru.erase(it->second.lru_it);
+        m_disk_entries.erase(it);
+    }
+    m_disk_lru.push_front(key);
+    m_disk_entries.emplace(key, DiskEntry{size, m_disk_lru.begin()});
+    m_disk_used += size;
+}
+
+std::vector<std::string> SolidModelCache::evict_disk()
+{
+    std::vector<std::string> victims;
+    while (m_disk_used > s_disk_budget && m_disk_lru.size() > 1) {
+        auto victim = m_disk_lru.back();
+        m_disk_used -= m_disk_entries.at(victim).size;
+        m_disk_entries.erase(victim);
+        m_disk_lru.pop_back();
+        victims.push_back(victim);
+    }
+    return victims;
+}
+
+void SolidModelCache::disk_writer()
+{
+    while (true) {
+        PendingWrite wr;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cond.wait(lock, [this] { return m_stop || m_pending_writes.size(); });
+            if (m_stop)
+                return;
+            // stays queued until written so that it isn't queued a second time
+            wr = m_pending_writes.front();
+        }
+
+        const auto size = save_to_disk(wr.key, wr.shape, wr.shape_acc);
+        wr.shape.Nullify();
+        wr.shape_acc.Nullify();
+
+        std::vector<std::string> victims;
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_pending_writes.pop_front();
+            if (size) {
+                add_disk_entry(wr.key, size);
+                victims = evict_disk();
+            }
+        }
+        for (const auto &key : victims)
+            remove_from_disk(key);
+    }
+}
+
+void SolidModelCache::set_max_entries(size_t n)
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_max_entries = n;
+    evict();
+}
+
+SolidModelCache::Stats SolidModelCache::get_stats() const
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    auto stats = m_stats;
+    stats.entries = m_models.size();
+    return stats;
+}
+
+} // namespace dune3d
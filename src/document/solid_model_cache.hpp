@@ -0,0 +1,97 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <list>
+#include <string>
+#include <thread>
+#include <vector>
+#include <filesystem>
+#include "nlohmann/json_fwd.hpp"
+#include <TopoDS_Shape.hxx>
+
+namespace dune3d {
+
+using json = nlohmann::json;
+class SolidModel;
+class SolidModelOcc;
+
+// keeps recently created solid models around, keyed by a hash of
+// everything that went into them, so that undo/redo and edits that
+// don't change a group's inputs don't need to redo the OCC operations.
+// Models are also written to the user cache dir on a worker thread, so
+// that opening an unchanged document only needs to load them. The least
+// recently used ones are deleted once they exceed the disk budget.
+class SolidModelCache {
+public:
+    static SolidModelCache &get();
+
+    static std::string make_key(const json &inputs);
+
+    std::shared_ptr<const SolidModel> find(const std::string &key);
+    void add(const std::string &key, std::shared_ptr<const SolidModel> model);
+    // called once the model has its full-quality mesh so that the file has it as well
+    void queue_write(const std::string &key, const SolidModelOcc &model);
+
+    void set_max_entries(size_t n);
+
+    struct Stats {
+        size_t hits = 0;
+        size_t disk_hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0;
+        size_t entries = 0;
+    };
+    Stats get_stats() const;
+
+private:
+    SolidModelCache();
+    ~SolidModelCache();
+
+    struct Entry {
+        std::shared_ptr<const SolidModel> model;
+        std::list<std::string>::iterator lru_it;
+    };
+    std::map<std::string, Entry> m_models;
+    std::list<std::string> m_lru; // most recently used first
+    void evict();
+
+    std::shared_ptr<const SolidModel> load_from_disk(const std::string &key) const;
+    static uintmax_t save_to_disk(const std::string &key, const TopoDS_Shape &shape, const TopoDS_Shape &shape_acc);
+    static void remove_from_disk(const std::string &key);
+    void scan_disk();
+
+    // models that have been written to disk, the size is in bytes
+    struct DiskEntry {
+        uintmax_t size;
+        std::list<std::string>::iterator lru_it;
+    };
+    std::map<std::string, DiskEntry> m_disk_entries;
+    std::list<std::string> m_disk_lru; // most recently used first
+    uintmax_t m_disk_used = 0;
+    static constexpr uintmax_t s_disk_budget = 1024 * 1024 * 1024;
+    void add_disk_entry(const std::string &key, uintmax_t size);
+    std::vector<std::string> evict_disk();
+
+    // OCC shares the faces a boolean operation didn't touch between the
+    // models of a body and meshing any of these models adds to them, so
+    // the worker writes copies that nothing else has access to
+    struct PendingWrite {
+        std::string key;
+        TopoDS_Shape shape;
+        TopoDS_Shape shape_acc;
+    };
+    std::deque<PendingWrite> m_pending_writes;
+    std::condition_variable m_cond;
+    bool m_stop = false;
+    std::thread m_thread;
+    void disk_writer();
+
+    size_t m_max_entries = 64;
+    Stats m_stats;
+    mutable std::mutex m_mutex;
+};
+
+} // namespace dune3d
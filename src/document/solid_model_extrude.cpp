@@ -1,7 +1,10 @@
 #include "solid_model.hpp"
 #include "solid_model_util.hpp"
 #include "solid_model_occ.hpp"
+#include "solid_model_cache.hpp"
 #include "group/group_extrude.hpp"
+#include "util/glm_util.hpp"
+#include "nlohmann/json.hpp"
 
 #include <BRepPrimAPI_MakePrism.hxx>
 
@@ -29,7 +32,21 @@ std::shared_ptr<const SolidModel> SolidModel::create(const Document &doc, GroupE
         break;
     }
 
+    const auto last_solid_model = dynamic_cast<const SolidModelOcc *>(get_last_solid_model(doc, group));
+
     try {
+        const json inputs = {
+                {"type", "extrude"},
+                {"source", FaceBuilder::get_inputs(doc, group.m_wrkpl, group.m_source_group)},
+                {"offset", offset},
+                {"dvec", dvec},
+                {"operation", static_cast<int>(group.m_operation)},
+                {"last", last_solid_model ? last_solid_model->m_cache_key : ""},
+        };
+        mod->m_cache_key = SolidModelCache::make_key(inputs);
+        if (auto cached = SolidModelCache::get().find(mod->m_cache_key))
+            return cached;
+
         auto face_builder = FaceBuilder::from_document(doc, group.m_wrkpl, group.m_source_group, offset);
 
         if (face_builder.get_n_faces() == 0) {
@@ -60,8 +77,6 @@ std::shared_ptr<const SolidModel> SolidModel::create(const Document &doc, GroupE
         return nullptr;
     }
 
-    const auto last_solid_model = dynamic_cast<const SolidModelOcc *>(get_last_solid_model(doc, group));
-
     if (last_solid_model) {
         mod->update_acc(group.m_operation, last_solid_model->m_shape_acc);
     }
@@ -69,9 +84,7 @@ std::shared_ptr<const SolidModel> SolidModel::create(const Document &doc, GroupE
         mod->m_shape_acc = mod->m_shape;
     }
 
-    mod->find_edges();
-
-    mod->triangulate();
+    SolidModelCache::get().add(mod->m_cache_key, mod);
 
     return mod;
 }
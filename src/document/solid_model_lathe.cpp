@@ -1,9 +1,12 @@
 #include "solid_model.hpp"
 #include "solid_model_util.hpp"
 #include "solid_model_occ.hpp"
+#include "solid_model_cache.hpp"
 #include "document.hpp"
 #include "entity/entity.hpp"
 #include "group/group_lathe.hpp"
+#include "util/glm_util.hpp"
+#include "nlohmann/json.hpp"
 #include <BRepPrimAPI_MakeRevol.hxx>
 
 namespace dune3d {
@@ -14,14 +17,9 @@ std::shared_ptr<const SolidModel> SolidModel::create(const Document &doc, GroupL
 
     glm::dvec3 offset = {0, 0, 0};
 
-    try {
-        auto face_builder = FaceBuilder::from_document(doc, group.m_wrkpl, group.m_source_group, offset);
-
-        if (face_builder.get_n_faces() == 0) {
-            group.m_sweep_messages.emplace_back(GroupStatusMessage::Status::ERR, "no faces");
-            return nullptr;
-        }
+    const auto last_solid_model = dynamic_cast<const SolidModelOcc *>(get_last_solid_model(doc, group));
 
+    try {
         auto origin = doc.get_entity(group.m_origin).get_point(group.m_origin_point, doc);
 
         glm::dvec3 dir;
@@ -33,6 +31,25 @@ std::shared_ptr<const SolidModel> SolidModel::create(const Document &doc, GroupL
             return nullptr;
         }
 
+        const json inputs = {
+                {"type", "lathe"},
+                {"source", FaceBuilder::get_inputs(doc, group.m_wrkpl, group.m_source_group)},
+                {"origin", origin},
+                {"dir", dir},
+                {"operation", static_cast<int>(group.m_operation)},
+                {"last", last_solid_model ? last_solid_model->m_cache_key : ""},
+        };
+        mod->m_cache_key = SolidModelCache::make_key(inputs);
+        if (auto cached = SolidModelCache::get().find(mod->m_cache_key))
+            return cached;
+
+        auto face_builder = FaceBuilder::from_document(doc, group.m_wrkpl, group.m_source_group, offset);
+
+        if (face_builder.get_n_faces() == 0) {
+            group.m_sweep_messages.emplace_back(GroupStatusMessage::Status::ERR, "no faces");
+            return nullptr;
+        }
+
         gp_Ax1 ax{gp_Pnt(origin.x, origin.y, origin.z), gp_Dir(dir.x, dir.y, dir.z)};
 
 
@@ -60,8 +77,6 @@ std::shared_ptr<const SolidModel> SolidModel::create(const Document &doc, GroupL
         return nullptr;
     }
 
-    const auto last_solid_model = dynamic_cast<const SolidModelOcc *>(get_last_solid_model(doc, group));
-
     if (last_solid_model) {
         mod->update_acc(group.m_operation, last_solid_model->m_shape_acc);
     }
@@ -69,9 +84,7 @@ std::shared_ptr<const SolidModel> SolidModel::create(const Document &doc, GroupL
         mod->m_shape_acc = mod->m_shape;
     }
 
-    mod->find_edges();
-
-    mod->triangulate();
+    SolidModelCache::get().add(mod->m_cache_key, mod);
 
     return mod;
 }
@@ -1,8 +1,10 @@
 #include "solid_model.hpp"
 #include "solid_model_occ.hpp"
+#include "solid_model_cache.hpp"
 #include "document.hpp"
 #include "group/group_fillet.hpp"
 #include "group/group_chamfer.hpp"
+#include "nlohmann/json.hpp"
 
 #include <BRepFilletAPI_MakeFillet.hxx>
 #include <BRepFilletAPI_MakeChamfer.hxx>
@@ -12,7 +14,8 @@
 namespace dune3d {
 
 template <typename T>
-std::shared_ptr<const SolidModel> create_local_operation(const Document &doc, GroupLocalOperation &group)
+std::shared_ptr<const SolidModel> create_local_operation(const Document &doc, GroupLocalOperation &group,
+                                                         const char *type)
 {
     group.m_local_operation_messages.clear();
     if (group.m_edges.size() == 0) {
@@ -34,6 +37,16 @@ std::shared_ptr<const SolidModel> create_local_operation(const Document &doc, Gr
         return nullptr;
     }
 
+    const json inputs = {
+            {"type", type},
+            {"edges", group.m_edges},
+            {"radius", group.m_radius},
+            {"last", last_solid_model->m_cache_key},
+    };
+    mod->m_cache_key = SolidModelCache::make_key(inputs);
+    if (auto cached = SolidModelCache::get().find(mod->m_cache_key))
+        return cached;
+
     try {
         T mf(last_solid_model->m_shape_acc);
         {
@@ -78,19 +91,19 @@ std::shared_ptr<const SolidModel> create_local_operation(const Document &doc, Gr
         return nullptr;
     }
 
-    mod->find_edges();
-    mod->triangulate();
+    SolidModelCache::get().add(mod->m_cache_key, mod);
+
     return mod;
 }
 
 std::shared_ptr<const SolidModel> SolidModel::create(const Document &doc, GroupFillet &group)
 {
-    return create_local_operation<BRepFilletAPI_MakeFillet>(doc, group);
+    return create_local_operation<BRepFilletAPI_MakeFillet>(doc, group, "fillet");
 }
 
 std::shared_ptr<const SolidModel> SolidModel::create(const Document &doc, GroupChamfer &group)
 {
-    return create_local_operation<BRepFilletAPI_MakeChamfer>(doc, group);
+    return create_local_operation<BRepFilletAPI_MakeChamfer>(doc, group, "chamfer");
 }
 
 } // namespace dune3d
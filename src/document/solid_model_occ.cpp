@@ -2,6 +2,7 @@
 #include "preferences/preferences.hpp"
 #include "canvas/color_palette.hpp"
 #include "util/fs_util.hpp"
+#include "solid_model_cache.hpp"
 
 #include <Quantity_Color.hxx>
 #include <TDocStd_Document.hxx>
@@ -38,6 +39,7 @@
 #include <gp_Circ.hxx>
 #include <glm/glm.hpp>
 #include <map>
+#include <list>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/rotate_vector.hpp>
@@ -60,6 +62,7 @@
 #include <BRepAlgoAPI_Cut.hxx>
 #include <BRepAlgoAPI_Fuse.hxx>
 #include <BRepAlgoAPI_Common.hxx>
+#include <BRepBuilderAPI_Copy.hxx>
 
 #include <cairomm/cairomm.h>
 
@@ -68,7 +71,7 @@ namespace dune3d {
 
 class Triangulator {
 public:
-    Triangulator(const TopoDS_Shape &shape, face::Faces &faces);
+    Triangulator(const TopoDS_Shape &shape, face::Faces &faces, bool coarse);
 
 
 private:
@@ -86,9 +89,19 @@ private:
 
     face::Faces &m_faces;
     face::Color m_default_color;
+    const double m_prec;
+    const double m_angle;
 };
 
-Triangulator::Triangulator(const TopoDS_Shape &shape, face::Faces &faces) : m_faces(faces)
+#define USER_PREC (0.14)
+#define USER_ANGLE (0.52359878)
+
+// for previews while scrubbing parameters
+#define USER_PREC_COARSE (1.0)
+#define USER_ANGLE_COARSE (1.0471976)
+
+Triangulator::Triangulator(const TopoDS_Shape &shape, face::Faces &faces, bool coarse)
+    : m_faces(faces), m_prec(coarse ? USER_PREC_COARSE : USER_PREC), m_angle(coarse ? USER_ANGLE_COARSE : USER_ANGLE)
 {
     {
         auto color = Preferences::get().canvas.appearance.get_color(ColorP::SOLID_MODEL);
@@ -103,9 +116,6 @@ Triangulator::Triangulator(const TopoDS_Shape &shape, face::Faces &faces) : m_fa
 #define HORIZON_NEW_OCC
 #endif
 
-#define USER_PREC (0.14)
-#define USER_ANGLE (0.52359878)
-
 static glm::dmat4 update_matrix(const gp_Trsf &tr, const glm::dmat4 &mat_in)
 {
     gp_XYZ coord = tr.TranslationPart();
@@ -136,11 +146,11 @@ bool Triangulator::processFace(const TopoDS_Face &face, Quantity_Color *color, c
     Standard_Boolean isTessellate(Standard_False);
     Handle(Poly_Triangulation) triangulation = BRep_Tool::Triangulation(face, loc);
 
-    if (triangulation.IsNull() || triangulation->Deflection() > USER_PREC + Precision::Confusion())
+    if (triangulation.IsNull() || triangulation->Deflection() > m_prec + Precision::Confusion())
         isTessellate = Standard_True;
 
     if (isTessellate) {
-        BRepMesh_IncrementalMesh IM(face, USER_PREC, Standard_False, USER_ANGLE);
+        BRepMesh_IncrementalMesh IM(face, m_prec, Standard_False, m_angle);
         triangulation = BRep_Tool::Triangulation(face, loc);
     }
 
@@ -381,10 +391,11 @@ bool Triangulator::processNode(const TopoDS_Shape &shape)
 }
 
 
-void SolidModelOcc::triangulate()
+face::Faces SolidModelOcc::triangulate(bool coarse) const
 {
-    m_faces.clear();
-    Triangulator tri{m_shape_acc, m_faces};
+    face::Faces faces;
+    Triangulator tri{m_shape_acc, faces, coarse};
+    return faces;
 }
 
 inline double defaultAngularDeflection(double linearTolerance)
@@ -556,9 +567,9 @@ void SolidModelOcc::export_projection(const std::filesystem::path &path, const g
     }
 }
 
-void SolidModelOcc::find_edges()
+SolidModel::Edges SolidModelOcc::find_edges() const
 {
-    m_edges.clear();
+    Edges edges_out;
     TopExp_Explorer topex(m_shape_acc, TopAbs_EDGE);
     std::list<TopoDS_Shape> edges;
     unsigned int edge_idx = 0;
@@ -580,7 +591,7 @@ void SolidModelOcc::find_edges()
         {
             auto curve = BRepAdaptor_Curve(edge);
             GCPnts_TangentialDeflection discretizer(curve, M_PI / 16, 1e3);
-            auto &e = m_edges[edge_idx];
+            auto &e = edges_out[edge_idx];
             if (discretizer.NbPoints() > 0) {
                 int nbPoints = discretizer.NbPoints();
                 for (int i = 1; i <= nbPoints; i++) {
@@ -592,6 +603,7 @@ void SolidModelOcc::find_edges()
         topex.Next();
         edge_idx++;
     }
+    return edges_out;
 }
 
 void SolidModelOcc::update_acc(IGroupSolidModel::Operation op, const TopoDS_Shape &last)
@@ -609,4 +621,163 @@ void SolidModelOcc::update_acc(IGroupSolidModel::Operation op, const TopoDS_Shap
     }
 }
 
+// keeps track of the meshes of all solid models and drops the least
+// recently used ones once they take up more memory than the budget
+class MeshBudget {
+public:
+    static MeshBudget &get()
+    {
+        static MeshBudget instance;
+        return instance;
+    }
+
+    void touch(const SolidModelOcc &model, size_t size)
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        if (auto it = m_models.find(&model); it != m_models.end()) {
+            m_used -= it->second.size;
+            m_lru.erase(it->second.lru_it);
+            m_models.erase(it);
+        }
+        m_lru.push_front(&model);
+        m_models.emplace(&model, Entry{size, m_lru.begin()});
+        m_used += size;
+
+        // the model just used stays at the front
+        while (m_used > s_budget && m_lru.size() > 1) {
+            auto victim = m_lru.back();
+            m_used -= m_models.at(victim).size;
+            m_models.erase(victim);
+            m_lru.pop_back();
+            victim->drop_mesh();
+        }
+    }
+
+    void remove(const SolidModelOcc &model)
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        if (auto it = m_models.find(&model); it != m_models.end()) {
+            m_used -= it->second.size;
+            m_lru.erase(it->second.lru_it);
+            m_models.erase(it);
+        }
+    }
+
+private:
+    struct Entry {
+        size_t size;
+        std::list<const SolidModelOcc *>::iterator lru_it;
+    };
+    std::map<const SolidModelOcc *, Entry> m_models;
+    std::list<const SolidModelOcc *> m_lru; // most recently used first
+    size_t m_used = 0;
+    static constexpr size_t s_budget = 256 * 1024 * 1024;
+    std::mutex m_mutex;
+};
+
+static size_t get_memory_size(const face::Faces &faces)
+{
+    size_t sz = 0;
+    for (const auto &face : faces) {
+        sz += sizeof(face);
+        sz += (face.vertices.capacity() + face.normals.capacity()) * sizeof(face::Vertex);
+        sz += face.triangle_indices.capacity() * sizeof(face.triangle_indices.front());
+    }
+    return sz;
+}
+
+static size_t get_memory_size(const SolidModel::Edges &edges)
+{
+    size_t sz = 0;
+    for (const auto &[idx, path] : edges) {
+        sz += sizeof(idx) + sizeof(path);
+        sz += path.capacity() * sizeof(glm::dvec3);
+    }
+    return sz;
+}
+
+std::shared_ptr<const face::Faces> SolidModelOcc::get_faces() const
+{
+    std::shared_ptr<const face::Faces> faces;
+    size_t size = 0;
+    {
+        std::lock_guard<std::mutex> guard(m_mesh_mutex);
+        if (!m_faces) {
+            m_faces = std::make_shared<const face::Faces>(triangulate(m_preview));
+            if (!m_preview && m_cache_key.size())
+                SolidModelCache::get().queue_write(m_cache_key, *this);
+        }
+        faces = m_faces;
+        size = get_mesh_memory_size();
+    }
+    MeshBudget::get().touch(*this, size);
+    return faces;
+}
+
+std::shared_ptr<const face::Faces> SolidModelOcc::get_faces_coarse() const
+{
+    // previews only get a coarse mesh to begin with
+    if (m_preview)
+        return get_faces();
+
+    std::shared_ptr<const face::Faces> faces;
+    size_t size = 0;
+    {
+        std::lock_guard<std::mutex> guard(m_mesh_mutex);
+        if (!m_faces_coarse) {
+            // meshing stores the triangulation in the shape, so mesh a copy
+            // without it to leave the full quality one alone
+            const auto shape = BRepBuilderAPI_Copy(m_shape_acc, true, false).Shape();
+            auto coarse_faces = std::make_shared<face::Faces>();
+            Triangulator tri{shape, *coarse_faces, true};
+            m_faces_coarse = coarse_faces;
+        }
+        faces = m_faces_coarse;
+        size = get_mesh_memory_size();
+    }
+    MeshBudget::get().touch(*this, size);
+    return faces;
+}
+
+std::shared_ptr<const SolidModel::Edges> SolidModelOcc::get_edges() const
+{
+    std::shared_ptr<const Edges> edges;
+    size_t size = 0;
+    {
+        std::lock_guard<std::mutex> guard(m_mesh_mutex);
+        if (!m_edges)
+            m_edges = std::make_shared<const Edges>(find_edges());
+        edges = m_edges;
+        size = get_mesh_memory_size();
+    }
+    MeshBudget::get().touch(*this, size);
+    return edges;
+}
+
+void SolidModelOcc::drop_mesh() const
+{
+    std::lock_guard<std::mutex> guard(m_mesh_mutex);
+    m_faces.reset();
+    m_faces_coarse.reset();
+    m_edges.reset();
+}
+
+// m_mesh_mutex must be held
+size_t SolidModelOcc::get_mesh_memory_size() const
+{
+    size_t size = 0;
+    if (m_faces)
+        size += get_memory_size(*m_faces);
+    if (m_faces_coarse)
+        size += get_memory_size(*m_faces_coarse);
+    if (m_edges)
+        size += get_memory_size(*m_edges);
+    return size;
+}
+
+SolidModelOcc::~SolidModelOcc()
+{
+    MeshBudget::get().remove(*this);
+}
+
 } // namespace dune3d
@@ -1,6 +1,7 @@
 #include "solid_model.hpp"
 #include "group/igroup_solid_model.hpp"
 #include <TopoDS.hxx>
+#include <mutex>
 
 namespace dune3d {
 
@@ -9,8 +10,9 @@ public:
     TopoDS_Shape m_shape;
     TopoDS_Shape m_shape_acc;
 
-    void triangulate();
-    void find_edges();
+    std::shared_ptr<const face::Faces> get_faces() const override;
+    std::shared_ptr<const face::Faces> get_faces_coarse() const override;
+    std::shared_ptr<const Edges> get_edges() const override;
 
     void export_stl(const std::filesystem::path &path) const override;
     void export_step(const std::filesystem::path &path) const override;
@@ -18,6 +20,21 @@ public:
                            const glm::dquat &normal) const override;
 
     void update_acc(IGroupSolidModel::Operation op, const TopoDS_Shape &last);
+
+    ~SolidModelOcc();
+
+private:
+    face::Faces triangulate(bool coarse) const;
+    Edges find_edges() const;
+
+    friend class MeshBudget;
+    void drop_mesh() const;
+    size_t get_mesh_memory_size() const;
+
+    mutable std::mutex m_mesh_mutex;
+    mutable std::shared_ptr<const face::Faces> m_faces;
+    mutable std::shared_ptr<const face::Faces> m_faces_coarse;
+    mutable std::shared_ptr<const Edges> m_edges;
 };
 
 } // namespace dune3d
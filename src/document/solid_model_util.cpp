@@ -5,6 +5,8 @@
 #include "entity/entity_circle2d.hpp"
 #include "entity/entity_workplane.hpp"
 #include "document.hpp"
+#include "group/group_array.hpp"
+#include "nlohmann/json.hpp"
 #include <BRepBuilderAPI_MakeFace.hxx>
 #include <BRepBuilderAPI_MakeWire.hxx>
 #include <BRepBuilderAPI_MakeEdge.hxx>
@@ -431,22 +433,71 @@ FaceBuilder FaceBuilder::from_document(const Document &doc, const UUID &wrkpl_uu
     return face_builder;
 }
 
-Paths Paths::from_document(const Document &doc, const UUID &wrkpl_uu, const UUID &source_group_uu)
+nlohmann::json FaceBuilder::get_inputs(const Document &doc, const UUID &wrkpl_uu, const UUID &source_group_uu)
 {
-    Paths paths;
+    auto j = nlohmann::json::object();
+    j[wrkpl_uu] = doc.get_entity(wrkpl_uu).serialize();
     for (const auto &[uu, en] : doc.m_entities) {
         if (en->m_group != source_group_uu)
             continue;
+        if (en->m_construction)
+            continue;
+        if (auto en_wrkpl = dynamic_cast<const IEntityInWorkplane *>(en.get())) {
+            if (en_wrkpl->get_workplane() != wrkpl_uu)
+                continue;
+            j[uu] = en->serialize();
+        }
+    }
+    // most instances aren't entities, so they're covered by the array and its source
+    if (auto it = doc.get_groups().find(source_group_uu); it != doc.get_groups().end()) {
+        if (auto group_array = dynamic_cast<const GroupArray *>(it->second.get())) {
+            auto &j_array = j["array"];
+            j_array = get_inputs(doc, wrkpl_uu, group_array->m_source_group);
+            j_array["group"] = group_array->serialize();
+        }
+    }
+    return j;
+}
+
+Paths Paths::from_document(const Document &doc, const UUID &wrkpl_uu, const UUID &source_group_uu)
+{
+    Paths paths;
+    std::vector<const Entity *> entities;
+    for (const auto &[uu, en] : doc.m_entities) {
+        if (en->m_group == source_group_uu)
+            entities.push_back(en.get());
+    }
+    if (auto it = doc.get_groups().find(source_group_uu); it != doc.get_groups().end()) {
+        if (auto group_array = dynamic_cast<const GroupArray *>(it->second.get())) {
+            // only the ones in a workplane can end up in a path
+            group_array->for_each_virtual_instance(doc, [&paths, &entities](const Entity &en) {
+                switch (en.get_type()) {
+                case Entity::Type::LINE_2D:
+                    entities.push_back(&paths.virtual_lines.emplace_back(entity_cast<EntityLine2D>(en)));
+                    break;
+                case Entity::Type::ARC_2D:
+                    entities.push_back(&paths.virtual_arcs.emplace_back(entity_cast<EntityArc2D>(en)));
+                    break;
+                case Entity::Type::CIRCLE_2D:
+                    entities.push_back(&paths.virtual_circles.emplace_back(entity_cast<EntityCircle2D>(en)));
+                    break;
+                default:;
+                }
+            });
+        }
+    }
+
+    for (const auto en : entities) {
         if (en->m_construction)
             continue;
         if (en->get_type() == Entity::Type::CIRCLE_2D)
             continue;
         if (en->get_type() == Entity::Type::POINT_2D)
             continue;
-        if (auto en_wrkpl = dynamic_cast<const IEntityInWorkplane *>(en.get())) {
+        if (auto en_wrkpl = dynamic_cast<const IEntityInWorkplane *>(en)) {
             if (en_wrkpl->get_workplane() != wrkpl_uu)
                 continue;
-            if (auto en_line = dynamic_cast<const EntityLine2D *>(en.get()))
+            if (auto en_line = dynamic_cast<const EntityLine2D *>(en))
                 if (glm::length(en_line->m_p1 - en_line->m_p2) < 1e-6)
                     continue;
             paths.edges.emplace_back(paths.nodes, *en);
@@ -505,9 +556,7 @@ Paths Paths::from_document(const Document &doc, const UUID &wrkpl_uu, const UUID
     }
 
     // add circles
-    for (const auto &[uu, en] : doc.m_entities) {
-        if (en->m_group != source_group_uu)
-            continue;
+    for (const auto en : entities) {
         if (en->m_construction)
             continue;
         if (en->get_type() != Entity::Type::CIRCLE_2D)
@@ -3,7 +3,13 @@
 #include <deque>
 #include <set>
 #include <list>
+#include <memory>
+#include <vector>
 #include "clipper2/clipper.h"
+#include "nlohmann/json_fwd.hpp"
+#include "entity/entity_line2d.hpp"
+#include "entity/entity_arc2d.hpp"
+#include "entity/entity_circle2d.hpp"
 #include <TopoDS_Builder.hxx>
 
 
@@ -12,7 +18,6 @@ namespace dune3d {
 class UUID;
 class Document;
 class EntityWorkplane;
-class EntityCircle2D;
 class Entity;
 namespace solid_model_util {
 
@@ -49,6 +54,10 @@ public:
 private:
     std::list<Node> nodes;
     std::list<Edge> edges;
+    // array instances that aren't entities of the document
+    std::deque<EntityLine2D> virtual_lines;
+    std::deque<EntityArc2D> virtual_arcs;
+    std::deque<EntityCircle2D> virtual_circles;
 };
 
 
@@ -57,6 +66,9 @@ public:
     static FaceBuilder from_document(const Document &doc, const UUID &wrkpl_uu, const UUID &source_group_uu,
                                      const glm::dvec3 &offset);
 
+    // the entities from_document builds the faces from, for use in cache keys
+    static nlohmann::json get_inputs(const Document &doc, const UUID &wrkpl_uu, const UUID &source_group_uu);
+
     const TopoDS_Compound &get_faces() const;
     unsigned int get_n_faces() const;
 
@@ -22,12 +22,16 @@
 #include "document/constraint/constraint.hpp"
 #include "util/fs_util.hpp"
 #include "util/key_util.hpp"
+#include "util/stopwatch.hpp"
 #include "util/util.hpp"
 #include "selection_editor.hpp"
 #include "preferences/color_presets.hpp"
 #include "workspace_browser.hpp"
 #include "document/solid_model_util.hpp"
+#include "document/solid_model_cache.hpp"
+#include "import_step/step_import_manager.hpp"
 #include "document/export_paths.hpp"
+#include "document/document_binary.hpp"
 #include "document/constraint/iconstraint_datum.hpp"
 #include "document/constraint/iconstraint_workplane.hpp"
 #include "document/constraint/constraint_points_coincident.hpp"
@@ -36,6 +40,7 @@
 #include "system/system.hpp"
 #include <iostream>
 #include <format>
+#include <algorithm>
 
 namespace dune3d {
 Editor::Editor(Dune3DAppWindow &win, Preferences &prefs)
@@ -48,6 +53,11 @@ Editor::~Editor() = default;
 
 void Editor::init()
 {
+    // array instances only become entities once they're needed, this has to
+    // happen before anyone else looks at the selection
+    get_canvas().signal_selection_changed().connect([this] { materialize_entities(); });
+    get_canvas().signal_hover_selection_changed().connect([this] { materialize_entities(); });
+
     init_workspace_browser();
     init_properties_notebook();
     init_header_bar();
@@ -55,7 +65,16 @@ void Editor::init()
     init_tool_popover();
     init_canvas();
 
-    m_core.signal_needs_save().connect([this] { update_action_sensitivity(); });
+    m_core.signal_needs_save().connect([this] {
+        update_action_sensitivity();
+        m_win.get_save_button().set_label(m_core.is_saving() ? "Saving…" : "Save");
+    });
+    Glib::signal_timeout().connect_seconds(
+            [this] {
+                m_core.autosave();
+                return true;
+            },
+            60);
     get_canvas().signal_selection_changed().connect([this] { update_action_sensitivity(); });
 
     m_win.signal_close_request().connect(
@@ -539,6 +558,24 @@ void Editor::init_properties_notebook()
     get_canvas().signal_selection_changed().connect(sigc::mem_fun(*this, &Editor::update_selection_editor));
 }
 
+void Editor::materialize_entities()
+{
+    if (!m_core.has_documents())
+        return;
+    auto sel = get_canvas().get_selection();
+    if (auto hsel = get_canvas().get_hover_selection())
+        sel.insert(*hsel);
+    std::set<UUID> entities;
+    for (const auto &sr : sel) {
+        if (sr.is_entity())
+            entities.insert(sr.item);
+    }
+    // instances that aren't hovered or selected anymore are dropped the next
+    // time their group gets generated
+    if (m_core.get_current_document().materialize_entities(entities))
+        canvas_update_keep_selection();
+}
+
 void Editor::update_selection_editor()
 {
     if (get_canvas().get_selection_mode() == SelectionMode::HOVER)
@@ -597,8 +634,15 @@ static const std::set<ActionID> move_group_actions = {
 
 void Editor::init_actions()
 {
-    connect_action(ActionID::SAVE_ALL, [this](auto &a) { m_core.save_all(); });
+    connect_action(ActionID::SAVE_ALL, [this](auto &a) {
+        // saving writes the last committed state
+        if (m_delayed_commit_connection.connected())
+            commit_from_group_editor();
+        m_core.save_all();
+    });
     connect_action(ActionID::SAVE, [this](auto &a) {
+        if (m_delayed_commit_connection.connected())
+            commit_from_group_editor();
         if (m_core.get_current_idocument_info().has_path()) {
             m_core.save();
             update_version_info();
@@ -753,6 +797,10 @@ void Editor::init_actions()
             if (en->m_group == group)
                 sel.emplace(SelectableRef::Type::ENTITY, uu, 0);
         }
+        if (auto group_array = dynamic_cast<const GroupArray *>(&doc.get_group(group))) {
+            group_array->for_each_virtual_instance(
+                    doc, [&sel](const Entity &en) { sel.emplace(SelectableRef::Type::ENTITY, en.m_uuid, 0); });
+        }
         get_canvas().set_selection(sel, true);
         get_canvas().set_selection_mode(SelectionMode::NORMAL);
         return;
@@ -995,6 +1043,7 @@ void Editor::on_open_document(const ActionConnection &conn)
     auto filter_any = Gtk::FileFilter::create();
     filter_any->set_name("Dune 3D documents");
     filter_any->add_pattern("*.d3ddoc");
+    filter_any->add_pattern("*.d3dbin");
     filters->append(filter_any);
 
     dialog->set_filters(filters);
@@ -1055,6 +1104,11 @@ void Editor::on_save_as(const ActionConnection &conn)
     filter_any->add_pattern("*.d3ddoc");
     filters->append(filter_any);
 
+    auto filter_binary = Gtk::FileFilter::create();
+    filter_binary->set_name("Dune 3D documents (binary)");
+    filter_binary->add_pattern("*.d3dbin");
+    filters->append(filter_binary);
+
     dialog->set_filters(filters);
 
     // Show the dialog and wait for a user response:
@@ -1063,9 +1117,13 @@ void Editor::on_save_as(const ActionConnection &conn)
             auto file = dialog->save_finish(result);
             // open_file_view(file);
             //  Notice that this is a std::string, not a Glib::ustring.
-            auto filename = path_from_string(append_suffix_if_required(file->get_path(), ".d3ddoc"));
+            auto filename = path_from_string(file->get_path());
+            if (!BinaryDocument::has_binary_suffix(filename))
+                filename = path_from_string(append_suffix_if_required(file->get_path(), ".d3ddoc"));
             // std::cout << "File selected: " << filename << std::endl;
             m_win.get_app().add_recent_item(filename);
+            if (m_delayed_commit_connection.connected())
+                commit_from_group_editor();
             m_core.save_as(filename);
             m_workspace_browser->update_documents(m_document_view);
             update_version_info();
@@ -1185,7 +1243,21 @@ void Editor::update_group_editor()
     m_group_editor = GroupEditor::create(m_core, m_core.get_current_group());
     m_group_editor->signal_changed().connect([this](GroupEditor::CommitMode mode) {
         if (mode == GroupEditor::CommitMode::DELAYED) {
-            m_core.get_current_document().update_pending(m_core.get_current_group());
+            // changes coming in faster than we can rebuild get folded into
+            // the next preview rather than queueing up a rebuild each
+            if (!m_preview_connection.connected()) {
+                m_preview_connection = Glib::signal_timeout().connect(
+                        [this] {
+                            {
+                                SolidModel::PreviewScope preview;
+                                m_core.get_current_document().update_pending(m_core.get_current_group());
+                            }
+                            m_has_preview = true;
+                            canvas_update_keep_selection();
+                            return false;
+                        },
+                        50);
+            }
             m_delayed_commit_connection.disconnect(); // stop old timer
             m_delayed_commit_connection = Glib::signal_timeout().connect(
                     [this] {
@@ -1200,7 +1272,8 @@ void Editor::update_group_editor()
             commit_from_group_editor();
         }
         m_core.set_needs_save();
-        canvas_update_keep_selection();
+        if (mode != GroupEditor::CommitMode::DELAYED)
+            canvas_update_keep_selection();
     });
     m_group_editor->signal_trigger_action().connect([this](auto act) { trigger_action(act); });
     m_group_editor_box->append(*m_group_editor);
@@ -1209,6 +1282,12 @@ void Editor::update_group_editor()
 void Editor::commit_from_group_editor()
 {
     m_delayed_commit_connection.disconnect();
+    m_preview_connection.disconnect();
+    if (m_has_preview) {
+        // replaces the preview solid model with a full-quality one
+        m_core.get_current_document().set_group_update_solid_model_pending(m_core.get_current_group());
+        m_has_preview = false;
+    }
     m_commit_pending_revealer->set_reveal_child(false);
     m_core.rebuild("group edited");
 }
@@ -1380,6 +1459,9 @@ void Editor::apply_preferences()
     get_canvas().set_enable_animations(m_preferences.canvas.enable_animations);
     get_canvas().set_zoom_to_cursor(m_preferences.canvas.zoom_to_cursor);
     get_canvas().set_rotation_scheme(m_preferences.canvas.rotation_scheme);
+    get_canvas().set_primitive_mode(m_preferences.canvas.primitive_mode);
+    get_canvas().set_adaptive_quality(m_preferences.canvas.adaptive_quality, m_preferences.canvas.frame_time_target);
+    get_canvas().set_show_stats_overlay(m_preferences.canvas.stats_overlay);
 
     m_win.tool_bar_set_vertical(m_preferences.tool_bar.vertical_layout);
     update_action_bar_visibility();
@@ -1506,22 +1588,72 @@ void Editor::update_error_overlay()
 void Editor::canvas_update()
 {
     auto docs = m_core.get_documents();
+    // the overlay has to come last, so render the current document after the other ones
+    if (m_core.has_documents()) {
+        const auto current_uu = m_core.get_current_idocument_info().get_uuid();
+        std::ranges::stable_partition(docs, [&current_uu](auto doc) { return doc->get_uuid() != current_uu; });
+    }
+    m_overlay_entities = m_core.get_tool_overlay_entities();
     auto hover_sel = get_canvas().get_hover_selection();
     get_canvas().clear();
+    const Stopwatch stopwatch;
     for (const auto doc : docs) {
         Renderer renderer(get_canvas());
         renderer.m_solid_model_edge_select_mode = m_solid_model_edge_select_mode;
 
-        if (doc->get_uuid() == m_core.get_current_idocument_info().get_uuid())
+        if (doc->get_uuid() == m_core.get_current_idocument_info().get_uuid()) {
             renderer.add_constraint_icons(m_constraint_tip_pos, m_constraint_tip_vec, m_constraint_tip_icons);
+            renderer.m_overlay_entities = m_overlay_entities;
+        }
 
         renderer.render(doc->get_document(), doc->get_current_group(), m_document_view);
     }
+    get_canvas().set_stats_timing("Renderer", stopwatch.get_ms());
+    if (m_core.has_documents())
+        get_canvas().set_stats_timing("Update", m_core.get_current_document().get_last_update_duration());
+    {
+        const auto stats = SolidModelCache::get().get_stats();
+        get_canvas().set_stats_cache("Solid model",
+                                     {.hits = stats.hits + stats.disk_hits,
+                                      .misses = stats.misses,
+                                      .evictions = stats.evictions});
+    }
+    {
+        const auto stats = STEPImportManager::get().get_stats();
+        get_canvas().set_stats_cache("STEP",
+                                     {.hits = stats.hits, .misses = stats.misses, .evictions = stats.evictions});
+    }
     get_canvas().set_hover_selection(hover_sel);
     update_error_overlay();
     get_canvas().request_push();
 }
 
+bool Editor::can_update_overlay_only() const
+{
+    if (!m_core.tool_is_active() || !get_canvas().has_overlay())
+        return false;
+    // the tool has changed more than what's in the overlay
+    if (m_overlay_entities.empty() || m_core.get_tool_overlay_entities() != m_overlay_entities)
+        return false;
+    return true;
+}
+
+void Editor::canvas_update_overlay()
+{
+    auto &doc = m_core.get_current_idocument_info();
+    auto hover_sel = get_canvas().get_hover_selection();
+    get_canvas().clear_overlay();
+    const Stopwatch stopwatch;
+    {
+        Renderer renderer(get_canvas());
+        renderer.m_overlay_entities = m_overlay_entities;
+        renderer.add_constraint_icons(m_constraint_tip_pos, m_constraint_tip_vec, m_constraint_tip_icons);
+        renderer.render_overlay(doc.get_document(), doc.get_current_group(), m_document_view);
+    }
+    get_canvas().set_stats_timing("Renderer", stopwatch.get_ms());
+    get_canvas().set_hover_selection(hover_sel);
+}
+
 void Editor::canvas_update_keep_selection()
 {
     auto sel = get_canvas().get_selection();
@@ -1576,6 +1708,7 @@ std::optional<SelectableRef> Editor::get_hover_selection() const
 void Editor::tool_process(ToolResponse &resp)
 {
     tool_process_one();
+    m_tool_moved = false;
     while (auto args = m_core.get_pending_tool_args()) {
         m_core.tool_update(*args);
 
@@ -1605,8 +1738,12 @@ void Editor::tool_process_one()
         update_selection_editor();
         update_action_bar_buttons_sensitivity(); // due to workplane change
     }
-    if (!m_no_canvas_update)
-        canvas_update();
+    if (!m_no_canvas_update) {
+        if (m_tool_moved && can_update_overlay_only())
+            canvas_update_overlay();
+        else
+            canvas_update();
+    }
     get_canvas().set_selection(m_core.get_tool_selection(), false);
     if (!m_core.tool_is_active())
         get_canvas().set_selection_mode(m_last_selection_mode);
@@ -1646,6 +1783,7 @@ void Editor::handle_cursor_move()
         ToolArgs args;
         args.type = ToolEventType::MOVE;
         ToolResponse r = m_core.tool_update(args);
+        m_tool_moved = true;
         tool_process(r);
     }
     else {
@@ -103,6 +103,11 @@ private:
 
     void canvas_update();
     void canvas_update_keep_selection();
+    // only redraws the tool's overlay entities and the constraint icons
+    void canvas_update_overlay();
+    bool can_update_overlay_only() const;
+    std::set<UUID> m_overlay_entities;
+    bool m_tool_moved = false;
 
     void tool_begin(ToolID id);
     void tool_process(ToolResponse &resp);
@@ -180,12 +185,16 @@ private:
     GroupEditor *m_group_editor = nullptr;
     void update_group_editor();
     sigc::connection m_delayed_commit_connection;
+    sigc::connection m_preview_connection;
+    bool m_has_preview = false;
     void commit_from_group_editor();
 
 
     SelectionEditor *m_selection_editor = nullptr;
     void update_selection_editor();
 
+    void materialize_entities();
+
     Dialogs m_dialogs;
     Dialogs &get_dialogs() override
     {
@@ -403,6 +403,7 @@ GroupEditor::GroupEditor(Core &core, const UUID &group_uu) : m_core(core), m_gro
             group.m_body.emplace();
         else
             group.m_body.reset();
+        m_core.get_current_document().update_groups_sorted();
         m_body_entry->set_sensitive(group.m_body.has_value());
         m_core.get_current_document().set_group_update_solid_model_pending(group.m_uuid);
         m_signal_changed.emit(CommitMode::IMMEDIATE);
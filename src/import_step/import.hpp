@@ -5,6 +5,7 @@
 #include <vector>
 #include <tuple>
 #include <filesystem>
+#include <glm/glm.hpp>
 
 namespace dune3d::STEPImporter {
 using namespace dune3d::face;
@@ -15,6 +16,15 @@ class Result {
 public:
     Faces faces;
     std::deque<Point> points;
+
+    // solids that occur more than once, such as identical screws in an
+    // assembly, are only tessellated once and placed by their instances
+    class Prototype {
+    public:
+        Faces faces;
+        std::vector<glm::mat4> instances;
+    };
+    std::vector<Prototype> prototypes;
 };
 
 Result import(const std::filesystem::path &filename);
@@ -1,10 +1,12 @@
 #include "step_import_manager.hpp"
 #include "import.hpp"
+#include "canvas/face_json.hpp"
 #include "nlohmann/json.hpp"
 #include "util/util.hpp"
 #include <glibmm.h>
 #include <giomm.h>
 #include "util/fs_util.hpp"
+#include <algorithm>
 
 namespace dune3d {
 
@@ -22,9 +24,27 @@ static void create_cache_dir()
         Gio::File::create_for_path(path_to_string(cache_dir))->make_directory_with_parents();
 }
 
+static std::filesystem::path get_hash_index_path()
+{
+    return get_cache_dir() / "index.json";
+}
+
 STEPImportManager::STEPImportManager()
 {
     create_cache_dir();
+    load_hash_index();
+}
+
+STEPImportManager::~STEPImportManager()
+{
+    // changes since the last periodic save
+    if (m_hash_index_modified) {
+        try {
+            save_hash_index();
+        }
+        catch (...) {
+        }
+    }
 }
 
 STEPImportManager &STEPImportManager::get()
@@ -50,86 +70,207 @@ static auto hash_file(const std::filesystem::path &path)
     return dig;
 }
 
-namespace face {
-template <typename T> void to_json(json &j, const TVertex<T> &r)
+namespace STEPImporter {
+
+static void to_json(json &j, const Result::Prototype &p)
 {
-    j = json::array();
-    j.push_back(r.x);
-    j.push_back(r.y);
-    j.push_back(r.z);
+    auto instances = json::array();
+    for (const auto &mat : p.instances) {
+        auto m = json::array();
+        for (int col = 0; col < 4; col++) {
+            for (int row = 0; row < 4; row++)
+                m.push_back(mat[col][row]);
+        }
+        instances.push_back(m);
+    }
+    j = {{"faces", p.faces}, {"instances", instances}};
 }
 
+static void from_json(const json &j, Result::Prototype &p)
+{
+    j.at("faces").get_to(p.faces);
+    for (const auto &m : j.at("instances")) {
+        auto &mat = p.instances.emplace_back();
+        for (int col = 0; col < 4; col++) {
+            for (int row = 0; row < 4; row++)
+                m.at(col * 4 + row).get_to(mat[col][row]);
+        }
+    }
+}
+
+static void to_json(json &j, const Result &r)
+{
+    j = {{"faces", r.faces}, {"points", r.points}, {"prototypes", r.prototypes}};
+}
 
-template <typename T> void from_json(const json &j, TVertex<T> &r)
+static void from_json(const json &j, Result &r)
 {
-    j.at(0).get_to(r.x);
-    j.at(1).get_to(r.y);
-    j.at(2).get_to(r.z);
+
+    j.at("points").get_to(r.points);
+    j.at("faces").get_to(r.faces);
+    if (j.contains("prototypes"))
+        j.at("prototypes").get_to(r.prototypes);
 }
 
+} // namespace STEPImporter
+
 
-void to_json(json &j, const Color &c)
+STEPImportManager::FileInfo STEPImportManager::get_file_info(const std::filesystem::path &path)
 {
-    j = json::array();
-    j.push_back(c.r);
-    j.push_back(c.g);
-    j.push_back(c.b);
+    FileInfo info;
+    std::error_code ec;
+    info.size = fs::file_size(path, ec);
+    if (ec)
+        return {};
+    info.mtime = fs::last_write_time(path, ec).time_since_epoch().count();
+    if (ec)
+        return {};
+    return info;
 }
 
-void from_json(const json &j, Color &c)
+void STEPImportManager::load_hash_index()
 {
-    j.at(0).get_to(c.r);
-    j.at(1).get_to(c.g);
-    j.at(2).get_to(c.b);
+    const auto index_path = get_hash_index_path();
+    if (!fs::exists(index_path))
+        return;
+    try {
+        const auto j = load_json_from_file(index_path);
+        for (const auto &it : j) {
+            const auto path = it.at("path").get<std::filesystem::path>();
+            // no point in remembering files that are gone
+            if (!fs::exists(path)) {
+                m_hash_index_modified = true;
+                continue;
+            }
+            HashIndexItem item;
+            item.info.size = it.at("size").get<uintmax_t>();
+            item.info.mtime = it.at("mtime").get<int64_t>();
+            item.hash = it.at("hash").get<std::string>();
+            item.last_used = it.value("last_used", int64_t{0});
+            m_hash_index.emplace(path, item);
+        }
+    }
+    catch (...) {
+        // a broken index only costs us rehashing
+        m_hash_index.clear();
+    }
 }
 
-void to_json(json &j, const Face &f)
+void STEPImportManager::save_hash_index() const
 {
-    j = {{"color", f.color},
-         {"vertices", f.vertices},
-         {"normals", f.normals},
-         {"triangle_indices", f.triangle_indices}};
+    json j = json::array();
+    for (const auto &[path, item] : m_hash_index) {
+        j.push_back({{"path", path},
+                     {"size", item.info.size},
+                     {"mtime", item.info.mtime},
+                     {"hash", item.hash},
+                     {"last_used", item.last_used}});
+    }
+    save_json_to_file(get_hash_index_path(), j);
 }
 
-void from_json(const json &j, Face &f)
+// every lookup updates the index, so it's only written every so often
+void STEPImportManager::save_hash_index_if_due(int64_t now)
 {
-    j.at("color").get_to(f.color);
-    j.at("vertices").get_to(f.vertices);
-    j.at("normals").get_to(f.normals);
-    j.at("triangle_indices").get_to(f.triangle_indices);
+    if (!m_hash_index_modified || now - m_hash_index_saved < s_hash_index_save_interval)
+        return;
+    try {
+        save_hash_index();
+    }
+    catch (...) {
+        // losing the index only costs rehashing
+    }
+    m_hash_index_modified = false;
+    m_hash_index_saved = now;
 }
 
-} // namespace face
+std::string STEPImportManager::get_hash(const std::filesystem::path &path, const FileInfo &info)
+{
+    const int64_t now = g_get_real_time();
+    if (auto it = m_hash_index.find(path); it != m_hash_index.end()) {
+        if (it->second.info == info) {
+            it->second.last_used = now;
+            m_hash_index_modified = true;
+            save_hash_index_if_due(now);
+            return it->second.hash;
+        }
+    }
 
-namespace STEPImporter {
+    auto hash = hash_file(path);
+    if (hash.size()) {
+        m_hash_index[path] = {info, hash, now};
+        m_hash_index_modified = true;
+        if (m_hash_index.size() > s_max_hash_index_items) {
+            auto oldest = std::ranges::min_element(m_hash_index, {},
+                                                   [](const auto &x) { return x.second.last_used; });
+            m_hash_index.erase(oldest);
+        }
+        save_hash_index_if_due(now);
+    }
+    return hash;
+}
 
-static void to_json(json &j, const Result &r)
+static size_t get_memory_size(const face::Faces &faces)
 {
-    j = {{"faces", r.faces}, {"points", r.points}};
+    size_t sz = 0;
+    for (const auto &face : faces) {
+        sz += sizeof(face);
+        sz += (face.vertices.capacity() + face.normals.capacity()) * sizeof(face::Vertex);
+        sz += face.triangle_indices.capacity() * sizeof(face.triangle_indices.front());
+    }
+    return sz;
 }
 
-static void from_json(const json &j, Result &r)
+static size_t get_memory_size(const STEPImporter::Result &result)
 {
-
-    j.at("points").get_to(r.points);
-    j.at("faces").get_to(r.faces);
+    size_t sz = get_memory_size(result.faces);
+    sz += result.points.size() * sizeof(STEPImporter::Point);
+    for (const auto &proto : result.prototypes) {
+        sz += get_memory_size(proto.faces);
+        sz += proto.instances.capacity() * sizeof(glm::mat4);
+    }
+    return sz;
 }
 
-} // namespace STEPImporter
-
+// entities get their own reference to the model, so that the entry's use
+// count tells whether it's still needed and releasing the last one can
+// make room for other models
+std::shared_ptr<ImportedSTEP> STEPImportManager::make_handle(std::shared_ptr<ImportedSTEP> imported)
+{
+    auto ptr = imported.get();
+    return std::shared_ptr<ImportedSTEP>(ptr, [owner = std::move(imported)](ImportedSTEP *) mutable {
+        owner.reset();
+        STEPImportManager::get().release();
+    });
+}
 
 std::shared_ptr<ImportedSTEP> STEPImportManager::import_step(const std::filesystem::path &path)
 {
-    if (m_imported.contains(path))
-        return m_imported.at(path);
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    const auto info = get_file_info(path);
+    if (auto it = m_imported.find(path); it != m_imported.end()) {
+        auto &entry = it->second;
+        if (entry.info == info) {
+            m_stats.hits++;
+            m_lru.splice(m_lru.begin(), m_lru, entry.lru_it);
+            return make_handle(entry.imported);
+        }
+        // file changed on disk, entities still holding on to the
+        // old model keep it alive
+        m_lru.erase(entry.lru_it);
+        m_imported.erase(it);
+    }
+    m_stats.misses++;
 
     auto imported = std::make_shared<ImportedSTEP>(path);
     imported->ready = true;
 
-    auto hash = hash_file(path);
-    auto cache_path = get_cache_dir() / (hash + ".ubjson");
+    auto hash = get_hash(path, info);
+    // v2 stores repeated solids as instanced prototypes
+    auto cache_path = get_cache_dir() / (hash + "-v2.ubjson");
 
-    if (fs::exists(cache_path)) {
+    if (hash.size() && fs::exists(cache_path)) {
         // json::from_ubjson(
         auto rd = Glib::file_get_contents(cache_path.string());
         auto j = json::from_ubjson(std::span(rd.data(), rd.size()));
@@ -138,14 +279,56 @@ std::shared_ptr<ImportedSTEP> STEPImportManager::import_step(const std::filesyst
     else {
         imported->result = STEPImporter::import(path.generic_string());
 
-        json j = imported->result;
-        auto bs = json::to_ubjson(j);
-        Glib::file_set_contents(cache_path.string(), reinterpret_cast<const gchar *>(bs.data()), bs.size());
+        if (hash.size()) {
+            json j = imported->result;
+            auto bs = json::to_ubjson(j);
+            Glib::file_set_contents(cache_path.string(), reinterpret_cast<const gchar *>(bs.data()), bs.size());
+        }
         // save_json_to_file(cache_path, j);
     }
-    m_imported.emplace(path, imported);
-    return imported;
+
+    m_lru.push_front(path);
+    m_imported.emplace(path, Entry{.imported = imported,
+                                   .info = info,
+                                   .memory_size = get_memory_size(imported->result),
+                                   .lru_it = m_lru.begin()});
+    evict();
+    return make_handle(imported);
+}
+
+void STEPImportManager::evict()
+{
+    size_t used = 0;
+    for (const auto &[path, entry] : m_imported)
+        used += entry.memory_size;
+
+    // walk from the least recently used end, only models no entity
+    // references anymore can go
+    for (auto it = m_lru.rbegin(); it != m_lru.rend() && used > s_memory_budget;) {
+        auto &entry = m_imported.at(*it);
+        if (entry.imported.use_count() > 1) {
+            ++it;
+            continue;
+        }
+        used -= entry.memory_size;
+        m_stats.evictions++;
+        m_imported.erase(*it);
+        it = decltype(it){m_lru.erase(std::next(it).base())};
+    }
+    m_stats.entries = m_imported.size();
+    m_stats.memory_used = used;
 }
 
+void STEPImportManager::release()
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    evict();
+}
+
+STEPImportManager::Stats STEPImportManager::get_stats()
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    return m_stats;
+}
 
 } // namespace dune3d
@@ -2,6 +2,7 @@
 #include <memory>
 #include <mutex>
 #include <map>
+#include <list>
 #include "imported_step.hpp"
 
 namespace dune3d {
@@ -9,11 +10,66 @@ namespace dune3d {
 class STEPImportManager {
 public:
     static STEPImportManager &get();
+    // models no longer referenced by any entity are kept around until
+    // their combined size exceeds s_memory_budget, releasing the last
+    // reference to a model evicts as needed
     std::shared_ptr<ImportedSTEP> import_step(const std::filesystem::path &path);
 
+    struct Stats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0;
+        size_t entries = 0;
+        size_t memory_used = 0;
+    };
+    Stats get_stats();
+
 private:
     STEPImportManager();
-    std::map<std::filesystem::path, std::shared_ptr<ImportedSTEP>> m_imported;
+    ~STEPImportManager();
+
+    struct FileInfo {
+        uintmax_t size = 0;
+        int64_t mtime = 0;
+
+        bool operator==(const FileInfo &other) const = default;
+    };
+    static FileInfo get_file_info(const std::filesystem::path &path);
+
+    struct Entry {
+        std::shared_ptr<ImportedSTEP> imported;
+        FileInfo info;
+        size_t memory_size = 0;
+        std::list<std::filesystem::path>::iterator lru_it;
+    };
+    std::map<std::filesystem::path, Entry> m_imported;
+    std::list<std::filesystem::path> m_lru; // most recently used first
+    void evict();
+    void release();
+    static std::shared_ptr<ImportedSTEP> make_handle(std::shared_ptr<ImportedSTEP> imported);
+
+    // maps file metadata to content hashes so that unchanged files
+    // don't need to be hashed again
+    struct HashIndexItem {
+        FileInfo info;
+        std::string hash;
+        int64_t last_used = 0;
+    };
+    std::map<std::filesystem::path, HashIndexItem> m_hash_index;
+    bool m_hash_index_modified = false;
+    int64_t m_hash_index_saved = 0;
+    std::string get_hash(const std::filesystem::path &path, const FileInfo &info);
+    void load_hash_index();
+    void save_hash_index() const;
+    void save_hash_index_if_due(int64_t now);
+
+    Stats m_stats;
+
+    static constexpr size_t s_memory_budget = 512 * 1024 * 1024;
+    static constexpr size_t s_max_hash_index_items = 1024;
+    // microseconds, as returned by g_get_real_time()
+    static constexpr int64_t s_hash_index_save_interval = 10'000'000;
+    std::mutex m_mutex;
 };
 
 } // namespace dune3d
@@ -51,6 +51,9 @@
 #include <glm/gtx/rotate_vector.hpp>
 #include <glm/gtx/transform.hpp>
 #include <map>
+#include <thread>
+#include <atomic>
+#include <mutex>
 
 #include "util/fs_util.hpp"
 
@@ -112,7 +115,7 @@ STEPImporter::STEPImporter(const std::filesystem::path &filename)
     m_color = XCAFDoc_DocumentTool::ColorTool(m_doc->Main());
 }
 
-void STEPImporter::processWire(const TopoDS_Wire &wire, const glm::dmat4 &mat)
+void STEPImporter::processWire(const TopoDS_Wire &wire, const glm::dmat4 &mat, std::vector<Point> &points)
 {
     for (BRepTools_WireExplorer expl(wire); expl.More(); expl.Next()) {
         const auto &edge = expl.Current();
@@ -122,7 +125,7 @@ void STEPImporter::processWire(const TopoDS_Wire &wire, const glm::dmat4 &mat)
             gp_Pnt pnt = BRep_Tool::Pnt(first);
             glm::dvec4 gpnt(pnt.X(), pnt.Y(), pnt.Z(), 1);
             auto pt = mat * gpnt;
-            result->points.emplace_back(pt.x, pt.y, pt.z);
+            points.emplace_back(pt.x, pt.y, pt.z);
         }
 
         auto curve = BRepAdaptor_Curve(edge);
@@ -133,7 +136,7 @@ void STEPImporter::processWire(const TopoDS_Wire &wire, const glm::dmat4 &mat)
             {
                 glm::dvec4 gpnt(pnt.X(), pnt.Y(), pnt.Z(), 1);
                 auto pt = mat * gpnt;
-                result->points.emplace_back(pt.x, pt.y, pt.z);
+                points.emplace_back(pt.x, pt.y, pt.z);
             }
         }
     }
@@ -148,17 +151,14 @@ bool STEPImporter::processFace(const TopoDS_Face &face, Quantity_Color *color, c
     if (Standard_True == face.IsNull())
         return false;
 
-    {
-        TopoDS_Iterator it;
-        for (it.Initialize(face, false, false); it.More(); it.Next()) {
-            const TopoDS_Shape &subShape = it.Value();
-            TopAbs_ShapeEnum stype = subShape.ShapeType();
-            if (stype == TopAbs_WIRE) {
-                const TopoDS_Wire &wire = TopoDS::Wire(it.Value());
-                processWire(wire, mat);
-            }
-        }
-    }
+    // everything touching the document or the shared triangulations
+    // happens here, the conversion itself is done in parallel later on
+    auto &job = m_jobs.emplace_back();
+    job.face = face;
+    job.mat = mat;
+    job.prototype = m_current_prototype;
+    if (!m_current_prototype)
+        m_point_sources.push_back({.job_begin = m_jobs.size() - 1, .job_end = m_jobs.size()});
 
     // bool reverse = ( face.Orientation() == TopAbs_REVERSED );
 
@@ -192,7 +192,37 @@ bool STEPImporter::processFace(const TopoDS_Face &face, Quantity_Color *color, c
         }
     } while (0);
 
-    Poly::ComputeNormals(triangulation);
+    if (!triangulation->HasNormals())
+        Poly::ComputeNormals(triangulation);
+
+    job.triangulation = triangulation;
+    if (color)
+        job.color = Color(color->Red(), color->Green(), color->Blue());
+    else
+        job.color = Color(0.5, 0.5, 0.5);
+
+    return true;
+}
+
+void STEPImporter::convertFace(FaceJob &job)
+{
+    {
+        TopoDS_Iterator it;
+        for (it.Initialize(job.face, false, false); it.More(); it.Next()) {
+            const TopoDS_Shape &subShape = it.Value();
+            TopAbs_ShapeEnum stype = subShape.ShapeType();
+            if (stype == TopAbs_WIRE) {
+                const TopoDS_Wire &wire = TopoDS::Wire(it.Value());
+                processWire(wire, job.mat, job.points);
+            }
+        }
+    }
+
+    if (job.triangulation.IsNull())
+        return;
+
+    const auto &triangulation = job.triangulation;
+    const auto &mat = job.mat;
 
 #ifndef HORIZON_NEW_OCC
     const TColgp_Array1OfPnt &arrPolyNodes = triangulation->Nodes();
@@ -200,17 +230,8 @@ bool STEPImporter::processFace(const TopoDS_Face &face, Quantity_Color *color, c
     const TShort_Array1OfShortReal &arrNormals = triangulation->Normals();
 #endif
 
-
-    result->faces.emplace_back();
-    auto &face_out = result->faces.back();
-    if (color) {
-        face_out.color.r = color->Red();
-        face_out.color.g = color->Green();
-        face_out.color.b = color->Blue();
-    }
-    else {
-        face_out.color = {0.5, 0.5, 0.5};
-    }
+    auto &face_out = job.face_out;
+    face_out.color = job.color;
     face_out.vertices.reserve(triangulation->NbNodes());
 
     std::map<Vertex, std::vector<size_t>> pts_map;
@@ -268,8 +289,7 @@ bool STEPImporter::processFace(const TopoDS_Face &face, Quantity_Color *color, c
 #endif
         face_out.triangle_indices.emplace_back(a - 1, b - 1, c - 1);
     }
-
-    return true;
+    job.has_face = true;
 }
 
 bool STEPImporter::processShell(const TopoDS_Shape &shape, Quantity_Color *color, const glm::dmat4 &mat)
@@ -309,7 +329,6 @@ bool STEPImporter::getColor(TDF_Label label, Quantity_Color &color)
 bool STEPImporter::processSolid(const TopoDS_Shape &shape, const glm::dmat4 &mat_in)
 {
     TDF_Label label = m_assy->FindShape(shape, Standard_False);
-    bool ret = false;
 
     hasSolid = true;
 
@@ -338,15 +357,40 @@ bool STEPImporter::processSolid(const TopoDS_Shape &shape, const glm::dmat4 &mat
         mat = glm::rotate(mat, angle_f, gaxis);
     }
 
-    TopoDS_Iterator it;
-    for (it.Initialize(shape, false, false); it.More(); it.Next()) {
-        const TopoDS_Shape &subShape = it.Value();
+    return addSolidInstance(shape, lcolor, mat);
+}
 
-        if (processShell(subShape, lcolor, mat))
-            ret = true;
+bool STEPImporter::addSolidInstance(const TopoDS_Shape &shape, Quantity_Color *color, const glm::dmat4 &mat)
+{
+    PrototypeKey key{shape.TShape().get(), color != nullptr, 0, 0, 0};
+    if (color)
+        key = {shape.TShape().get(), true, color->Red(), color->Green(), color->Blue()};
+
+    auto it_proto = m_prototypes.find(key);
+    if (it_proto == m_prototypes.end()) {
+        // tessellate the solid in its own coordinates
+        const auto index = result->prototypes.size();
+        result->prototypes.emplace_back();
+        const auto job_begin = m_jobs.size();
+
+        const auto prototype_outer = m_current_prototype;
+        m_current_prototype = index;
+        TopoDS_Iterator it;
+        for (it.Initialize(shape, false, false); it.More(); it.Next()) {
+            const TopoDS_Shape &subShape = it.Value();
+
+            processShell(subShape, color, glm::dmat4(1));
+        }
+        m_current_prototype = prototype_outer;
+
+        const PrototypeInfo info{.index = index, .job_begin = job_begin, .job_end = m_jobs.size()};
+        it_proto = m_prototypes.emplace(key, info).first;
     }
+    const auto &info = it_proto->second;
 
-    return ret;
+    m_point_sources.push_back({.job_begin = info.job_begin, .job_end = info.job_end, .transform = mat});
+    result->prototypes.at(info.index).instances.emplace_back(mat);
+    return true;
 }
 
 
@@ -439,17 +483,91 @@ bool STEPImporter::processNode(const TopoDS_Shape &shape)
     return ret;
 }
 
+// prototypes that ended up being used only once don't need to be
+// drawn instanced, bake them into the regular faces instead
+static void flatten_single_instances(Result &res)
+{
+    std::vector<Result::Prototype> prototypes;
+    for (auto &proto : res.prototypes) {
+        if (proto.faces.empty())
+            continue;
+        if (proto.instances.size() > 1) {
+            prototypes.push_back(std::move(proto));
+            continue;
+        }
+        if (proto.instances.size() == 0)
+            continue;
+
+        const auto &mat = proto.instances.front();
+        for (auto &face : proto.faces) {
+            for (auto &v : face.vertices) {
+                const auto vt = mat * glm::vec4(v.x, v.y, v.z, 1);
+                v = Vertex(vt.x, vt.y, vt.z);
+            }
+            for (auto &n : face.normals) {
+                const auto nt = glm::normalize(glm::vec3(mat * glm::vec4(n.x, n.y, n.z, 0)));
+                n = Vertex(nt.x, nt.y, nt.z);
+            }
+            res.faces.push_back(std::move(face));
+        }
+    }
+    res.prototypes = std::move(prototypes);
+}
+
+// runs fn for 0..n-1 on all cores, returns once all are done
+template <typename F> static void parallel_for(size_t n, F fn)
+{
+    const size_t n_threads = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), n);
+    std::atomic_size_t next = 0;
+    std::exception_ptr exception;
+    std::mutex exception_mutex;
+    auto worker = [&] {
+        for (size_t i; (i = next++) < n;) {
+            try {
+                fn(i);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> guard(exception_mutex);
+                if (!exception)
+                    exception = std::current_exception();
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < n_threads; t++)
+        threads.emplace_back(worker);
+    worker();
+    for (auto &thread : threads)
+        thread.join();
+    if (exception)
+        std::rethrow_exception(exception);
+}
+
 Result STEPImporter::get_faces_and_points()
 {
     Result res;
     result = &res;
+    m_prototypes.clear();
+    m_jobs.clear();
+    m_point_sources.clear();
+    m_current_prototype.reset();
 
     TDF_LabelSequence frshapes;
     m_assy->GetFreeShapes(frshapes);
 
     int nshapes = frshapes.Length();
-    int id = 1;
     std::cout << "shapes " << nshapes << std::endl;
+
+    // mesh everything up front, BRepMesh does this on all cores
+    for (int id = 1; id <= nshapes; id++) {
+        TopoDS_Shape shape = m_assy->GetShape(frshapes.Value(id));
+        if (!shape.IsNull())
+            BRepMesh_IncrementalMesh IM(shape, USER_PREC, Standard_False, USER_ANGLE, Standard_True);
+    }
+
+    // collect the faces to convert, this has to be done on a single
+    // thread as it looks up colors in the document
+    int id = 1;
     while (id <= nshapes) {
         TopoDS_Shape shape = m_assy->GetShape(frshapes.Value(id));
         if (!shape.IsNull() && processNode(shape)) {
@@ -457,6 +575,37 @@ Result STEPImporter::get_faces_and_points()
         ++id;
     }
     result = nullptr;
+
+    parallel_for(m_jobs.size(), [this](size_t i) { convertFace(m_jobs.at(i)); });
+
+    // assemble the output in traversal order, so that it doesn't
+    // depend on how the jobs got scheduled
+    for (auto &job : m_jobs) {
+        if (!job.has_face)
+            continue;
+        if (job.prototype)
+            res.prototypes.at(*job.prototype).faces.push_back(std::move(job.face_out));
+        else
+            res.faces.push_back(std::move(job.face_out));
+    }
+    for (const auto &src : m_point_sources) {
+        for (size_t i = src.job_begin; i < src.job_end; i++) {
+            for (const auto &pt : m_jobs.at(i).points) {
+                if (src.transform) {
+                    const auto ptt = *src.transform * glm::dvec4(pt.x, pt.y, pt.z, 1);
+                    res.points.emplace_back(ptt.x, ptt.y, ptt.z);
+                }
+                else {
+                    res.points.push_back(pt);
+                }
+            }
+        }
+    }
+
+    m_jobs.clear();
+    m_point_sources.clear();
+    m_prototypes.clear();
+    flatten_single_instances(res);
     return res;
 }
 
@@ -9,6 +9,11 @@
 #include <XCAFDoc_ColorTool.hxx>
 #include <glm/glm.hpp>
 #include <filesystem>
+#include <Poly_Triangulation.hxx>
+#include <map>
+#include <tuple>
+#include <deque>
+#include <optional>
 
 namespace dune3d::STEPImporter {
 class STEPImporter {
@@ -30,7 +35,8 @@ private:
     bool getColor(TDF_Label label, Quantity_Color &color);
     bool processShell(const TopoDS_Shape &shape, Quantity_Color *color, const glm::dmat4 &mat = glm::dmat4(1));
     bool processFace(const TopoDS_Face &face, Quantity_Color *color, const glm::dmat4 &mat = glm::dmat4(1));
-    void processWire(const TopoDS_Wire &wire, const glm::dmat4 &mat);
+    void processWire(const TopoDS_Wire &wire, const glm::dmat4 &mat, std::vector<Point> &points);
+    bool addSolidInstance(const TopoDS_Shape &shape, Quantity_Color *color, const glm::dmat4 &mat);
 
     Handle(XCAFApp_Application) m_app;
     Handle(TDocStd_Document) m_doc;
@@ -40,5 +46,40 @@ private:
     bool loaded = false;
 
     Result *result;
+
+    // faces are collected while traversing the document and then
+    // converted in parallel
+    struct FaceJob {
+        TopoDS_Face face;
+        glm::dmat4 mat;
+        std::optional<size_t> prototype;
+        Handle(Poly_Triangulation) triangulation;
+        Color color;
+
+        // filled in by convertFace
+        bool has_face = false;
+        Face face_out;
+        std::vector<Point> points;
+    };
+    std::deque<FaceJob> m_jobs;
+    void convertFace(FaceJob &job);
+
+    // points of these jobs make up the imported points, in this order
+    struct PointSource {
+        size_t job_begin;
+        size_t job_end;
+        std::optional<glm::dmat4> transform;
+    };
+    std::vector<PointSource> m_point_sources;
+
+    // solids sharing the same TShape and color are tessellated only once
+    using PrototypeKey = std::tuple<const TopoDS_TShape *, bool, double, double, double>;
+    struct PrototypeInfo {
+        size_t index;
+        size_t job_begin;
+        size_t job_end;
+    };
+    std::map<PrototypeKey, PrototypeInfo> m_prototypes;
+    std::optional<size_t> m_current_prototype;
 };
 } // namespace dune3d::STEPImporter
@@ -218,6 +218,11 @@ static const LutEnumStr<RotationScheme> rotation_scheme_lut = {
         {"legacy", RotationScheme::LEGACY},
 };
 
+static const LutEnumStr<PrimitiveMode> primitive_mode_lut = {
+        {"geometry_shader", PrimitiveMode::GEOMETRY_SHADER},
+        {"instanced", PrimitiveMode::INSTANCED},
+};
+
 json CanvasPreferences::serialize() const
 {
     json j = serialize_colors();
@@ -231,6 +236,10 @@ json CanvasPreferences::serialize() const
     j["error_overlay"] = error_overlay;
     j["zoom_to_cursor"] = zoom_to_cursor;
     j["rotation_scheme"] = rotation_scheme_lut.lookup_reverse(rotation_scheme);
+    j["primitive_mode"] = primitive_mode_lut.lookup_reverse(primitive_mode);
+    j["adaptive_quality"] = adaptive_quality;
+    j["frame_time_target"] = frame_time_target;
+    j["stats_overlay"] = stats_overlay;
     return j;
 }
 
@@ -284,6 +293,11 @@ void CanvasPreferences::load_from_json(const json &j)
     zoom_to_cursor = j.value("zoom_to_cursor", true);
     if (j.contains("rotation_scheme"))
         rotation_scheme = rotation_scheme_lut.lookup(j.at("rotation_scheme"), RotationScheme::DEFAULT);
+    if (j.contains("primitive_mode"))
+        primitive_mode = primitive_mode_lut.lookup(j.at("primitive_mode"), PrimitiveMode::GEOMETRY_SHADER);
+    adaptive_quality = j.value("adaptive_quality", false);
+    frame_time_target = j.value("frame_time_target", 20);
+    stats_overlay = j.value("stats_overlay", false);
     load_colors_from_json(j);
 }
 
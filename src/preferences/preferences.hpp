@@ -7,6 +7,7 @@
 #include "util/changeable.hpp"
 #include "canvas/appearance.hpp"
 #include "canvas/rotation_scheme.hpp"
+#include "canvas/primitive_mode.hpp"
 
 namespace dune3d {
 using json = nlohmann::json;
@@ -24,6 +25,10 @@ public:
     bool dark_theme = false;
     bool zoom_to_cursor = true;
     RotationScheme rotation_scheme = RotationScheme::DEFAULT;
+    PrimitiveMode primitive_mode = PrimitiveMode::GEOMETRY_SHADER;
+    bool adaptive_quality = false;
+    unsigned int frame_time_target = 20; // ms
+    bool stats_overlay = false;
     std::string theme = "Default";
     enum class ThemeVariant { AUTO, DARK, LIGHT };
     ThemeVariant theme_variant = ThemeVariant::AUTO;
@@ -2,6 +2,7 @@
 #include "util/gtk_util.hpp"
 #include "preferences.hpp"
 #include "preferences_row.hpp"
+#include <format>
 
 namespace dune3d {
 
@@ -48,6 +49,47 @@ MiscPreferencesEditor::MiscPreferencesEditor(Preferences &prefs) : m_preferences
             r->bind();
             gr->add_row(*r);
         }
+        {
+            static const std::vector<std::pair<PrimitiveMode, std::string>> primitive_modes = {
+                    {PrimitiveMode::GEOMETRY_SHADER, "Geometry shader"},
+                    {PrimitiveMode::INSTANCED, "Instanced"},
+            };
+            auto r = Gtk::make_managed<PreferencesRowEnum<PrimitiveMode>>(
+                    "Line and text rendering",
+                    "Instanced rendering avoids geometry shaders, which are slow with some drivers",
+                    m_preferences, m_preferences.canvas.primitive_mode, primitive_modes);
+            r->bind();
+            gr->add_row(*r);
+        }
+        {
+            auto r = Gtk::make_managed<PreferencesRowBool>(
+                    "Adaptive quality",
+                    "Reduce antialiasing and resolution while moving the view if rendering is too slow",
+                    m_preferences, m_preferences.canvas.adaptive_quality);
+            gr->add_row(*r);
+        }
+        {
+            auto r = Gtk::make_managed<PreferencesRowNumeric<unsigned int>>(
+                    "Frame time target", "Rendering a frame should take no longer than this while moving the view",
+                    m_preferences, m_preferences.canvas.frame_time_target);
+            auto &sp = r->get_spinbutton();
+            sp.set_range(5, 100);
+            sp.set_increments(1, 5);
+            sp.signal_output().connect(
+                    [&sp] {
+                        sp.set_text(std::format("{} ms", sp.get_value_as_int()));
+                        return true;
+                    },
+                    true);
+            r->bind();
+            gr->add_row(*r);
+        }
+        {
+            auto r = Gtk::make_managed<PreferencesRowBool>(
+                    "Show statistics", "Show frame times and scene statistics in the corner of the canvas",
+                    m_preferences, m_preferences.canvas.stats_overlay);
+            gr->add_row(*r);
+        }
     }
     {
         auto gr = Gtk::make_managed<PreferencesGroup>("Action Bar");
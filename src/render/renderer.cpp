@@ -2,6 +2,7 @@
 #include "canvas/icanvas.hpp"
 #include "document/document.hpp"
 #include "document/entity/all_entities.hpp"
+#include "document/group/group_array.hpp"
 #include "document/group/group_extrude.hpp"
 #include "document/constraint/all_constraints.hpp"
 #include "document/solid_model.hpp"
@@ -12,6 +13,7 @@
 #include "icon_texture_id.hpp"
 #include <iostream>
 #include <array>
+#include <cmath>
 #include <format>
 #include <ranges>
 #include <glm/gtx/io.hpp>
@@ -37,20 +39,50 @@ bool Renderer::group_is_visible(const UUID &uu) const
     return true;
 }
 
-void Renderer::render(const Document &doc, const UUID &current_group, const IDocumentView &doc_view)
+void Renderer::begin(const Document &doc, const UUID &current_group, const IDocumentView &doc_view)
 {
     m_doc = &doc;
     m_doc_view = &doc_view;
     m_current_group = &doc.get_group(current_group);
     m_current_body_group = &m_current_group->find_body(doc).group;
+}
+
+void Renderer::end()
+{
+    m_doc = nullptr;
+    m_doc_view = nullptr;
+    m_current_group = nullptr;
+}
+
+bool Renderer::is_overlay(const Constraint &constraint) const
+{
+    if (m_overlay_entities.empty())
+        return false;
+    return std::ranges::any_of(constraint.get_referenced_entities(),
+                               [this](const UUID &uu) { return m_overlay_entities.contains(uu); });
+}
 
+void Renderer::add_solid_model_faces(const SolidModel &solid_model, ICanvas::FaceColor color)
+{
+    const auto faces = solid_model.get_faces();
+    const auto origin = glm::vec3(0, 0, 0);
+    const auto normal = glm::quat_identity<float, glm::defaultp>();
+    if (m_ca.get_adaptive_quality())
+        m_ca.add_face_group_lod(*faces, *solid_model.get_faces_coarse(), origin, normal, color);
+    else
+        m_ca.add_face_group(*faces, origin, normal, color);
+}
+
+void Renderer::render(const Document &doc, const UUID &current_group, const IDocumentView &doc_view)
+{
+    begin(doc, current_group, doc_view);
 
     if (m_solid_model_edge_select_mode) {
         auto last_solid_model = SolidModel::get_last_solid_model(*m_doc, *m_current_group);
         if (last_solid_model) {
-            m_ca.add_face_group(last_solid_model->m_faces, {0, 0, 0}, glm::quat_identity<float, glm::defaultp>(),
-                                ICanvas::FaceColor::SOLID_MODEL);
-            for (const auto &[edge_idx, path] : last_solid_model->m_edges) {
+            add_solid_model_faces(*last_solid_model, ICanvas::FaceColor::SOLID_MODEL);
+            const auto edges = last_solid_model->get_edges();
+            for (const auto &[edge_idx, path] : *edges) {
                 for (size_t i = 1; i < path.size(); i++) {
                     m_ca.add_selectable(m_ca.draw_line(path.at(i - 1), path.at(i)),
                                         SelectableRef{SelectableRef::Type::SOLID_MODEL_EDGE, UUID(), edge_idx});
@@ -58,9 +90,7 @@ void Renderer::render(const Document &doc, const UUID &current_group, const IDoc
             }
         }
 
-        m_doc = nullptr;
-        m_doc_view = nullptr;
-        m_current_group = nullptr;
+        end();
         return;
     }
 
@@ -68,9 +98,12 @@ void Renderer::render(const Document &doc, const UUID &current_group, const IDoc
         if (!group_is_visible(group->m_uuid))
             continue;
         for (const auto &[uu, el] : doc.m_entities) {
-            if (el->m_group == group->m_uuid)
+            if (el->m_group == group->m_uuid && !m_overlay_entities.contains(uu))
                 render(*el);
         }
+        if (auto group_array = dynamic_cast<const GroupArray *>(group)) {
+            group_array->for_each_virtual_instance(doc, [this](const Entity &en) { render(en); });
+        }
     }
 
 
@@ -95,8 +128,7 @@ void Renderer::render(const Document &doc, const UUID &current_group, const IDoc
                     body_groups.groups, [current_group](auto group) { return group->m_uuid == current_group; });
             const auto color =
                     is_current ? ICanvas::FaceColor::SOLID_MODEL : ICanvas::FaceColor::OTHER_BODY_SOLID_MODEL;
-            m_ca.add_face_group(last_solid_model->m_faces, {0, 0, 0}, glm::quat_identity<float, glm::defaultp>(),
-                                color);
+            add_solid_model_faces(*last_solid_model, color);
         }
     }
 
@@ -104,16 +136,45 @@ void Renderer::render(const Document &doc, const UUID &current_group, const IDoc
     for (const auto &[uu, el] : doc.m_constraints) {
         if (m_current_group->m_uuid != el->m_group)
             continue;
+        if (is_overlay(*el))
+            continue;
         el->accept(*this);
     }
 
     draw_constraints();
 
+    m_ca.begin_overlay();
+    draw_overlay();
+
     m_ca.update_bbox();
 
-    m_doc = nullptr;
-    m_doc_view = nullptr;
-    m_current_group = nullptr;
+    end();
+}
+
+void Renderer::render_overlay(const Document &doc, const UUID &current_group, const IDocumentView &doc_view)
+{
+    begin(doc, current_group, doc_view);
+    draw_overlay();
+    end();
+}
+
+void Renderer::draw_overlay()
+{
+    for (const auto &uu : m_overlay_entities) {
+        auto it = m_doc->m_entities.find(uu);
+        if (it != m_doc->m_entities.end() && group_is_visible(it->second->m_group))
+            render(*it->second);
+    }
+
+    for (const auto &[uu, el] : m_doc->m_constraints) {
+        if (m_current_group->m_uuid != el->m_group)
+            continue;
+        if (is_overlay(*el))
+            el->accept(*this);
+    }
+
+    draw_constraint_icons();
+    draw_constraints();
 }
 
 void Renderer::render(const Entity &entity)
@@ -173,11 +234,6 @@ template <typename T> T c2pi(T x)
     return x;
 }
 
-static glm::dvec2 euler(double r, double phi)
-{
-    return {r * cos(phi), r * sin(phi)};
-}
-
 void Renderer::visit(const EntityArc2D &arc)
 {
     auto &wrkpl = dynamic_cast<const EntityWorkplane &>(*m_doc->m_entities.at(arc.m_wrkpl));
@@ -187,20 +243,13 @@ void Renderer::visit(const EntityArc2D &arc)
         const auto radius0 = glm::length(center - arc.m_from);
         const auto a0 = c2pi(angle(arc.m_from - center));
         const auto a1 = c2pi(angle(arc.m_to - center));
-        unsigned int segments = 64;
 
         float dphi = c2pi(a1 - a0);
         if (dphi < 1e-2)
             dphi = 2 * M_PI;
-        dphi /= segments;
-        float a = a0;
-        while (segments--) {
-            const auto p0 = center + euler(radius0, a);
-            const auto p1 = center + euler(radius0, a + dphi);
-            m_ca.add_selectable(m_ca.draw_line(wrkpl.transform(p0), wrkpl.transform(p1)),
-                                SelectableRef{SelectableRef::Type::ENTITY, arc.m_uuid, 0});
-            a += dphi;
-        }
+        m_ca.add_selectable(m_ca.draw_arc(wrkpl.transform(center), radius0, wrkpl.transform_relative({1, 0}),
+                                          wrkpl.transform_relative({0, 1}), a0, a0 + dphi),
+                            SelectableRef{SelectableRef::Type::ENTITY, arc.m_uuid, 0});
     }
 
     m_ca.add_selectable(m_ca.draw_point(wrkpl.transform(arc.m_from)),
@@ -215,40 +264,19 @@ void Renderer::visit(const EntityCircle2D &circle)
 {
     auto &wrkpl = dynamic_cast<const EntityWorkplane &>(*m_doc->m_entities.at(circle.m_wrkpl));
 
-    {
-        unsigned int segments = 64;
-
-        float dphi = 2 * M_PI;
-        dphi /= segments;
-        float a = 0;
-        while (segments--) {
-            const auto p0 = circle.m_center + euler(circle.m_radius, a);
-            const auto p1 = circle.m_center + euler(circle.m_radius, a + dphi);
-            m_ca.add_selectable(m_ca.draw_line(wrkpl.transform(p0), wrkpl.transform(p1)),
-                                SelectableRef{SelectableRef::Type::ENTITY, circle.m_uuid, 0});
-            a += dphi;
-        }
-    }
+    m_ca.add_selectable(m_ca.draw_arc(wrkpl.transform(circle.m_center), circle.m_radius,
+                                      wrkpl.transform_relative({1, 0}), wrkpl.transform_relative({0, 1}), 0, 2 * M_PI),
+                        SelectableRef{SelectableRef::Type::ENTITY, circle.m_uuid, 0});
 
     m_ca.add_selectable(m_ca.draw_point(wrkpl.transform(circle.m_center)),
                         SelectableRef{SelectableRef::Type::ENTITY, circle.m_uuid, 1});
 }
 void Renderer::visit(const EntityCircle3D &circle)
 {
-    {
-        unsigned int segments = 64;
-
-        float dphi = 2 * M_PI;
-        dphi /= segments;
-        float a = 0;
-        while (segments--) {
-            const auto p0 = circle.m_center + glm::rotate(circle.m_normal, glm::dvec3(euler(circle.m_radius, a), 0));
-            const auto p1 =
-                    circle.m_center + glm::rotate(circle.m_normal, glm::dvec3(euler(circle.m_radius, a + dphi), 0));
-            m_ca.add_selectable(m_ca.draw_line(p0, p1), SelectableRef{SelectableRef::Type::ENTITY, circle.m_uuid, 0});
-            a += dphi;
-        }
-    }
+    const auto u = glm::rotate(circle.m_normal, glm::dvec3(1, 0, 0));
+    const auto v = glm::rotate(circle.m_normal, glm::dvec3(0, 1, 0));
+    m_ca.add_selectable(m_ca.draw_arc(circle.m_center, circle.m_radius, u, v, 0, 2 * M_PI),
+                        SelectableRef{SelectableRef::Type::ENTITY, circle.m_uuid, 0});
 
     m_ca.add_selectable(m_ca.draw_point(circle.m_center), SelectableRef{SelectableRef::Type::ENTITY, circle.m_uuid, 1});
 }
@@ -262,7 +290,6 @@ void Renderer::visit(const EntityArc3D &arc)
         auto v = p - arc.m_center;
         return {glm::dot(un, v), glm::dot(vn, v)};
     };
-    auto transform = [&arc](const glm::dvec2 &p) { return arc.m_center + glm::rotate(arc.m_normal, glm::dvec3(p, 0)); };
 
     auto from2 = project(arc.m_from);
     auto to2 = project(arc.m_to);
@@ -272,20 +299,12 @@ void Renderer::visit(const EntityArc3D &arc)
         const auto radius0 = glm::length(from2);
         const auto a0 = c2pi(angle(from2));
         const auto a1 = c2pi(angle(to2));
-        unsigned int segments = 64;
 
         float dphi = c2pi(a1 - a0);
         if (dphi < 1e-2)
             dphi = 2 * M_PI;
-        dphi /= segments;
-        float a = a0;
-        while (segments--) {
-            const auto p0 = euler(radius0, a);
-            const auto p1 = euler(radius0, a + dphi);
-            m_ca.add_selectable(m_ca.draw_line(transform(p0), transform(p1)),
-                                SelectableRef{SelectableRef::Type::ENTITY, arc.m_uuid, 0});
-            a += dphi;
-        }
+        m_ca.add_selectable(m_ca.draw_arc(arc.m_center, radius0, un, vn, a0, a0 + dphi),
+                            SelectableRef{SelectableRef::Type::ENTITY, arc.m_uuid, 0});
     }
 
     m_ca.add_selectable(m_ca.draw_point(arc.m_from), SelectableRef{SelectableRef::Type::ENTITY, arc.m_uuid, 1});
@@ -346,9 +365,18 @@ void Renderer::visit(const EntitySTEP &en)
     }
 
     if (en.m_imported) {
-        m_ca.add_selectable(
-                m_ca.add_face_group(en.m_imported->result.faces, en.m_origin, en.m_normal, ICanvas::FaceColor::AS_IS),
-                SelectableRef{SelectableRef::Type::ENTITY, en.m_uuid, 0});
+        const SelectableRef sr{SelectableRef::Type::ENTITY, en.m_uuid, 0};
+        const auto &result = en.m_imported->result;
+        // imported meshes don't change, so the canvas can keep them around
+        m_ca.add_selectable(m_ca.add_face_group_persistent(en.m_imported, 0, result.faces, {glm::mat4(1)},
+                                                           en.m_origin, en.m_normal, ICanvas::FaceColor::AS_IS),
+                            sr);
+        for (size_t i = 0; i < result.prototypes.size(); i++) {
+            const auto &proto = result.prototypes.at(i);
+            m_ca.add_selectable(m_ca.add_face_group_persistent(en.m_imported, i + 1, proto.faces, proto.instances,
+                                                               en.m_origin, en.m_normal, ICanvas::FaceColor::AS_IS),
+                                sr);
+        }
         if (en.m_show_points) {
             unsigned int idx = EntitySTEP::s_imported_point_offset;
             for (auto &pt : en.m_imported->result.points) {
@@ -744,15 +772,12 @@ void Renderer::visit(const ConstraintLinesAngle &constr)
     auto r = glm::length(vp);
     auto vpu = glm::dot(vecs.u, vp);
 
-    auto transform = [&](const glm::dvec2 &p) { return is + p.x * vecs.u + p.y * vecs.v; };
-
     SelectableRef sr{SelectableRef::Type::CONSTRAINT, constr.m_uuid, 0};
 
     {
         float a0 = 0;
         if (vpu < 0)
             a0 = M_PI;
-        unsigned int segments = 64;
 
         auto l1vp = glm::dvec2(glm::dot(vecs.u, vecs.l1v), glm::dot(vecs.v, vecs.l1v));
         auto l2vp = glm::dvec2(glm::dot(vecs.u, vecs.l2v), glm::dot(vecs.v, vecs.l2v));
@@ -761,14 +786,7 @@ void Renderer::visit(const ConstraintLinesAngle &constr)
         if (dphi > M_PI)
             dphi = 2 * M_PI - dphi;
 
-        dphi /= segments;
-        float a = a0;
-        while (segments--) {
-            const auto p0 = euler(r, a);
-            const auto p1 = euler(r, a + dphi);
-            m_ca.add_selectable(m_ca.draw_line(transform(p0), transform(p1)), sr);
-            a += dphi;
-        }
+        m_ca.add_selectable(m_ca.draw_arc(is, r, vecs.u, vecs.v, a0, a0 + dphi), sr);
     }
 
     std::string label = std::format(" {:.1f}°", constr.m_angle);
@@ -800,6 +818,13 @@ void Renderer::visit(const ConstraintPointInWorkplane &constraint)
 
 void Renderer::add_constraint_icons(glm::vec3 p, glm::vec3 v, const std::vector<ConstraintType> &constraints)
 {
+    m_constraint_icons = ConstraintIcons{p, v, constraints};
+}
+
+void Renderer::draw_constraint_icons()
+{
+    if (!m_constraint_icons)
+        return;
     using CT = Constraint::Type;
     static const std::map<ConstraintType, IconID> constraint_icon_map = {
             {CT::HORIZONTAL, IconID::CONSTRAINT_HORIZONTAL},
@@ -812,6 +837,7 @@ void Renderer::add_constraint_icons(glm::vec3 p, glm::vec3 v, const std::vector<
             {CT::ARC_ARC_TANGENT, IconID::CONSTRAINT_ARC_ARC_TANGENT},
             {CT::PARALLEL, IconID::CONSTRAINT_PARALLEL},
     };
+    const auto &[p, v, constraints] = *m_constraint_icons;
     for (const auto constraint : constraints) {
         if (!constraint_icon_map.contains(constraint))
             continue;
@@ -826,21 +852,60 @@ void Renderer::add_constraint_icons(glm::vec3 p, glm::vec3 v, const std::vector<
 void Renderer::add_constraint(const glm::vec3 &pos, IconTexture::IconTextureID icon, const UUID &constraint,
                               const glm::vec3 &v)
 {
-    for (auto &[p, l] : m_constraints) {
-        if (glm::length(p - pos) < 1e-6) {
-            l.push_back({icon, v, constraint});
-            return;
+    const ConstraintInfo info{icon, v, constraint};
+    if (glm::any(glm::isnan(pos))) {
+        m_constraint_clusters.push_back({pos, {info}});
+        return;
+    }
+    auto quantize = [](float x) { return static_cast<int64_t>(std::floor(double(x) / cluster_tolerance)); };
+    const ClusterCell cell{quantize(pos.x), quantize(pos.y), quantize(pos.z)};
+    if (auto cluster = find_constraint_cluster(pos, cell)) {
+        cluster->constraints.push_back(info);
+        return;
+    }
+    m_constraint_cluster_cells.emplace(cell, m_constraint_clusters.size());
+    m_constraint_clusters.push_back({pos, {info}});
+}
+
+size_t Renderer::ClusterCellHash::operator()(const ClusterCell &cell) const
+{
+    size_t h = 0;
+    for (const auto x : cell)
+        h = h * 1000003 ^ std::hash<int64_t>{}(x);
+    return h;
+}
+
+Renderer::ConstraintCluster *Renderer::find_constraint_cluster(const glm::vec3 &pos, const ClusterCell &cell)
+{
+    auto find_in_cell = [this, &pos](const ClusterCell &c) -> ConstraintCluster * {
+        const auto [first, last] = m_constraint_cluster_cells.equal_range(c);
+        for (auto it = first; it != last; it++) {
+            auto &cluster = m_constraint_clusters.at(it->second);
+            if (glm::length(cluster.pos - pos) < cluster_tolerance)
+                return &cluster;
+        }
+        return nullptr;
+    };
+    if (auto cluster = find_in_cell(cell))
+        return cluster;
+
+    for (int64_t dx = -1; dx <= 1; dx++) {
+        for (int64_t dy = -1; dy <= 1; dy++) {
+            for (int64_t dz = -1; dz <= 1; dz++) {
+                if (dx == 0 && dy == 0 && dz == 0)
+                    continue;
+                if (auto cluster = find_in_cell({cell.at(0) + dx, cell.at(1) + dy, cell.at(2) + dz}))
+                    return cluster;
+            }
         }
     }
-    m_constraints.emplace_back();
-    m_constraints.back().first = pos;
-    m_constraints.back().second.push_back(ConstraintInfo{icon, v, constraint});
+    return nullptr;
 }
 
 void Renderer::draw_constraints()
 {
     m_ca.set_vertex_constraint(true);
-    for (const auto &[pos, constraints] : m_constraints) {
+    for (const auto &[pos, constraints] : m_constraint_clusters) {
         double n = constraints.size();
         double spacing = 1;
         double offset = -(n - 1) / 2 * spacing;
@@ -861,6 +926,8 @@ void Renderer::draw_constraints()
         }
     }
     m_ca.set_vertex_constraint(false);
+    m_constraint_clusters.clear();
+    m_constraint_cluster_cells.clear();
 }
 
 } // namespace dune3d
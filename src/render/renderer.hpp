@@ -2,7 +2,11 @@
 #include "util/uuid.hpp"
 #include <map>
 #include <glm/glm.hpp>
-#include <list>
+#include <array>
+#include <unordered_map>
+#include <optional>
+#include <set>
+#include <vector>
 #include "document/group/all_groups_fwd.hpp"
 #include "document/entity/entity_visitor.hpp"
 #include "document/constraint/constraint_visitor.hpp"
@@ -18,18 +22,32 @@ class ICanvas;
 class Document;
 class IDocumentView;
 class SelectableRef;
+class Constraint;
+class SolidModel;
 enum class ConstraintType;
 
 class Renderer : private EntityVisitor, private ConstraintVisitor {
 public:
     Renderer(ICanvas &ca);
     void render(const Document &doc, const UUID &current_group, const IDocumentView &doc_view);
+    // only draws the canvas' overlay, to be called after Canvas::clear_overlay
+    void render_overlay(const Document &doc, const UUID &current_group, const IDocumentView &doc_view);
 
     bool m_solid_model_edge_select_mode = false;
 
+    // These entities and the constraints referencing them are drawn into the
+    // canvas' overlay along with the constraint icons, so that tools can
+    // update them without redrawing the whole document.
+    std::set<UUID> m_overlay_entities;
+
     void add_constraint_icons(glm::vec3 p, glm::vec3 v, const std::vector<ConstraintType> &constraints);
 
 private:
+    void begin(const Document &doc, const UUID &current_group, const IDocumentView &doc_view);
+    void end();
+    void draw_overlay();
+    bool is_overlay(const Constraint &constraint) const;
+    void add_solid_model_faces(const SolidModel &solid_model, ICanvas::FaceColor color);
     void render(const Entity &en);
     void visit(const EntityLine3D &en) override;
     void visit(const EntityLine2D &en) override;
@@ -79,11 +97,34 @@ private:
         glm::vec3 v;
         UUID constraint;
     };
-    std::list<std::pair<glm::vec3, std::list<ConstraintInfo>>> m_constraints;
+    struct ConstraintCluster {
+        glm::vec3 pos;
+        std::vector<ConstraintInfo> constraints;
+    };
+    std::vector<ConstraintCluster> m_constraint_clusters;
+
+    // Constraint icons closer than this to each other share a cluster. To
+    // find them, clusters are indexed by their position quantized to cells
+    // of this size, so only the adjacent cells need to be looked at.
+    static constexpr float cluster_tolerance = 1e-6;
+    using ClusterCell = std::array<int64_t, 3>;
+    struct ClusterCellHash {
+        size_t operator()(const ClusterCell &cell) const;
+    };
+    std::unordered_multimap<ClusterCell, size_t, ClusterCellHash> m_constraint_cluster_cells;
+    ConstraintCluster *find_constraint_cluster(const glm::vec3 &pos, const ClusterCell &cell);
+
+    struct ConstraintIcons {
+        glm::vec3 p;
+        glm::vec3 v;
+        std::vector<ConstraintType> constraints;
+    };
+    std::optional<ConstraintIcons> m_constraint_icons;
 
     void add_constraint(const glm::vec3 &pos, IconTexture::IconTextureID icon, const UUID &constraint,
                         const glm::vec3 &v = {NAN, NAN, NAN});
     void draw_constraints();
+    void draw_constraint_icons();
 
     void draw_distance_line(const glm::vec3 &from, const glm::vec3 &to, const glm::vec3 &text_p, double distance,
                             const UUID &uu, const glm::vec3 &fallback_normal = {NAN, NAN, NAN});
@@ -20,9 +20,12 @@
 #include "document/group/group_polar_array.hpp"
 #include <array>
 #include <set>
+#include <map>
+#include <mutex>
+#include <vector>
 #include <iostream>
 
-Sketch SolveSpace::SK = {};
+thread_local Sketch SolveSpace::SK = {};
 
 void SolveSpace::Platform::FatalError(const std::string &message)
 {
@@ -38,49 +41,89 @@ void Group::GenerateEquations(IdList<Equation, hEquation> *)
 namespace dune3d {
 
 
-static std::mutex s_sys_mutex;
+// Arenas are recycled, so that consecutive solves, such as the ones
+// done when looking for redundant constraints, don't have to grow
+// a fresh arena from nothing every time.
+static std::mutex s_arena_pool_mutex;
+static std::vector<std::unique_ptr<Platform::TemporaryArena>> s_arena_pool;
+static const size_t s_arena_pool_max = 4;
+
+static std::unique_ptr<Platform::TemporaryArena> acquire_arena()
+{
+    std::lock_guard<std::mutex> guard(s_arena_pool_mutex);
+    if (s_arena_pool.empty())
+        return std::make_unique<Platform::TemporaryArena>();
+    auto arena = std::move(s_arena_pool.back());
+    s_arena_pool.pop_back();
+    return arena;
+}
+
+static void release_arena(std::unique_ptr<Platform::TemporaryArena> arena)
+{
+    arena->Reset();
+    std::lock_guard<std::mutex> guard(s_arena_pool_mutex);
+    if (s_arena_pool.size() < s_arena_pool_max)
+        s_arena_pool.push_back(std::move(arena));
+}
+
+struct System::ExprCache {
+    std::map<std::pair<unsigned int, unsigned int>, ExprVector> point_in_workplane;
+};
 
 System::System(Document &doc, const UUID &grp, const UUID &constraint_exclude)
-    : m_sys(std::make_unique<SolveSpace::System>()), m_doc(doc), m_solve_group(grp), m_lock(s_sys_mutex)
+    : m_arena(acquire_arena()), m_expr_cache(std::make_unique<ExprCache>()),
+      m_outer_sketch(std::make_unique<Sketch>()), m_sys(std::make_unique<SolveSpace::System>()), m_doc(doc),
+      m_solve_group(grp)
 {
-    for (auto &[uu, constraint] : m_doc.m_constraints) {
-        if (constraint->m_group == m_solve_group)
-            if (auto ps = dynamic_cast<const IConstraintPreSolve *>(constraint.get()))
-                ps->pre_solve(m_doc);
-    }
-    if (auto ps = dynamic_cast<const IGroupPreSolve *>(&doc.get_group(m_solve_group))) {
-        ps->pre_solve(m_doc);
-    }
+    m_prev_arena = Platform::SetTemporaryArena(m_arena.get());
+    swap_sketch();
+
+    try {
+        for (auto &[uu, constraint] : m_doc.m_constraints) {
+            if (constraint->m_group == m_solve_group)
+                if (auto ps = dynamic_cast<const IConstraintPreSolve *>(constraint.get()))
+                    ps->pre_solve(m_doc);
+        }
+        if (auto ps = dynamic_cast<const IGroupPreSolve *>(&doc.get_group(m_solve_group))) {
+            ps->pre_solve(m_doc);
+        }
 
-    for (const auto &[uu, entity] : m_doc.m_entities) {
-        entity->accept(*this);
-    }
-    for (const auto &[uu, constraint] : m_doc.m_constraints) {
-        if (constraint->m_group != m_solve_group)
-            continue;
-        if (uu == constraint_exclude)
-            continue;
-        constraint->accept(*this);
-    }
-    for (const auto &[uu, group] : m_doc.get_groups()) {
-        if (uu != m_solve_group)
-            continue;
-        switch (group->get_type()) {
-        case Group::Type::EXTRUDE:
-            add(dynamic_cast<const GroupExtrude &>(*group));
-            break;
-        case Group::Type::LATHE:
-            add(dynamic_cast<const GroupLathe &>(*group));
-            break;
-        case Group::Type::LINEAR_ARRAY:
-            add(dynamic_cast<const GroupLinearArray &>(*group));
-            break;
-        case Group::Type::POLAR_ARRAY:
-            add(dynamic_cast<const GroupPolarArray &>(*group));
-            break;
-        default:;
+        for (const auto &[uu, entity] : m_doc.m_entities) {
+            entity->accept(*this);
+        }
+        for (const auto &[uu, constraint] : m_doc.m_constraints) {
+            if (constraint->m_group != m_solve_group)
+                continue;
+            if (uu == constraint_exclude)
+                continue;
+            constraint->accept(*this);
+        }
+        for (const auto &[uu, group] : m_doc.get_groups()) {
+            if (uu != m_solve_group)
+                continue;
+            switch (group->get_type()) {
+            case Group::Type::EXTRUDE:
+                add(dynamic_cast<const GroupExtrude &>(*group));
+                break;
+            case Group::Type::LATHE:
+                add(dynamic_cast<const GroupLathe &>(*group));
+                break;
+            case Group::Type::LINEAR_ARRAY:
+                add(dynamic_cast<const GroupLinearArray &>(*group));
+                break;
+            case Group::Type::POLAR_ARRAY:
+                add(dynamic_cast<const GroupPolarArray &>(*group));
+                break;
+            default:;
+            }
         }
     }
+    catch (...) {
+        // don't leave our tables and arena behind after they're gone
+        swap_sketch();
+        Platform::SetTemporaryArena(m_prev_arena);
+        throw;
+    }
 }
 
 void System::visit(const EntityLine3D &line)
@@ -515,9 +558,8 @@ void System::add(const GroupExtrude &group)
                     for (unsigned int pt = 1; pt <= 2; pt++) {
                         auto en_orig_p = get_entity_ref(EntityRef{uu, pt});
                         auto en_new_p = get_entity_ref(EntityRef{new_line_uu, pt});
-                        EntityBase *eorig = SK.GetEntity({en_orig_p});
                         EntityBase *enew = SK.GetEntity({en_new_p});
-                        ExprVector exorig = eorig->PointGetExprs();
+                        ExprVector exorig = get_point_exprs_in_workplane(en_orig_p, EntityBase::FREE_IN_3D.v);
                         ExprVector exnew = enew->PointGetExprs();
                         AddEq(hg, &m_sys->eq, exnew.x->Minus(exorig.x->Plus(direction.x)), eqi++);
                         AddEq(hg, &m_sys->eq, exnew.y->Minus(exorig.y->Plus(direction.y)), eqi++);
@@ -553,9 +595,8 @@ void System::add(const GroupExtrude &group)
                 for (unsigned int pt = 1; pt <= 3; pt++) {
                     auto en_orig_p = get_entity_ref(EntityRef{uu, pt});
                     auto en_new_p = get_entity_ref(EntityRef{new_arc_uu, pt});
-                    EntityBase *eorig = SK.GetEntity({en_orig_p});
                     EntityBase *enew = SK.GetEntity({en_new_p});
-                    ExprVector exorig = eorig->PointGetExprs();
+                    ExprVector exorig = get_point_exprs_in_workplane(en_orig_p, EntityBase::FREE_IN_3D.v);
                     ExprVector exnew = enew->PointGetExprs();
                     AddEq(hg, &m_sys->eq, exnew.x->Minus(exorig.x->Plus(direction.x)), eqi++);
                     AddEq(hg, &m_sys->eq, exnew.y->Minus(exorig.y->Plus(direction.y)), eqi++);
@@ -585,9 +626,8 @@ void System::add(const GroupExtrude &group)
                     unsigned int pt = 1;
                     auto en_orig_p = get_entity_ref(EntityRef{uu, pt});
                     auto en_new_p = get_entity_ref(EntityRef{new_circle_uu, pt});
-                    EntityBase *eorig = SK.GetEntity({en_orig_p});
                     EntityBase *enew = SK.GetEntity({en_new_p});
-                    ExprVector exorig = eorig->PointGetExprs();
+                    ExprVector exorig = get_point_exprs_in_workplane(en_orig_p, EntityBase::FREE_IN_3D.v);
                     ExprVector exnew = enew->PointGetExprs();
                     AddEq(hg, &m_sys->eq, exnew.x->Minus(exorig.x->Plus(direction.x)), eqi++);
                     AddEq(hg, &m_sys->eq, exnew.y->Minus(exorig.y->Plus(direction.y)), eqi++);
@@ -690,19 +730,21 @@ void System::add_array(const GroupArray &group, CreateEq create_eq2, CreateEq cr
         if (it->m_construction)
             continue;
         for (unsigned int instance = 0; instance < group.m_count; instance++) {
+            // instances nothing refers to aren't materialized and need no equations
+            const auto new_uu = group.get_entity_uuid(uu, instance);
+            if (!m_doc.m_entities.contains(new_uu))
+                continue;
             if (it->get_type() == Entity::Type::LINE_2D) {
                 const auto &li = dynamic_cast<const EntityLine2D &>(*it);
                 if (li.m_wrkpl != group.m_active_wrkpl)
                     continue;
-                auto new_line_uu = group.get_entity_uuid(uu, instance);
                 auto en_wrkpl = hEntity{get_entity_ref(EntityRef{li.m_wrkpl, 0})};
 
                 for (unsigned int pt = 1; pt <= 2; pt++) {
                     auto en_orig_p = get_entity_ref(EntityRef{uu, pt});
-                    auto en_new_p = get_entity_ref(EntityRef{new_line_uu, pt});
-                    EntityBase *eorig = SK.GetEntity({en_orig_p});
+                    auto en_new_p = get_entity_ref(EntityRef{new_uu, pt});
                     EntityBase *enew = SK.GetEntity({en_new_p});
-                    ExprVector exorig = eorig->PointGetExprsInWorkplane(en_wrkpl);
+                    ExprVector exorig = get_point_exprs_in_workplane(en_orig_p, en_wrkpl.v);
                     ExprVector exnew = enew->PointGetExprsInWorkplane(en_wrkpl);
                     create_eq2(exorig, exnew, instance);
                 }
@@ -711,22 +753,20 @@ void System::add_array(const GroupArray &group, CreateEq create_eq2, CreateEq cr
                 const auto &circle = dynamic_cast<const EntityCircle2D &>(*it);
                 if (circle.m_wrkpl != group.m_active_wrkpl)
                     continue;
-                auto new_circle_uu = group.get_entity_uuid(uu, instance);
                 auto en_wrkpl = hEntity{get_entity_ref(EntityRef{circle.m_wrkpl, 0})};
 
 
                 {
                     auto en_orig_p = get_entity_ref(EntityRef{uu, 1});
-                    auto en_new_p = get_entity_ref(EntityRef{new_circle_uu, 1});
-                    EntityBase *eorig = SK.GetEntity({en_orig_p});
+                    auto en_new_p = get_entity_ref(EntityRef{new_uu, 1});
                     EntityBase *enew = SK.GetEntity({en_new_p});
-                    ExprVector exorig = eorig->PointGetExprsInWorkplane(en_wrkpl);
+                    ExprVector exorig = get_point_exprs_in_workplane(en_orig_p, en_wrkpl.v);
                     ExprVector exnew = enew->PointGetExprsInWorkplane(en_wrkpl);
                     create_eq2(exorig, exnew, instance);
                 }
                 {
                     auto en_orig_p = get_entity_ref(EntityRef{uu, 0});
-                    auto en_new_p = get_entity_ref(EntityRef{new_circle_uu, 0});
+                    auto en_new_p = get_entity_ref(EntityRef{new_uu, 0});
                     EntityBase *eorig = SK.GetEntity({en_orig_p});
                     EntityBase *enew = SK.GetEntity({en_new_p});
                     AddEq(hg, &m_sys->eq, eorig->CircleGetRadiusExpr()->Minus(enew->CircleGetRadiusExpr()), eqi++);
@@ -736,53 +776,46 @@ void System::add_array(const GroupArray &group, CreateEq create_eq2, CreateEq cr
                 const auto &arc = dynamic_cast<const EntityArc2D &>(*it);
                 if (arc.m_wrkpl != group.m_active_wrkpl)
                     continue;
-                auto new_arc_uu = group.get_entity_uuid(uu, instance);
                 auto en_wrkpl = hEntity{get_entity_ref(EntityRef{arc.m_wrkpl, 0})};
 
                 for (unsigned int pt = 1; pt <= 3; pt++) {
                     auto en_orig_p = get_entity_ref(EntityRef{uu, pt});
-                    auto en_new_p = get_entity_ref(EntityRef{new_arc_uu, pt});
-                    EntityBase *eorig = SK.GetEntity({en_orig_p});
+                    auto en_new_p = get_entity_ref(EntityRef{new_uu, pt});
                     EntityBase *enew = SK.GetEntity({en_new_p});
-                    ExprVector exorig = eorig->PointGetExprsInWorkplane(en_wrkpl);
+                    ExprVector exorig = get_point_exprs_in_workplane(en_orig_p, en_wrkpl.v);
                     ExprVector exnew = enew->PointGetExprsInWorkplane(en_wrkpl);
                     create_eq2(exorig, exnew, instance);
                 }
             }
             else if (it->get_type() == Entity::Type::LINE_3D) {
-                auto new_line_uu = group.get_entity_uuid(uu, instance);
-
                 for (unsigned int pt = 1; pt <= 2; pt++) {
                     auto en_orig_p = get_entity_ref(EntityRef{uu, pt});
-                    auto en_new_p = get_entity_ref(EntityRef{new_line_uu, pt});
-                    EntityBase *eorig = SK.GetEntity({en_orig_p});
+                    auto en_new_p = get_entity_ref(EntityRef{new_uu, pt});
                     EntityBase *enew = SK.GetEntity({en_new_p});
-                    ExprVector exorig = eorig->PointGetExprs();
+                    ExprVector exorig = get_point_exprs_in_workplane(en_orig_p, EntityBase::FREE_IN_3D.v);
                     ExprVector exnew = enew->PointGetExprs();
                     create_eq3(exorig, exnew, instance);
                 }
             }
             else if (it->get_type() == Entity::Type::CIRCLE_3D) {
-                auto new_circle_uu = group.get_entity_uuid(uu, instance);
                 {
                     auto en_orig_p = get_entity_ref(EntityRef{uu, 1});
-                    auto en_new_p = get_entity_ref(EntityRef{new_circle_uu, 1});
-                    EntityBase *eorig = SK.GetEntity({en_orig_p});
+                    auto en_new_p = get_entity_ref(EntityRef{new_uu, 1});
                     EntityBase *enew = SK.GetEntity({en_new_p});
-                    ExprVector exorig = eorig->PointGetExprs();
+                    ExprVector exorig = get_point_exprs_in_workplane(en_orig_p, EntityBase::FREE_IN_3D.v);
                     ExprVector exnew = enew->PointGetExprs();
                     create_eq3(exorig, exnew, instance);
                 }
                 {
                     auto en_orig_p = get_entity_ref(EntityRef{uu, 0});
-                    auto en_new_p = get_entity_ref(EntityRef{new_circle_uu, 0});
+                    auto en_new_p = get_entity_ref(EntityRef{new_uu, 0});
                     EntityBase *eorig = SK.GetEntity({en_orig_p});
                     EntityBase *enew = SK.GetEntity({en_new_p});
                     AddEq(hg, &m_sys->eq, eorig->CircleGetRadiusExpr()->Minus(enew->CircleGetRadiusExpr()), eqi++);
                 }
                 {
                     auto en_orig_n = SK.GetEntity({get_entity_ref(EntityRef{uu, 3})});
-                    auto en_new_n = SK.GetEntity({get_entity_ref({new_circle_uu, 3})});
+                    auto en_new_n = SK.GetEntity({get_entity_ref({new_uu, 3})});
                     en_new_n->noEquation = true;
                     auto normal_orig = en_orig_n->NormalGetExprs();
                     auto normal_new = en_new_n->NormalGetExprs();
@@ -790,19 +823,17 @@ void System::add_array(const GroupArray &group, CreateEq create_eq2, CreateEq cr
                 }
             }
             else if (it->get_type() == Entity::Type::ARC_3D) {
-                auto new_arc_uu = group.get_entity_uuid(uu, instance);
                 for (unsigned int pt = 1; pt <= 3; pt++) {
                     auto en_orig_p = get_entity_ref(EntityRef{uu, pt});
-                    auto en_new_p = get_entity_ref(EntityRef{new_arc_uu, pt});
-                    EntityBase *eorig = SK.GetEntity({en_orig_p});
+                    auto en_new_p = get_entity_ref(EntityRef{new_uu, pt});
                     EntityBase *enew = SK.GetEntity({en_new_p});
-                    ExprVector exorig = eorig->PointGetExprs();
+                    ExprVector exorig = get_point_exprs_in_workplane(en_orig_p, EntityBase::FREE_IN_3D.v);
                     ExprVector exnew = enew->PointGetExprs();
                     create_eq3(exorig, exnew, instance);
                 }
                 {
                     auto en_orig_n = SK.GetEntity({get_entity_ref(EntityRef{uu, 4})});
-                    auto en_new_n = SK.GetEntity({get_entity_ref({new_arc_uu, 4})});
+                    auto en_new_n = SK.GetEntity({get_entity_ref({new_uu, 4})});
                     en_new_n->noEquation = true;
                     auto normal_orig = en_orig_n->NormalGetExprs();
                     auto normal_new = en_new_n->NormalGetExprs();
@@ -864,15 +895,13 @@ void System::add(const GroupLinearArray &group)
     auto hg = hGroup{(uint32_t)group.get_index() + 1};
     unsigned int eqi = 0;
 
-    auto create_eq2 = [this, &hg, &eqi, &direction, &offset](const ExprVector &exorig, const ExprVector &exnew,
-                                                             unsigned int instance) {
-        auto direction_scaled = direction.ScaledBy(Expr::From(instance));
-        ExprVector shift2 = direction_scaled.Plus(offset);
-        AddEq(hg, &m_sys->eq, exnew.x->Minus(exorig.x->Plus(shift2.x)), eqi++);
-        AddEq(hg, &m_sys->eq, exnew.y->Minus(exorig.y->Plus(shift2.y)), eqi++);
-    };
-    auto create_eq3 = [this, &hg, &eqi, &direction, &offset, &group](const ExprVector &exorig, const ExprVector &exnew,
-                                                                     unsigned int instance) {
+    // the shift only depends on the instance, so build it once per instance
+    // and share it among all equations of that instance
+    std::vector<ExprVector> shifts2;
+    std::vector<ExprVector> shifts3;
+    shifts2.reserve(group.m_count);
+    shifts3.reserve(group.m_count);
+    for (unsigned int instance = 0; instance < group.m_count; instance++) {
         auto direction_scaled = direction.ScaledBy(Expr::From(instance));
         ExprVector shift2 = direction_scaled.Plus(offset);
         ExprVector shift3 = shift2;
@@ -881,6 +910,19 @@ void System::add(const GroupLinearArray &group)
             auto en_normal = SK.GetEntity({get_entity_ref(EntityRef{group.m_active_wrkpl, 2})});
             shift3 = en_normal->NormalGetExprs().Rotate(shift2);
         }
+        shifts2.push_back(shift2);
+        shifts3.push_back(shift3);
+    }
+
+    auto create_eq2 = [this, &hg, &eqi, &shifts2](const ExprVector &exorig, const ExprVector &exnew,
+                                                 unsigned int instance) {
+        const auto &shift2 = shifts2.at(instance);
+        AddEq(hg, &m_sys->eq, exnew.x->Minus(exorig.x->Plus(shift2.x)), eqi++);
+        AddEq(hg, &m_sys->eq, exnew.y->Minus(exorig.y->Plus(shift2.y)), eqi++);
+    };
+    auto create_eq3 = [this, &hg, &eqi, &shifts3](const ExprVector &exorig, const ExprVector &exnew,
+                                                 unsigned int instance) {
+        const auto &shift3 = shifts3.at(instance);
         AddEq(hg, &m_sys->eq, exnew.x->Minus(exorig.x->Plus(shift3.x)), eqi++);
         AddEq(hg, &m_sys->eq, exnew.y->Minus(exorig.y->Plus(shift3.y)), eqi++);
         AddEq(hg, &m_sys->eq, exnew.z->Minus(exorig.z->Plus(shift3.z)), eqi++);
@@ -941,14 +983,26 @@ void System::add(const GroupPolarArray &group)
     auto hg = hGroup{(uint32_t)group.get_index() + 1};
     unsigned int eqi = 0;
 
-    auto create_eq2 = [this, &hg, &eqi, &excenter, &offset_angle,
-                       &angle](const ExprVector &exorig, const ExprVector &exnew, unsigned int instance) {
+    // the rotation only depends on the instance, so build it once per
+    // instance and share it among all equations of that instance
+    struct InstanceRotation {
+        Expr *angle;
+        Expr *sin;
+        Expr *cos;
+    };
+    std::vector<InstanceRotation> rotations;
+    rotations.reserve(group.m_count);
+    for (unsigned int instance = 0; instance < group.m_count; instance++) {
         auto exangle = offset_angle->Plus(Expr::From(hParam{angle})->Times(Expr::From(instance)));
-        auto exsin = exangle->Sin();
-        auto excos = exangle->Cos();
+        rotations.push_back({exangle, exangle->Sin(), exangle->Cos()});
+    }
+
+    auto create_eq2 = [this, &hg, &eqi, &excenter, &rotations](const ExprVector &exorig, const ExprVector &exnew,
+                                                              unsigned int instance) {
+        const auto &rot = rotations.at(instance);
         auto pc = exorig.Minus(excenter);
-        auto prx = pc.x->Times(excos)->Minus(pc.y->Times(exsin));
-        auto pry = pc.x->Times(exsin)->Plus(pc.y->Times(excos));
+        auto prx = pc.x->Times(rot.cos)->Minus(pc.y->Times(rot.sin));
+        auto pry = pc.x->Times(rot.sin)->Plus(pc.y->Times(rot.cos));
         AddEq(hg, &m_sys->eq, exnew.x->Minus(excenter.x->Plus(prx)), eqi++);
         AddEq(hg, &m_sys->eq, exnew.y->Minus(excenter.y->Plus(pry)), eqi++);
     };
@@ -959,30 +1013,34 @@ void System::add(const GroupPolarArray &group)
     ExprVector wv = wrkpl->Normal()->NormalExprsV();
     ExprVector wn = wrkpl->Normal()->NormalExprsN();
 
-    auto create_eq3 = [this, &hg, &eqi, &wp, &wu, &wv, &wn, &excenter, &offset_angle,
-                       &angle](const ExprVector &exorig, const ExprVector &exnew, unsigned int instance) {
-        auto ev = exorig.Minus(wp);
-        auto u = ev.Dot(wu);
-        auto v = ev.Dot(wv);
-        auto n = ev.Dot(wn);
+    // the original point's workplane coordinates are the same for all
+    // instances, original expressions come from the expression cache, so
+    // they can be used as the key
+    std::map<std::array<Expr *, 3>, std::array<Expr *, 3>> uvn_cache;
+
+    auto create_eq3 = [this, &hg, &eqi, &wp, &wu, &wv, &wn, &excenter, &rotations,
+                       &uvn_cache](const ExprVector &exorig, const ExprVector &exnew, unsigned int instance) {
+        const std::array<Expr *, 3> key = {exorig.x, exorig.y, exorig.z};
+        auto it = uvn_cache.find(key);
+        if (it == uvn_cache.end()) {
+            auto ev = exorig.Minus(wp);
+            it = uvn_cache.emplace(key, std::array<Expr *, 3>{ev.Dot(wu), ev.Dot(wv), ev.Dot(wn)}).first;
+        }
+        auto [u, v, n] = it->second;
 
-        auto exangle = offset_angle->Plus(Expr::From(hParam{angle})->Times(Expr::From(instance)));
-        auto exsin = exangle->Sin();
-        auto excos = exangle->Cos();
+        const auto &rot = rotations.at(instance);
         auto pc = ExprVector::From(u, v, Expr::From(0.0)).Minus(excenter);
-        auto prx = pc.x->Times(excos)->Minus(pc.y->Times(exsin))->Plus(excenter.x);
-        auto pry = pc.x->Times(exsin)->Plus(pc.y->Times(excos))->Plus(excenter.y);
+        auto prx = pc.x->Times(rot.cos)->Minus(pc.y->Times(rot.sin))->Plus(excenter.x);
+        auto pry = pc.x->Times(rot.sin)->Plus(pc.y->Times(rot.cos))->Plus(excenter.y);
         auto pnew = wp.Plus(wu.ScaledBy(prx)).Plus(wv.ScaledBy(pry)).Plus(wn.ScaledBy(n));
         AddEq(hg, &m_sys->eq, exnew.x->Minus(pnew.x), eqi++);
         AddEq(hg, &m_sys->eq, exnew.y->Minus(pnew.y), eqi++);
         AddEq(hg, &m_sys->eq, exnew.z->Minus(pnew.z), eqi++);
     };
 
-    auto create_eq_n = [this, &hg, &eqi, &offset_angle, &angle, &wn](const ExprQuaternion &normal_orig,
-                                                                     const ExprQuaternion &normal_new,
-                                                                     unsigned int instance) {
-        auto exangle = offset_angle->Plus(Expr::From(hParam{angle})->Times(Expr::From(instance)));
-        auto rq = quat_from_axis_angle(wn, exangle);
+    auto create_eq_n = [this, &hg, &eqi, &rotations, &wn](const ExprQuaternion &normal_orig,
+                                                          const ExprQuaternion &normal_new, unsigned int instance) {
+        auto rq = quat_from_axis_angle(wn, rotations.at(instance).angle);
         auto rot = rq.Times(normal_orig);
         AddEq(hg, &m_sys->eq, normal_new.vx->Minus(rot.vx), eqi++);
         AddEq(hg, &m_sys->eq, normal_new.vy->Minus(rot.vy), eqi++);
@@ -1725,13 +1783,33 @@ int System::get_group_index(const Entity &en) const
 }
 
 
+ExprVector System::get_point_exprs_in_workplane(unsigned int en_point, unsigned int en_wrkpl)
+{
+    const auto key = std::make_pair(en_point, en_wrkpl);
+    auto &cache = m_expr_cache->point_in_workplane;
+    if (auto it = cache.find(key); it != cache.end())
+        return it->second;
+    const auto ex = SK.GetEntity({en_point})->PointGetExprsInWorkplane({en_wrkpl});
+    cache.emplace(key, ex);
+    return ex;
+}
+
+void System::swap_sketch()
+{
+    std::swap(SK.param, m_outer_sketch->param);
+    std::swap(SK.entity, m_outer_sketch->entity);
+    std::swap(SK.constraint, m_outer_sketch->constraint);
+}
+
 System::~System()
 {
     SK.param.Clear();
     SK.entity.Clear();
     SK.constraint.Clear();
+    swap_sketch();
     m_sys->Clear();
-    FreeAllTemporary();
+    Platform::SetTemporaryArena(m_prev_arena);
+    release_arena(std::move(m_arena));
 }
 
 } // namespace dune3d
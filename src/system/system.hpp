@@ -1,7 +1,6 @@
 #pragma once
 #include <memory>
 #include <map>
-#include <mutex>
 #include <functional>
 #include "util/uuid.hpp"
 #include "document/constraint/all_constraints_fwd.hpp"
@@ -16,8 +15,12 @@
 
 namespace SolveSpace {
 class System;
+class Sketch;
 class ExprVector;
 class ExprQuaternion;
+namespace Platform {
+class TemporaryArena;
+}
 } // namespace SolveSpace
 
 namespace dune3d {
@@ -105,10 +108,24 @@ private:
                                          const SolveSpace::ExprQuaternion &exnew, unsigned int instance)>;
     void add_array(const GroupArray &group, CreateEq create_eq2, CreateEq create_eq3, CreateEqN create_eq_n,
                    unsigned int &eqi);
+
+    // all expressions of this system are allocated from this arena
+    std::unique_ptr<SolveSpace::Platform::TemporaryArena> m_arena;
+    SolveSpace::Platform::TemporaryArena *m_prev_arena = nullptr;
+
+    // memoized subexpressions that get referenced from many equations
+    struct ExprCache;
+    std::unique_ptr<ExprCache> m_expr_cache;
+    SolveSpace::ExprVector get_point_exprs_in_workplane(unsigned int en_point, unsigned int en_wrkpl);
+
+    // tables of a system that's still alive further up on this thread,
+    // they're swapped back into SK once we're done
+    std::unique_ptr<SolveSpace::Sketch> m_outer_sketch;
+    void swap_sketch();
+
     std::unique_ptr<SolveSpace::System> m_sys;
     Document &m_doc;
     const UUID m_solve_group;
-    std::lock_guard<std::mutex> m_lock;
 
     unsigned int n_constraint = 1;
 
@@ -100,6 +100,11 @@ const HistoryManager::HistoryItem &HistoryManager::get_current() const
     return *history_current;
 }
 
+std::shared_ptr<const HistoryManager::HistoryItem> HistoryManager::get_current_shared() const
+{
+    return history_current;
+}
+
 bool HistoryManager::has_current() const
 {
     return history_current.get();
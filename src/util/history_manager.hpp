@@ -19,6 +19,8 @@ public:
     const HistoryItem &undo();
     const HistoryItem &redo();
     const HistoryItem &get_current() const;
+    // keeps the item alive for as long as it's needed, e.g. for saving in the background
+    std::shared_ptr<const HistoryItem> get_current_shared() const;
     bool has_current() const;
 
     bool can_undo() const;
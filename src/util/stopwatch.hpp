@@ -0,0 +1,24 @@
+#pragma once
+#include <chrono>
+
+namespace dune3d {
+class Stopwatch {
+public:
+    Stopwatch() : m_start(clock::now())
+    {
+    }
+    void reset()
+    {
+        m_start = clock::now();
+    }
+    // milliseconds since construction or the last reset
+    float get_ms() const
+    {
+        return std::chrono::duration<float, std::milli>(clock::now() - m_start).count();
+    }
+
+private:
+    using clock = std::chrono::steady_clock;
+    clock::time_point m_start;
+};
+} // namespace dune3d
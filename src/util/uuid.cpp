@@ -34,6 +34,11 @@ UUID::UUID(const std::string &str)
     }
 }
 
+UUID::UUID(const unsigned char *bytes)
+{
+    memcpy(uu, bytes, sizeof(uu));
+}
+
 UUID UUID::UUID5(const UUID &nsid, const unsigned char *name, size_t name_size)
 {
     UUID uu;
@@ -19,6 +19,7 @@ public:
     static UUID random();
     UUID(const char *str);
     UUID(const std::string &str);
+    explicit UUID(const unsigned char *bytes);
     static UUID UUID5(const UUID &nsid, const unsigned char *name, size_t name_size);
     operator std::string() const
     {
@@ -0,0 +1,128 @@
+#include "document/document.hpp"
+#include "document/group/group_reference.hpp"
+#include "document/group/group_sketch.hpp"
+#include "document/entity/entity_line2d.hpp"
+#include "document/constraint/constraint_points_coincident.hpp"
+#include "document/constraint/constraint_point_distance.hpp"
+#include "document/constraint/constraint_hv.hpp"
+#include "system/system.hpp"
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Solves copies of the same sketch on several threads at once. SolveSpace's
+// sketch and temporary arena are per thread, so every solve has to end up
+// with exactly the parameters of a solve on a single thread.
+
+using namespace dune3d;
+
+static constexpr unsigned int n_lines = 24;
+
+// a polygon whose corners are off a bit, the constraints pull it into shape
+static Document make_fixture(UUID &sketch_uu)
+{
+    Document doc;
+    const auto &groups = doc.get_groups_sorted();
+    const auto &reference = dynamic_cast<const GroupReference &>(*groups.at(0));
+    const auto wrkpl = reference.get_workplane_xy_uuid();
+    sketch_uu = groups.at(1)->m_uuid;
+
+    std::vector<UUID> lines;
+    for (unsigned int i = 0; i < n_lines; i++) {
+        auto corner = [](unsigned int j) {
+            const double phi = 2 * M_PI * (j % n_lines) / n_lines;
+            const double r = 10 + (j % 3) * .7;
+            return glm::dvec2(r * cos(phi), r * sin(phi));
+        };
+        auto &line = doc.add_entity<EntityLine2D>(UUID::random());
+        line.m_group = sketch_uu;
+        line.m_wrkpl = wrkpl;
+        line.m_p1 = corner(i);
+        line.m_p2 = corner(i + 1) + glm::dvec2(.1, -.1);
+        lines.push_back(line.m_uuid);
+    }
+
+    for (unsigned int i = 0; i < n_lines; i++) {
+        auto &coincident = doc.add_constraint<ConstraintPointsCoincident>(UUID::random());
+        coincident.m_group = sketch_uu;
+        coincident.m_wrkpl = wrkpl;
+        coincident.m_entity1 = {lines.at(i), 2};
+        coincident.m_entity2 = {lines.at((i + 1) % n_lines), 1};
+
+        auto &distance = doc.add_constraint<ConstraintPointDistance>(UUID::random());
+        distance.m_group = sketch_uu;
+        distance.m_wrkpl = wrkpl;
+        distance.m_entity1 = {lines.at(i), 1};
+        distance.m_entity2 = {lines.at(i), 2};
+        distance.m_distance = 2.5;
+    }
+
+    auto &horizontal = doc.add_constraint<ConstraintHorizontal>(UUID::random());
+    horizontal.m_group = sketch_uu;
+    horizontal.m_wrkpl = wrkpl;
+    horizontal.m_entity1 = {lines.front(), 1};
+    horizontal.m_entity2 = {lines.front(), 2};
+
+    return doc;
+}
+
+static std::vector<double> solve(Document &doc, const UUID &sketch_uu)
+{
+    {
+        System sys{doc, sketch_uu};
+        sys.solve();
+        sys.update_document();
+    }
+    std::vector<double> params;
+    for (const auto &[uu, en] : doc.m_entities) {
+        if (en->m_group != sketch_uu)
+            continue;
+        for (unsigned int point = 1; point <= 2; point++) {
+            for (unsigned int axis = 0; axis < 2; axis++)
+                params.push_back(en->get_param(point, axis));
+        }
+    }
+    return params;
+}
+
+int main(int argc, char *argv[])
+{
+    const unsigned int n_threads = argc > 1 ? std::stoul(argv[1]) : 8;
+    const unsigned int n_iterations = argc > 2 ? std::stoul(argv[2]) : 50;
+
+    UUID sketch_uu;
+    const auto fixture = make_fixture(sketch_uu);
+    const auto expected = [&] {
+        Document doc{fixture};
+        return solve(doc, sketch_uu);
+    }();
+
+    // copying reads the fixture's caches, so that's done up front
+    std::vector<std::vector<std::unique_ptr<Document>>> docs(n_threads);
+    for (auto &thread_docs : docs) {
+        for (unsigned int i = 0; i < n_iterations; i++)
+            thread_docs.push_back(std::make_unique<Document>(fixture));
+    }
+
+    std::atomic<unsigned int> n_mismatches = 0;
+    std::vector<std::thread> threads;
+    for (auto &thread_docs : docs) {
+        threads.emplace_back([&thread_docs, &sketch_uu, &expected, &n_mismatches] {
+            for (auto &doc : thread_docs) {
+                if (solve(*doc, sketch_uu) != expected)
+                    n_mismatches++;
+            }
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+
+    if (n_mismatches) {
+        std::cerr << n_mismatches << " of " << n_threads * n_iterations << " solves differ" << std::endl;
+        return 1;
+    }
+    return 0;
+}